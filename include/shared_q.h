@@ -32,6 +32,56 @@ typedef enum
     SQ_READWRITE            // queue instance can add/remove items
 } sq_mode_e;
 
+typedef enum
+{
+    SQ_SPSC = 1,            // single producer single consumer ring buffer
+    SQ_LEAN = 2,            // skip timestamps, events, and arrival signals
+    SQ_WEIGHTED = 4,        // weighted lane selection so low lanes are not starved
+    SQ_BROADCAST = 8,       // every consumer group reads every item
+    SQ_HUGE = 16            // back queue with huge pages, grown a huge page at a time
+} sq_attr_flags_e;
+
+
+typedef enum
+{
+    SQ_READY_NONEMPTY = 1,  // readable when item added to empty queue
+    SQ_READY_NONFULL = 2    // readable when room made on full queue
+} sq_ready_e;
+
+
+typedef enum
+{
+    SQ_CLOCK_REALTIME = 0,      // CLOCK_REALTIME, the default
+    SQ_CLOCK_REALTIME_COARSE,   // CLOCK_REALTIME_COARSE
+    SQ_CLOCK_MONOTONIC,         // CLOCK_MONOTONIC
+    SQ_CLOCK_MONOTONIC_COARSE,  // CLOCK_MONOTONIC_COARSE
+    SQ_CLOCK_TSC                // calibrated time stamp counter
+} sq_clock_e;
+
+
+typedef enum
+{
+    SQ_SYNC_NONE = 0,       // file written back by the system
+    SQ_SYNC_PERIODIC,       // file flushed by each handle at sync_msec interval
+    SQ_SYNC_COMMIT          // adds return once flushed, concurrent adds share a flush
+} sq_sync_e;
+
+
+typedef struct sq_attr
+{
+    long flags;             // create time flags from sq_attr_flags_e
+    size_t ring_size;       // size in bytes of SQ_SPSC ring, 0 for default
+    size_t item_size;       // fixed maximum item size in bytes, 0 for variable
+    sq_clock_e clock;       // clock used for queue timestamps
+    int lanes;              // number of priority lanes, 0 or 1 for a single lane
+    sq_sync_e sync;         // flush policy of file backed queue
+    long sync_msec;         // milliseconds between SQ_SYNC_PERIODIC flushes, 0 for default
+    size_t initial_size;    // bytes of queue memory allocated at create, 0 for default
+    long prealloc;          // number of items whose nodes and data are carved at create
+    size_t prealloc_len;    // item length in bytes the carved data is sized for
+    long compact_msec;      // milliseconds between compactions by each handle, 0 for none
+} sq_attr_s;
+
 
 typedef struct sq_vec
 {
@@ -73,6 +123,15 @@ extern sh_status_e shr_q_create(
 );
 
 
+extern sh_status_e shr_q_create_ex(
+    shr_q_s **q,            // address of q struct pointer -- not NULL
+    char const * const name,// name of q as a null terminated string -- not NULL
+    unsigned int max_depth, // max depth allowed at which add of item is blocked
+    sq_mode_e mode,         // read/write mode
+    sq_attr_s *attr         // pointer to create time attributes, or NULL
+);
+
+
 extern sh_status_e shr_q_open(
     shr_q_s **q,            // address of q struct pointer -- not NULL
     char const * const name,// name of q as a null terminated string -- not NULL
@@ -108,6 +167,12 @@ extern sh_status_e shr_q_call(
 );
 
 
+extern int shr_q_readiness_fd(
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    int events          // events from sq_ready_e -- not 0
+);
+
+
 extern sh_status_e shr_q_add(
     shr_q_s *q,         // pointer to queue struct -- not NULL
     void *value,        // pointer to item -- not NULL
@@ -115,6 +180,14 @@ extern sh_status_e shr_q_add(
 );
 
 
+extern sh_status_e shr_q_add_prio(
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    void *value,        // pointer to item -- not NULL
+    size_t length,      // length of item -- greater than 0
+    int prio            // priority lane of item -- 0 to lanes - 1
+);
+
+
 extern sh_status_e shr_q_add_wait(
     shr_q_s *q,         // pointer to queue struct -- not NULL
     void *value,        // pointer to item -- not NULL
@@ -152,6 +225,33 @@ extern sh_status_e shr_q_addv_timedwait(
 );
 
 
+extern sh_status_e shr_q_add_batch(
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_vec_s *items,    // array of items -- not NULL
+    int count           // number of items in array -- greater than 0
+);
+
+
+extern sh_status_e shr_q_reserve(
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    size_t length,      // length of item -- greater than 0
+    void **value,       // address of pointer to reserved space -- not NULL
+    long *handle        // pointer to reservation handle -- not NULL
+);
+
+
+extern sh_status_e shr_q_commit(
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long handle         // reservation handle from shr_q_reserve
+);
+
+
+extern sh_status_e shr_q_abort(
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long handle         // reservation handle from shr_q_reserve
+);
+
+
 extern sq_item_s shr_q_remove(
     shr_q_s *q,         // pointer to queue structure -- not NULL
     void **buffer,      // address of buffer pointer -- not NULL
@@ -174,6 +274,87 @@ extern sq_item_s shr_q_remove_timedwait(
 );
 
 
+extern sh_status_e shr_q_join(
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    int group                   // consumer group -- 0 to 7
+);
+
+
+extern sh_status_e shr_q_leave(
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    int group                   // consumer group -- 0 to 7
+);
+
+
+extern sq_item_s shr_q_remove_group(
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    int group,                  // consumer group -- 0 to 7
+    void **buffer,              // address of buffer pointer -- not NULL
+    size_t *buff_size           // pointer to size of buffer -- not NULL
+);
+
+
+extern long shr_q_lag(
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    int group                   // consumer group -- 0 to 7
+);
+
+
+extern sh_status_e shr_q_select(
+    shr_q_s **qs,               // array of queue pointers -- not NULL
+    int count,                  // number of queues -- 1 to 128
+    struct timespec *timeout,   // timeout value, or NULL to wait indefinitely
+    int *ready_index            // index of queue with item -- not NULL
+);
+
+
+extern sh_status_e shr_q_remove_batch(
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_item_s *items,   // array of items -- not NULL
+    int max,            // number of items in array -- greater than 0
+    int *count          // pointer to number of items removed -- not NULL
+);
+
+
+extern sh_status_e shr_q_remove_batch_wait(
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_item_s *items,   // array of items -- not NULL
+    int max,            // number of items in array -- greater than 0
+    int *count          // pointer to number of items removed -- not NULL
+);
+
+
+extern sh_status_e shr_q_remove_batch_timedwait(
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    sq_item_s *items,           // array of items -- not NULL
+    int max,                    // number of items in array -- greater than 0
+    int *count,                 // pointer to number of items removed -- not NULL
+    struct timespec *timeout    // timeout value -- not NULL
+);
+
+
+extern sq_item_s shr_q_remove_borrow(
+    shr_q_s *q          // pointer to queue struct -- not NULL
+);
+
+
+extern sq_item_s shr_q_remove_borrow_wait(
+    shr_q_s *q          // pointer to queue struct -- not NULL
+);
+
+
+extern sq_item_s shr_q_remove_borrow_timedwait(
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    struct timespec *timeout    // timeout value -- not NULL
+);
+
+
+extern sh_status_e shr_q_release(
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_item_s *item     // pointer to borrowed item -- not NULL
+);
+
+
 extern sq_event_e shr_q_event(
     shr_q_s *q                  // pointer to queue struct -- not NULL
 );
@@ -197,6 +378,11 @@ extern long shr_q_count(
 );
 
 
+extern long shr_q_count_approx(
+    shr_q_s *q                  // pointer to queue struct -- not NULL
+);
+
+
 extern size_t shr_q_buffer(
     shr_q_s *q                  // pointer to queue struct -- not NULL
 );
@@ -249,6 +435,17 @@ extern bool shr_q_will_lifo(
 );
 
 
+extern sh_status_e shr_q_coalesce(
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    bool flag                   // true will turn on signal coalescing
+);
+
+
+extern bool shr_q_will_coalesce(
+    shr_q_s *q                  // pointer to queue struct -- not NULL
+);
+
+
 extern sh_status_e shr_q_subscribe(
     shr_q_s *q,                 // pointer to queue struct -- not NULL
     sq_event_e event            // event to enable
@@ -284,6 +481,23 @@ extern sh_status_e shr_q_target_delay(
 );
 
 
+extern sh_status_e shr_q_compact(
+    shr_q_s *q                  // pointer to queue struct -- not NULL
+);
+
+
+extern sh_status_e shr_q_snapshot(
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    int fd                      // file descriptor open for writing
+);
+
+
+extern sh_status_e shr_q_restore(
+    char const * const name,    // name of q as a null terminated string -- not NULL
+    int fd                      // file descriptor open for reading
+);
+
+
 extern bool shr_q_is_valid(
     char const * const name // name of q as a null terminated string -- not NULL
 );
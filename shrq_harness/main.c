@@ -79,6 +79,7 @@ static volatile unsigned long verif = 0;
 static shr_q_s *queue;
 static int waiting = 0;
 static long msg_size = DEFAULT_SIZE;
+static sq_attr_s attr = {0};
 static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -110,6 +111,7 @@ void *validate_producer(
     int cpu = id % sys_cpu_count;
     unsigned long *ptr;
     unsigned long total = 0;
+    sh_status_e status;
     CPU_ZERO(&set);
     CPU_SET(cpu, &set);
 
@@ -124,7 +126,7 @@ void *validate_producer(
     shr_q_s *q = queue;
 #else
     shr_q_s *q = NULL;
-    sh_status_e status = shr_q_open(&q, QNAME, SQ_WRITE_ONLY);
+    status = shr_q_open(&q, QNAME, SQ_WRITE_ONLY);
     assert(status == SH_OK);
 #endif
     assert(wait() == 0);
@@ -133,8 +135,13 @@ void *validate_producer(
     for (i = 0; i < iterations; ++i) {
         *ptr = AAF(&input, 1);
         total += *ptr;
-        while (shr_q_add(q, (void *)ptr, msg_size) != SH_OK)
-            printf("add failed\n");
+        while ((status = shr_q_add(q, (void *)ptr, msg_size)) != SH_OK) {
+            if (status == SH_ERR_LIMIT) {
+                sched_yield();
+            } else {
+                printf("add failed\n");
+            }
+        }
     }
     free(ptr);
     AAF(&verif, total);
@@ -240,6 +247,31 @@ void validate_basic_queue(
     shr_q_destroy(&q);
 }
 
+static void parse_arg_to_flags(
+    char *string,
+    int arg_no
+)   {
+    char *token = strtok(string, ",");
+
+    while (token) {
+        if (strcmp(token, "spsc") == 0) {
+            attr.flags |= SQ_SPSC;
+        } else if (strcmp(token, "fixed") == 0) {
+            attr.item_size = msg_size;
+        } else if (strcmp(token, "lean") == 0) {
+            attr.flags |= SQ_LEAN;
+        } else if (strcmp(token, "coarse") == 0) {
+            attr.clock = SQ_CLOCK_REALTIME_COARSE;
+        } else if (strcmp(token, "tsc") == 0) {
+            attr.clock = SQ_CLOCK_TSC;
+        } else {
+            printf("argument %i has invalid flag %s\n", arg_no, token);
+            exit(0);
+        }
+        token = strtok(NULL, ",");
+    }
+}
+
 static long parse_arg_to_long(
     char *string,
     int arg_no
@@ -279,8 +311,9 @@ int main(
 
     (void)remove("/dev/shm/testq");
 
-    if (argc < 4 || argc > 5) {
-        fprintf(stderr, "%s: <ncpus> <nthreads> <iterations> [<size>]\n",
+    if (argc < 4 || argc > 6) {
+        fprintf(stderr, "%s: <ncpus> <nthreads> <iterations> [<size> [<flags>]]\n"
+                "    flags: comma separated list of spsc, fixed, lean, coarse, tsc\n",
                 argv[0]);
         return 1;
     }
@@ -291,9 +324,12 @@ int main(
     verif = 0;
     sys_cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
 
-    if (argc == 5) {
+    if (argc >= 5) {
         msg_size = parse_arg_to_long(argv[4], 4);
     }
+    if (argc == 6) {
+        parse_arg_to_flags(argv[5], 5);
+    }
     iterations = parse_arg_to_long(argv[3], 3);
     thread_count = parse_arg_to_long(argv[2], 2);
     cpu_count = parse_arg_to_long(argv[1], 1);
@@ -314,11 +350,15 @@ int main(
         fprintf(stderr, "%s: need an even number of threads\n", argv[0]);
         return 1;
     }
+    if ((attr.flags & SQ_SPSC) && total != 2) {
+        fprintf(stderr, "%s: spsc needs exactly 2 threads\n", argv[0]);
+        return 1;
+    }
 
     if (cpu_count == 1 && thread_count == 1) {
         validate_basic_queue(iterations);
     } else {
-        result = shr_q_create(&queue, QNAME, INT_MAX, SQ_READWRITE);
+        result = shr_q_create_ex(&queue, QNAME, INT_MAX, SQ_READWRITE, &attr);
         if (result) {
             printf("unable to create queue, mutex, or cond\n");
         } else {
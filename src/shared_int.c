@@ -23,14 +23,20 @@ THE SOFTWARE.
 
 */
 
+
+#define _GNU_SOURCE
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/futex.h>
 #include <linux/limits.h>
+#include <linux/magic.h>
 #include <sys/mman.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
+#include <sys/vfs.h>
 #include <unistd.h>
 
 #include "shared_int.h"
@@ -52,14 +58,16 @@ enum shr_int_constants
 {
 
     IDX_SIZE = 4,           // index node slot count
+    GATE_SPINS = 64,        // gate claim attempts before blocking on futex
+    SELECT_SLICE = 1000000, // nanoseconds between gate checks without futex_waitv
+    CARVE_CHUNK = 64,       // carved nodes appended to free node list at a time
+    CLASS_BITS = 2,         // log 2 of data size classes per power of 2
+    SIZE_CLASSES = 1 << CLASS_BITS,     // data size classes per power of 2
+    FIT_CLASSES = 3 * SIZE_CLASSES,     // size classes scanned for first fit
 
 };
 
 
-// static null value for use in CAS
-static void *null = NULL;
-
-
 /*
     convert_to_status -- converts errno value to sh_status_e value
 
@@ -159,40 +167,59 @@ extern sh_status_e validate_name(
 
 
 /*
-    build_file_path -- builds path to shared memory file in buffer
+    is_file_path -- true if name is the path of a regular file rather than the
+    name of a shared memory object, which may only have a leading '/'
+*/
+extern bool is_file_path(
 
-    effects:
+    char const * const name     // name as null terminated string -- not NULL
+
+)   {
+
+    return ( name[ 0 ] != 0 && strchr( &name[ 1 ], '/' ) != NULL );
+}
+
+
+/*
+    open_object -- opens shared memory object or regular file named
 
-    buffer is cleared for length, and the name of the shared memory
-    file is appended to shared memory directory in the buffer
+    returns file descriptor, or -1 on error with errno set
 */
-static void build_file_path(
+extern int open_object(
 
-    char const * const name,        // name string of shared memory file
-    char *buffer,                   // buffer
-    int size                        // buffer size
+    char const * const name,    // name as null terminated string -- not NULL
+    int oflag                   // open flags
 
 )   {
 
-    // initialize buffer
-    memset( buffer, 0, size );
+    if ( is_file_path( name ) ) {
+
+        return open( name, oflag | O_CLOEXEC, FILE_MODE );
+
+    }
+
+    return shm_open( name, oflag, FILE_MODE );
+}
+
+
+/*
+    unlink_object -- removes shared memory object or regular file named
+
+    returns 0 on success, or -1 on error with errno set
+*/
+static int unlink_object(
 
-    // copy shared memory directory
-    memcpy( buffer, SHR_OBJ_DIR, sizeof(SHR_OBJ_DIR) );
+    char const * const name     // name as null terminated string -- not NULL
 
-    // index to end of data in buffer
-    int index = sizeof(SHR_OBJ_DIR) - 1;
+)   {
 
-    // does name start with '/'?
-    if ( name[ 0 ] == '/' ) {
+    if ( is_file_path( name ) ) {
 
-        // backup in buffer
-        index--;
+        return unlink( name );
 
     }
 
-    // copy name into buffer
-    memcpy( &buffer[ index ], name, strlen( name ) );
+    return shm_unlink( name );
 }
 
 
@@ -235,14 +262,18 @@ extern sh_status_e validate_existence(
 
     }
 
-    // build file path
-    int bsize = sizeof(SHR_OBJ_DIR) + strlen( name );
-    char nm_buffer[ bsize ];
-    build_file_path( name, &nm_buffer[ 0 ], bsize );
+    // check status of object opened by name, so the directory holding shared
+    // memory objects is left to the system
+    int fd = open_object( name, O_RDONLY | O_NONBLOCK );
+    if ( fd < 0 ) {
+
+        return convert_to_status( errno );
+
+    }
 
-    // check file status
     struct stat statbuf;
-    int rc = stat( &nm_buffer[ 0 ], &statbuf );
+    int rc = fstat( fd, &statbuf );
+    close( fd );
     if ( rc < 0 ) {
 
         // error performing stat
@@ -312,17 +343,111 @@ static sh_status_e init_base_struct(
     return SH_OK;
 }
 
+/*
+    object_granule -- size in bytes by which object grows, which is the huge
+    page size of a file on hugetlbfs, HUGE_SIZE for other objects backed by
+    huge pages, otherwise, PAGE_SIZE
+*/
+static long object_granule(
+
+    int fd,                 // file descriptor of object
+    bool huge               // true to back object with huge pages
+
+)   {
+
+    struct statfs fs;
+
+    if ( fstatfs( fd, &fs ) == 0 && fs.f_type == HUGETLBFS_MAGIC ) {
+
+        return fs.f_bsize;
+
+    }
+
+    return huge ? HUGE_SIZE : PAGE_SIZE;
+}
+
+
+/*
+    is_hugetlbfs -- returns true if object is a file on hugetlbfs
+*/
+static bool is_hugetlbfs(
+
+    int fd                  // file descriptor of object
+
+)   {
+
+    struct statfs fs;
+    return ( fstatfs( fd, &fs ) == 0 && fs.f_type == HUGETLBFS_MAGIC );
+}
+
+
+/*
+    advise_extent -- ask for transparent huge pages for mapping of extent if
+    object grows in huge page steps, a hugetlbfs mapping already has them
+*/
+static void advise_extent(
+
+    extent_s *extent        // pointer to extent -- not NULL
+
+)   {
+
+    if ( extent->array[ GRANULE ] > PAGE_SIZE ) {
+
+        (void) madvise( extent->array, extent->size, MADV_HUGEPAGE );
+
+    }
+}
+
+
+/*
+    size_object -- extends object from one size to a larger size, allocating
+    the memory backing the added range where the file system supports it, so
+    running out of memory fails the extension rather than a later access
+
+    Note:  a hugetlbfs file is extended in whole huge pages by fallocate
+
+    returns 0 on success, otherwise, -1 with errno set
+*/
+static int size_object(
+
+    int fd,                 // file descriptor of object
+    long from,              // current size in bytes
+    long to                 // new size in bytes
+
+)   {
+
+    if ( to <= from ) {
+
+        return 0;
+
+    }
+
+    int rc;
+    while ( ( rc = fallocate( fd, 0, from, to - from ) ) < 0 && errno == EINTR );
+
+    if ( rc < 0 && errno == EOPNOTSUPP ) {
+
+        while ( ( rc = ftruncate( fd, to ) ) < 0 && errno == EINTR );
+
+    }
+
+    return rc;
+}
+
+
 /*
     allocate_shared_memory -- creates and sets initial size of shared memory object
 
     effects:
 
-    on success, the shared memory object will exist and be set to the specified
-    size, otherwise, no shared memory object will exist
+    on success, the shared memory object will exist and be set to the initial
+    size rounded up to a multiple of the size it grows by, otherwise, no shared
+    memory object will exist
 
     returns sh_status_e:
 
     SH_OK           successful open and sizing
+    SH_ERR_NOMEM    not enough memory
     SH_ERR_PATH     invalid path name
     SH_ERR_EXIST    shared object already exists
 */
@@ -330,15 +455,18 @@ static sh_status_e allocate_shared_memory(
 
     shr_base_s *base,       // address of base struct pointer -- not NULL
     char const * const name,// name of base as a null terminated string -- not NULL
-    long size               // requested size for shared memory object
+    bool huge,              // true to back object with huge pages
+    size_t initial,         // initial size in bytes, 0 for size object grows by
+    long *size              // pointer to initial size of object -- not NULL
 
 )   {
 
     // create initial shared memory object
-    base->fd = shm_open( name, O_RDWR | O_CREAT | O_EXCL, FILE_MODE );
+    base->fd = open_object( name, O_RDWR | O_CREAT | O_EXCL );
     if ( base->fd < 0 ) {
 
-        if ( errno == EINVAL ) {
+        // no directory for regular file is a path error
+        if ( errno == EINVAL || ( errno == ENOENT && is_file_path( name ) ) ) {
 
             return SH_ERR_PATH;
 
@@ -347,12 +475,49 @@ static sh_status_e allocate_shared_memory(
         return convert_to_status( errno );
     }
 
-    // set initial size
-    int rc = ftruncate( base->fd, size );
-    if ( rc < 0 ) {
+    // set initial size, a hugetlbfs file is sized in whole huge pages
+    long granule = object_granule( base->fd, huge );
+    *size = ( ( initial + granule - 1 ) / granule ) * granule;
+
+    if ( *size == 0 ) {
 
-        shm_unlink( name );
+        *size = granule;
+
+    }
+
+    if ( size_object( base->fd, 0, *size ) < 0 ) {
+
+        sh_status_e status = convert_to_status( errno );
+        close( base->fd );
+        unlink_object( name );
         base->fd = -1;
+        return status;
+
+    }
+
+    return SH_OK;
+}
+
+/*
+    map_range -- maps range of object into reserved address space of extent,
+    replacing the reservation over that range
+*/
+static sh_status_e map_range(
+
+    extent_s *extent,       // pointer to extent -- not NULL
+    int fd,                 // file descriptor
+    int prot,               // protection indicators
+    int flags,              // sharing flags
+    long from,              // offset in bytes of start of range
+    long to                 // offset in bytes of end of range
+
+)   {
+
+    void *addr = mmap( (char*) extent->array + from, to - from, prot,
+                       flags | MAP_FIXED | MAP_NORESERVE, fd, from );
+
+    if ( addr == (void*) -1 ) {
+
         return convert_to_status( errno );
 
     }
@@ -360,13 +525,19 @@ static sh_status_e allocate_shared_memory(
     return SH_OK;
 }
 
+
 /*
-    create_extent -- creates new extent with mmapped array of specified size
+    map_extent -- maps object over a reserved address space of at least
+    RESERVE_SIZE and at least twice the current size of the object
 
     effects:
 
-    *current will contain new extent instance with current->array pointing
-    at mmapped memory array, otherwise, on error extent will not be allocated
+    extent->array points at the mapping, which stays at the same address as
+    the object grows, and accesses past the end of the object are not valid
+
+    Note:  the address space is reserved without access, and the object is
+    mapped over all of it, except on hugetlbfs where a writable mapping past
+    the end of the file extends the file, so only the object is mapped there
 
     returns sh_status_e:
 
@@ -374,45 +545,89 @@ static sh_status_e allocate_shared_memory(
     SH_ERR_NOMEM    not enough memory
 
 */
-static sh_status_e create_extent(
+static sh_status_e map_extent(
 
-    extent_s **current,     // address of extent pointer
-    long slots,             // slots in extent
+    extent_s *extent,       // pointer to extent -- not NULL
     int fd,                 // file descriptor
     int prot,               // protection indicators
-    int flags               // sharing flags
+    int flags,              // sharing flags
+    long bytes              // current size of object
 
 )   {
 
-    *current = calloc( 1, sizeof(extent_s) );
-    if ( *current == NULL ) {
+    long size = RESERVE_SIZE;
 
-        return SH_ERR_NOMEM;
+    while ( bytes > ( size >> 1 ) ) {
 
-    }
+        size <<= 1;
 
-    (*current)->size = slots << SZ_SHIFT;
-    (*current)->slots = slots;
+    }
 
-    (*current)->array = mmap( 0, (*current)->size, prot, flags, fd, 0 );
-    if ( (*current)->array == (void*) -1 ) {
+    extent->array = mmap( 0, size, PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+    if ( extent->array == (void*) -1 ) {
 
-        free( *current );
+        extent->array = NULL;
         return convert_to_status( errno );
 
     }
 
+    long length = is_hugetlbfs( fd ) ? bytes : size;
+    sh_status_e status = map_range( extent, fd, prot, flags, 0, length );
+
+    if ( status != SH_OK ) {
+
+        munmap( extent->array, size );
+        extent->array = NULL;
+        return status;
+
+    }
+
+    extent->size = size;
+    extent->slots = size >> SZ_SHIFT;
+    extent->limit = ( length == size ) ? extent->slots >> 1 : length >> SZ_SHIFT;
+    advise_extent( extent );
     return SH_OK;
 }
 
 
+/*
+    release_extents -- unmaps and frees current extent and earlier mappings
+*/
+static void release_extents(
+
+    extent_s *extent    // pointer to current extent -- possibly NULL
+
+)   {
+
+    while ( extent ) {
+
+        extent_s *prev = extent->prev;
+
+        if ( extent->array ) {
+
+            munmap( extent->array, extent->size );
+
+        }
+
+        free( extent );
+        extent = prev;
+    }
+}
+
+
 /*
     create_base_object -- creates and initializes base shared memory object
 
     effects:
 
     creates base structure with an extent that maps to an intitial allocation
-    of shared memory
+    of shared memory of at least initial bytes, in steps of a huge page if the
+    object is a file on hugetlbfs or huge is true, and the object grows by
+    that step after
+
+    Note:  transparent huge pages are used for other objects when huge is
+    true, if allowed for shared memory by the system
 
     returns sh_status_e:
     SH_OK           successful allocation/initialization
@@ -428,7 +643,9 @@ extern sh_status_e create_base_object(
     char const * const name,// name of base as a null terminated string -- not NULL
     char const * const tag, // tag to initialize base shared memory structure
     int tag_len,            // length of tag
-    long version            // version for memory layout
+    long version,           // version for memory layout
+    bool huge,              // true to back object with huge pages
+    size_t initial          // initial size in bytes, 0 for default
 
 )   {
 
@@ -447,30 +664,38 @@ extern sh_status_e create_base_object(
 
     }
 
-    status = allocate_shared_memory( *base, name, PAGE_SIZE );
+    long mapped = PAGE_SIZE;
+    status = allocate_shared_memory( *base, name, huge, initial, &mapped );
     if ( status != SH_OK ) {
 
+        free( (*base)->name );
         free( *base );
         *base = NULL;
         return status;
 
     }
 
-    status = create_extent( &(*base)->current, PAGE_SIZE >> SZ_SHIFT,
-                            (*base)->fd, (*base)->prot, (*base)->flags );
+    (*base)->current = calloc( 1, sizeof(extent_s) );
+    status = ( (*base)->current == NULL ) ? SH_ERR_NOMEM :
+             map_extent( (*base)->current, (*base)->fd, (*base)->prot,
+                         (*base)->flags, mapped );
     if ( status != SH_OK ) {
 
+        free( (*base)->current );
+        close( (*base)->fd );
+        unlink_object( name );
+        free( (*base)->name );
         free( *base );
         *base = NULL;
         return status;
 
     }
 
-    (*base)->prev = (*base)->current;
-
     // initialize base shared memory object
-    (*base)->current->array[ SIZE ] = (*base)->current->slots;
-    (*base)->current->array[ EXPAND_SIZE ] = (*base)->current->size;
+    (*base)->current->array[ SIZE ] = mapped >> SZ_SHIFT;
+    (*base)->current->array[ EXPAND_SIZE ] = mapped;
+    (*base)->current->array[ GRANULE ] = object_granule( (*base)->fd, huge );
+    advise_extent( (*base)->current );
     (*base)->current->array[ DATA_ALLOC ] = BASE;
     (*base)->current->array[ VERSION ] = version;
     memcpy(&(*base)->current->array[ TAG ], tag, tag_len);
@@ -497,7 +722,7 @@ extern void prime_list(
     long *array = base->current->array;
     view_s view = alloc_new_data( base, slot_count );
     array[ head ] = view.slot;
-    array[ head_counter ] = AFA( &array[ ID_CNTR ], 1 );
+    array[ head_counter ] = tail;   // generation sequence 0 tagged with list
     array[ tail ] = view.slot;
     array[ tail_counter ] = array[ head_counter ];
 
@@ -527,102 +752,103 @@ extern void init_data_allocator(
 
 
 /*
-    resize_extent -- resize current mapped extent to match shared memory
-    object size
+    calculate_realloc_size -- calculate size needed based on requested number
+    of slots, in steps of the size object grows by
 
-    effects:
+    returns new granule aligned size
+*/
+static long calculate_realloc_size(
 
-    if the underlying shared memory object has been expanded, a new extent
-    is created and appended as the current extent at the end of linked list
-    of recent extents
+    extent_s *extent,   // pointer to current extent -- not NULL
+    long slots          // number of slots to allocate
 
-    returns view_s where view.status:
+)   {
 
-    SH_OK           if view reflects latest state of current extent
-    SH_ERR_NOMEM    if not enough memory to resize extent to match shared memory
+    long granule = extent->array[ GRANULE ];
+    long needed = ( ( slots << SZ_SHIFT ) / granule ) + 1;
+    return ( extent->array[ SIZE ] << SZ_SHIFT ) + ( needed * granule );
+}
+
+
+/*
+    remap_extent -- grows mapping of object in place while it fits in half of
+    the reserved address space, otherwise, maps object again over a larger
+    reserved address space
+
+    Note:  the earlier mapping stays valid for the range it covers and is kept
+    until close, as other threads of the process may still be using it, so a
+    failed remap leaves the current extent in place
 */
-extern view_s resize_extent(
+extern void remap_extent(
 
     shr_base_s *base,   // pointer to base struct -- not NULL
-    extent_s *extent    // pointer to working extent -- not NULL
+    long bytes          // size in bytes the new mapping must hold
 
 )   {
 
-    view_s view = { .status = SH_OK, .slot =  0, .extent = base->current };
-
-    // did another thread change current extent?
-    if ( extent != view.extent ) {
-
-        return view;
+    extent_s *extent = base->current;
 
-    }
+    if ( bytes <= ( extent->size >> 1 ) ) {
 
-    // did another process change size of shared object?
-    long *array = view.extent->array;
-    if ( extent->slots == array[ SIZE ] ) {
+        long limit = __atomic_load_n( &extent->limit, __ATOMIC_ACQUIRE );
 
-        // no, return current view
-        return view;
+        // ranges mapped concurrently by other threads map the same pages
+        if ( ( bytes >> SZ_SHIFT ) <= limit ||
+             map_range( extent, base->fd, base->prot, base->flags,
+                        limit << SZ_SHIFT, bytes ) != SH_OK ) {
 
-    }
+            return;
 
-    // allocate next extent
-    extent_s *next = NULL;
-    view.status = create_extent( &next, array[ SIZE ], base->fd, base->prot,
-                                 base->flags );
-    if ( view.status != SH_OK ) {
+        }
 
-        return view;
+        while ( limit < ( bytes >> SZ_SHIFT ) &&
+                !__atomic_compare_exchange_n( &extent->limit, &limit,
+                                              bytes >> SZ_SHIFT, false,
+                                              __ATOMIC_RELEASE,
+                                              __ATOMIC_ACQUIRE ) );
+        return;
 
     }
 
-    // update current extent
-    extent_s *tail = view.extent;
+    extent_s *next = calloc( 1, sizeof(extent_s) );
 
-    if ( CAS( (long*) &tail->next, (long*) &null, (long) next ) ) {
+    if ( next == NULL ) {
 
-        CAS( (long*) &base->current, (long*) &tail, (long) next );
-
-    } else {
-
-        CAS( (long*) &base->current, (long*) &tail, (long) tail->next );
-        munmap( next->array, next->size );
-        free( next );
+        return;
 
     }
 
-    view.extent = base->current;
-    return view;
-}
+    if ( map_extent( next, base->fd, base->prot, base->flags, bytes ) != SH_OK ) {
 
+        free( next );
+        return;
 
-/*
-    calculate_realloc_size -- calculate page size needed based on
-    requested number of slots
+    }
 
-    returns new page aligned size
-*/
-static long calculate_realloc_size(
+    next->prev = extent;
 
-    extent_s *extent,   // pointer to current extent -- not NULL
-    long slots          // number of slots to allocate
+    if ( !__atomic_compare_exchange_n( &base->current, &extent, next, false,
+                                       __ATOMIC_RELEASE, __ATOMIC_RELAXED ) ) {
 
-)   {
+        munmap( next->array, next->size );
+        free( next );
 
-    // divide by page size
-    long current_pages = extent->size >> 12;
-    long needed_pages = ( (slots << SZ_SHIFT) >> 12 ) + 1;
-    return ( current_pages + needed_pages ) * PAGE_SIZE;
+    }
 }
 
 
 /*
     expand -- expand the shared memory object without locking
 
+    Note:  the mapping of the object covers a reserved address space, so growth
+    by any process is visible without remapping until the object needs more
+    than half the reserved range, when the object is mapped again, except on
+    hugetlbfs where the mapping grows in place with the object
+
     returns view_s where view.status:
 
-    SH_OK           if view reflects latest state of current extent
-    SH_ERR_NOMEM    if not enough memory to resize extent to match shared memory
+    SH_OK           if object was expanded by caller or another process
+    SH_ERR_NOMEM    if not enough memory, or address space to map object
 */
 extern view_s expand(
 
@@ -637,99 +863,50 @@ extern view_s expand(
     assert(slots > 0);
 
     view_s view = { .status = SH_OK, .extent = extent };
-
-    if ( extent != base->current ) {
-
-        view.extent = base->current;
-        return view;
-
-    }
-
     atomictype *array = (atomictype*) extent->array;
-    if ( extent->slots != array[ SIZE ] ) {
-
-        return resize_extent( (shr_base_s*) base, extent );
-
-    }
-
     long size = calculate_realloc_size( extent, slots );
     long prev = array[ SIZE ] << SZ_SHIFT;
+    long from = prev;
 
-    // attempt to update expansion size
-    if ( size > prev ) {
-
-        CAS( &array[ EXPAND_SIZE ], &prev, size );
+    if ( size > extent->size ) {
 
-    }
-
-    // attempt to extend shared memory
-    while ( ftruncate( base->fd, array[ EXPAND_SIZE ] ) < 0 ) {
+        remap_extent( base, size );
+        extent = base->current;
 
-        if ( errno != EINTR ) {
+        if ( size > extent->size ) {
 
             view.status = SH_ERR_NOMEM;
             return view;
 
         }
 
+        view.extent = extent;
     }
 
-    // attempt to update size with reallocated value
-    prev >>= SZ_SHIFT;
-    CAS( &array[ SIZE ], &prev, array[ EXPAND_SIZE ] >> SZ_SHIFT );
-
-    if ( extent->slots != array[ SIZE ] ) {
-
-        view = resize_extent( (shr_base_s*) base, extent );
-
-    }
-
-    return view;
-}
-
-
-/*
-    insure_in_range -- validates that slot is within the current extent
-
-    effects:
-
-    updates current extent if specified slot exceeds size of current extent
-
-    returns view_s with view_s.status:
-
-    SH_OK           slot is in current extent
-    SH_ERR_NOMEM    not enough memory to map slot into extent
-*/
-extern view_s insure_in_range(
-
-    shr_base_s *base,   // pointer to base struct -- not NULL
-    long slot           // starting slot
-
-)   {
-
-    assert(base != NULL);
-    assert(slot > 0);
+    // attempt to update expansion size
+    CAS( &array[ EXPAND_SIZE ], &prev, size );
 
-    if ( slot < base->current->slots ) {
+    // attempt to extend shared memory
+    if ( size_object( base->fd, from, array[ EXPAND_SIZE ] ) < 0 ) {
 
-        return (view_s) { .status = SH_OK, .slot = slot, .extent = base->current };
+        view.status = SH_ERR_NOMEM;
+        return view;
 
     }
 
-    view_s view = resize_extent( base, base->current) ;
-    if ( view.status == SH_OK ) {
-
-        view.slot = slot;
-
-    }
+    // attempt to update size with reallocated value
+    from >>= SZ_SHIFT;
+    CAS( &array[ SIZE ], &from, array[ EXPAND_SIZE ] >> SZ_SHIFT );
 
+    sync_extent( base );
+    view.extent = base->current;
     return view;
 }
 
 
 /*
     insure_fit -- validates that the number of slots at start are in range
-    of current extent
+    of shared memory object
 
     effects:
 
@@ -738,8 +915,8 @@ extern view_s insure_in_range(
 
     returns view_s with view_s.status:
 
-    SH_OK           slot is in current extent
-    SH_ERR_NOMEM    not enough memory to map slot into extent
+    SH_OK           slot range is in object
+    SH_ERR_NOMEM    not enough memory to expand object
 */
 static inline view_s insure_fit(
 
@@ -756,7 +933,7 @@ static inline view_s insure_fit(
     view_s view = { .status = SH_OK, .slot = 0, .extent = base->current };
     long end = start + slots;
 
-    while ( end >= view.extent->slots ) {
+    while ( end >= view.extent->array[ SIZE ] ) {
 
         view = expand( (shr_base_s*) base, view.extent, slots );
 
@@ -767,6 +944,8 @@ static inline view_s insure_fit(
         }
     }
 
+    // object may have been grown past the mapping by another process
+    sync_extent( base );
     view.extent = base->current;
     view.slot = start;
     return view;
@@ -882,44 +1061,451 @@ extern void update_buffer_size(
 
 
 /*
-    add_end -- lock-free append memory to end of linked list
+    init_gate -- initializes gate with the specified number of tokens
+*/
+extern void init_gate(
+
+    long *gate,         // pointer to gate slots -- not NULL
+    long value          // initial token count
+
+)   {
+
+    memset( gate, 0, GATE_SIZE << SZ_SHIFT );
+    gate[ GATE_VALUE ] = value;
+}
+
+
+/*
+    gate_try -- non-blocking claim of tokens from gate
 
     effect:
 
-    memory at slot is appended to last item in list and the tail
-    reference is also updated to point to newly added item
+    if at least min tokens are available, up to max tokens are removed from
+    the gate, otherwise, no change to gate
 
+    returns number of tokens claimed, or 0 if less than min available
 */
-extern void add_end(
+extern long gate_try(
 
-    shr_base_s *base,   // pointer to base struct -- not NULL
-    long slot,          // slot reference
-    long tail           // tail slot of list
+    atomictype *gate,   // pointer to gate slots -- not NULL
+    long min,           // minimum tokens required -- greater than 0
+    long max            // maximum tokens wanted -- not less than min
 
 )   {
 
-    // assert(base != NULL);
-    // assert(slot >= BASE);
-    // assert(tail > 0);
+    long value = gate[ GATE_VALUE ];
 
-    atomictype * volatile array = (atomictype*) base->current->array;
-    long gen = AFA( &array[ ID_CNTR ], 1 );
-    array[ slot ] = slot;
-    array[ slot + 1 ] = gen;
-    DWORD next_after = { .low = slot, .high = gen };
+    while ( value >= min ) {
 
-    while( true ) {
+        long claim = ( value < max ) ? value : max;
 
-        DWORD tail_before = *( (DWORD * volatile) &array[ tail ] );
-        long next = tail_before.low;
-        view_s view = insure_in_range( base, next );
-        array = (atomictype * volatile) view.extent->array;
+        if ( CAS( &gate[ GATE_VALUE ], &value, value - claim ) ) {
 
-        if ( tail_before.low == array[ next ] ) {
+            return claim;
+
+        }
+
+        value = gate[ GATE_VALUE ];
+    }
+
+    return 0;
+}
+
+
+/*
+    gate_wait -- claim a single token from gate, blocking until one is
+    available or the deadline passes
+
+    Spins briefly before registering as a waiter and sleeping on the gate
+    futex word.  The futex is shared so waiters in any process attached to the
+    memory are woken by gate_post.
+
+    returns true if token claimed, otherwise, false if deadline passed
+*/
+extern bool gate_wait(
+
+    atomictype *gate,           // pointer to gate slots -- not NULL
+    struct timespec *deadline   // absolute CLOCK_MONOTONIC time, or NULL
+
+)   {
+
+    for ( int i = 0; i < GATE_SPINS; i++ ) {
+
+        if ( gate_try( gate, 1, 1 ) ) {
+
+            return true;
+
+        }
+    }
+
+    int *futex = (int*) &gate[ GATE_FUTEX ];
+    bool claimed = false;
+
+    (void) AFA( &gate[ GATE_WAITERS ], 1 );
+
+    while ( true ) {
+
+        int seq = *(volatile int*) futex;
+
+        if ( gate_try( gate, 1, 1 ) ) {
+
+            claimed = true;
+            break;
+
+        }
+
+        long rc = syscall( SYS_futex, futex, FUTEX_WAIT_BITSET, seq, deadline,
+                           NULL, FUTEX_BITSET_MATCH_ANY );
+
+        if ( rc < 0 && errno == ETIMEDOUT ) {
+
+            claimed = ( gate_try( gate, 1, 1 ) > 0 );
+            break;
+
+        }
+    }
+
+    (void) AFS( &gate[ GATE_WAITERS ], 1 );
+
+    return claimed;
+}
+
+
+/*
+    ready_gate -- index of first gate with tokens available
+
+    returns index of gate, or -1 if no tokens available on any gate
+*/
+static int ready_gate(
+
+    atomictype **gates,         // array of pointers to gate slots -- not NULL
+    int count                   // number of gates
+
+)   {
+
+    for ( int i = 0; i < count; i++ ) {
+
+        if ( gates[ i ][ GATE_VALUE ] > 0 ) {
+
+            return i;
+
+        }
+    }
+
+    return -1;
+}
+
+
+/*
+    select_slice -- sleep on futex word of first gate until a post to it, the
+    deadline, or the end of a short slice, for kernels without futex_waitv
+*/
+static void select_slice(
+
+    int *futex,                 // futex word of first gate -- not NULL
+    int seq,                    // expected futex sequence value
+    struct timespec *deadline   // absolute CLOCK_MONOTONIC time, or NULL
+
+)   {
+
+    struct timespec slice;
+    clock_gettime( CLOCK_MONOTONIC, &slice );
+    slice.tv_nsec += SELECT_SLICE;
+    if ( slice.tv_nsec >= 1000000000 ) {
+
+        slice.tv_sec++;
+        slice.tv_nsec -= 1000000000;
+
+    }
+
+    if ( deadline != NULL && ( deadline->tv_sec < slice.tv_sec ||
+         ( deadline->tv_sec == slice.tv_sec && deadline->tv_nsec < slice.tv_nsec ) ) ) {
+
+        slice = *deadline;
+
+    }
+
+    (void) syscall( SYS_futex, futex, FUTEX_WAIT_BITSET, seq, &slice, NULL,
+                    FUTEX_BITSET_MATCH_ANY );
+}
+
+
+/*
+    gate_select -- wait until any of several gates has a token available,
+    without claiming it
+
+    Registers as a selector on every gate and sleeps on all of the gate futex
+    words at once with futex_waitv, so a post to any gate wakes the caller.
+    Where futex_waitv is not available, sleeps on the first gate and checks
+    the others at short intervals.
+
+    returns index of first gate found with tokens available, or -1 if the
+    deadline passed
+*/
+extern int gate_select(
+
+    atomictype **gates,         // array of pointers to gate slots -- not NULL
+    int count,                  // number of gates -- 1 to SELECT_MAX
+    struct timespec *deadline   // absolute CLOCK_MONOTONIC time, or NULL
+
+)   {
+
+    int index = ready_gate( gates, count );
+
+    if ( index >= 0 ) {
+
+        return index;
+
+    }
+
+#ifdef SYS_futex_waitv
+    struct futex_waitv waiters[ SELECT_MAX ];
+    memset( waiters, 0, count * sizeof(struct futex_waitv) );
+    bool waitv = true;
+#endif
+
+    for ( int i = 0; i < count; i++ ) {
+
+        (void) AFA( &gates[ i ][ GATE_SELECTS ], 1 );
+
+    }
+
+    while ( true ) {
+
+        int seq = *(volatile int*) &gates[ 0 ][ GATE_FUTEX ];
+
+#ifdef SYS_futex_waitv
+        for ( int i = 0; i < count; i++ ) {
+
+            waiters[ i ].uaddr = (uintptr_t) &gates[ i ][ GATE_FUTEX ];
+            waiters[ i ].val = *(volatile int*) &gates[ i ][ GATE_FUTEX ];
+            waiters[ i ].flags = FUTEX_32;
+
+        }
+#endif
+
+        index = ready_gate( gates, count );
+
+        if ( index >= 0 ) {
+
+            break;
+
+        }
+
+        if ( deadline != NULL ) {
+
+            struct timespec now;
+            clock_gettime( CLOCK_MONOTONIC, &now );
+
+            if ( now.tv_sec > deadline->tv_sec || ( now.tv_sec == deadline->tv_sec &&
+                 now.tv_nsec >= deadline->tv_nsec ) ) {
+
+                break;
+
+            }
+        }
+
+#ifdef SYS_futex_waitv
+        if ( waitv ) {
+
+            long rc = syscall( SYS_futex_waitv, waiters, count, 0, deadline,
+                               CLOCK_MONOTONIC );
+
+            if ( rc < 0 && errno == ENOSYS ) {
+
+                waitv = false;
+
+            }
+
+            continue;
+        }
+#endif
+
+        select_slice( (int*) &gates[ 0 ][ GATE_FUTEX ], seq, deadline );
+    }
+
+    for ( int i = 0; i < count; i++ ) {
+
+        (void) AFS( &gates[ i ][ GATE_SELECTS ], 1 );
+
+    }
+
+    return index;
+}
+
+
+/*
+    gate_post -- make tokens available on gate, waking blocked callers only if
+    there are any, and every selector along with them since a selector does
+    not claim the token it is woken for
+*/
+extern void gate_post(
+
+    atomictype *gate,   // pointer to gate slots -- not NULL
+    long count          // number of tokens to make available
+
+)   {
+
+    (void) AFA( &gate[ GATE_VALUE ], count );
+
+    if ( gate[ GATE_SELECTS ] > 0 ) {
+
+        int *futex = (int*) &gate[ GATE_FUTEX ];
+        (void) __sync_fetch_and_add( futex, 1 );
+        (void) syscall( SYS_futex, futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+
+    } else if ( gate[ GATE_WAITERS ] > 0 ) {
+
+        int *futex = (int*) &gate[ GATE_FUTEX ];
+        (void) __sync_fetch_and_add( futex, 1 );
+        (void) syscall( SYS_futex, futex, FUTEX_WAKE,
+                        ( count < INT_MAX ) ? (int) count : INT_MAX,
+                        NULL, NULL, 0 );
+
+    }
+}
+
+
+/*
+    watch_wait -- block until watched slot no longer holds value or the
+    deadline passes
+
+    Note:  the futex sequence is read before the slot is checked, and a
+    change to the slot is followed by watch_post, so a change is not missed
+    between the check and sleeping
+
+    returns true if slot changed, otherwise, false if deadline passed
+*/
+extern bool watch_wait(
+
+    atomictype *watch,          // pointer to watch slots -- not NULL
+    atomictype *word,           // pointer to slot watched -- not NULL
+    long value,                 // value slot is expected to leave
+    struct timespec *deadline   // absolute CLOCK_MONOTONIC time, or NULL
+
+)   {
+
+    int *futex = (int*) &watch[ WATCH_FUTEX ];
+    bool changed = true;
+
+    (void) AFA( &watch[ WATCH_WAITERS ], 1 );
+
+    while ( true ) {
+
+        int seq = *(volatile int*) futex;
+
+        if ( LOAD_ACQ( word ) != value ) {
+
+            break;
+
+        }
+
+        long rc = syscall( SYS_futex, futex, FUTEX_WAIT_BITSET, seq, deadline,
+                           NULL, FUTEX_BITSET_MATCH_ANY );
+
+        if ( rc < 0 && errno == ETIMEDOUT ) {
+
+            changed = ( LOAD_ACQ( word ) != value );
+            break;
+
+        }
+    }
+
+    (void) AFS( &watch[ WATCH_WAITERS ], 1 );
+
+    return changed;
+}
+
+
+/*
+    watch_post -- wake callers blocked on watch after watched slot changed
+*/
+extern void watch_post(
+
+    atomictype *watch   // pointer to watch slots -- not NULL
+
+)   {
+
+    // order change of watched slot before the check for waiters
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+
+    if ( watch[ WATCH_WAITERS ] > 0 ) {
+
+        int *futex = (int*) &watch[ WATCH_FUTEX ];
+        (void) __sync_fetch_and_add( futex, 1 );
+        (void) syscall( SYS_futex, futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+
+    }
+}
+
+
+/*
+    add_chain_end -- lock-free append of multiple nodes to end of linked list
+
+    effect:
+
+    nodes referenced by the slots array are linked together privately in array
+    order, the resulting chain is appended to last item in list with a single
+    atomic update, and the tail reference is updated to point to the last node
+    in the chain
+
+    Note:  on 64-bit, link generations continue the sequence of the current
+    tail and are tagged with the list tail slot, so no shared counter is
+    touched and a node moved to another list can not carry a matching
+    generation -- on 32-bit a tagged sequence would wrap after 2^21 appends,
+    so generations are taken from the full width shared counter instead
+
+*/
+extern void add_chain_end(
+
+    shr_base_s *base,   // pointer to base struct -- not NULL
+    long *slots,        // array of slot references -- not NULL
+    long count,         // number of slots in array -- greater than 0
+    long tail           // tail slot of list
+
+)   {
+
+    // assert(base != NULL);
+    // assert(slots != NULL);
+    // assert(count > 0);
+    // assert(tail > 0 && tail < GEN_STRIDE);
+
+    long last = slots[ count - 1 ];
+    atomictype * volatile array = (atomictype * volatile) base->current->array;
+#ifndef __x86_64__
+    long gen = AFA( &array[ ID_CNTR ], count );
+    const long step = 1;
+#else
+    const long step = GEN_STRIDE;
+#endif
+
+    while( true ) {
+
+        DWORD tail_before = *( (DWORD * volatile) &array[ tail ] );
+        long next = tail_before.low;
+
+        if ( tail_before.low == array[ next ] ) {
+
+            // link chain privately, each link carries generation of next node
+#ifdef __x86_64__
+            long gen = tail_before.high + GEN_STRIDE;
+#endif
+
+            for ( long i = 0; i < count - 1; i++ ) {
+
+                array[ slots[ i ] ] = slots[ i + 1 ];
+                array[ slots[ i ] + 1 ] = gen + ( ( i + 1 ) * step );
+
+            }
+
+            array[ last ] = last;
+            array[ last + 1 ] = gen + ( ( count - 1 ) * step );
+            DWORD next_after = { .low = slots[ 0 ], .high = gen };
+            DWORD last_after = { .low = last, .high = array[ last + 1 ] };
 
             if ( DWCAS( (DWORD*) &array[ next ], &tail_before, next_after ) ) {
 
-                DWCAS( (DWORD*) &array[ tail ], &tail_before, next_after );
+                DWCAS( (DWORD*) &array[ tail ], &tail_before, last_after );
                 return;
 
             }
@@ -934,6 +1520,27 @@ extern void add_end(
 }
 
 
+/*
+    add_end -- lock-free append memory to end of linked list
+
+    effect:
+
+    memory at slot is appended to last item in list and the tail
+    reference is also updated to point to newly added item
+
+*/
+extern void add_end(
+
+    shr_base_s *base,   // pointer to base struct -- not NULL
+    long slot,          // slot reference
+    long tail           // tail slot of list
+
+)   {
+
+    add_chain_end( base, &slot, 1, tail );
+}
+
+
 /*
     remove_front -- lock-free remove memory from front of linked list
 
@@ -963,8 +1570,6 @@ extern long remove_front(
 
     if ( ref >= BASE && ref != array[ tail ] ) {
 
-        view_s view = insure_in_range( base, ref );
-        array = view.extent->array;
         after.low = array[ ref ];
         before.high = gen;
         after.high = before.high + 1;
@@ -983,6 +1588,84 @@ extern long remove_front(
 }
 
 
+/*
+    remove_front_chain -- lock-free remove of multiple nodes from front of
+    linked list
+
+    effect:
+
+    up to max nodes are removed from front of list with a single atomic update
+    of the head, the first two slots of each node removed are zeroed out, and
+    the slots array is filled with the references of the removed nodes
+
+    returns number of nodes removed, 0 if list empty or head changed
+*/
+extern long remove_front_chain(
+
+    shr_base_s *base,   // pointer to base struct -- not NULL
+    long *slots,        // array to hold removed slot references -- not NULL
+    long max,           // maximum nodes to remove -- greater than 0
+    long head,          // head slot of list
+    long tail           // tail slot of list
+
+)   {
+
+    assert(base != NULL);
+
+    volatile long * volatile array = base->current->array;
+    long gen = array[ head + 1 ];
+    long ref = array[ head ];
+    long node = ref;
+    long count = 0;
+
+    // walk chain, nodes can not be recycled unless head moves, which will
+    // cause the update of the head to fail
+    while ( count < max && node >= BASE && node != array[ tail ] ) {
+
+        if ( node + 1 >= array[ SIZE ] ) {
+
+            return 0;
+
+        }
+
+        long next = array[ node ];
+
+        if ( next == node ) {
+
+            break;
+
+        }
+
+        slots[ count++ ] = node;
+        node = next;
+
+    }
+
+    if ( count == 0 || node < BASE ) {
+
+        return 0;
+
+    }
+
+    DWORD before = { .low = ref, .high = gen };
+    DWORD after = { .low = node, .high = gen + 1 };
+
+    if ( !DWCAS( (DWORD*) &array[ head ], &before, after ) ) {
+
+        return 0;
+
+    }
+
+    for ( long i = 0; i < count; i++ ) {
+
+        memset( (void*) &array[ slots[ i ] ], 0, 2 << SZ_SHIFT );
+
+    }
+
+    return count;
+}
+
+
 /*
     alloc_new_data -- allocates the number of required slots by advancing the
     data allocaction counter from previously unused space in share memory
@@ -1080,6 +1763,34 @@ static view_s realloc_pooled_mem(
 }
 
 
+/*
+    alloc_pooled_slots -- allocate fixed size node from the free node list
+    specified, or from unused space if list is empty
+*/
+extern view_s alloc_pooled_slots(
+
+    shr_base_s *base,           // pointer to base struct -- not NULL
+    long slot_count,            // size of node as number of slots
+    long head,                  // list head slot
+    long head_counter,          // list head counter slot
+    long tail                   // list tail slot
+
+)   {
+
+    // attempt to remove from free node list
+    view_s view = realloc_pooled_mem( base, slot_count, head, head_counter, tail );
+    if ( view.slot != 0 ) {
+
+        return view;
+
+    }
+
+    // attempt to allocate new node from current extent
+    view = alloc_new_data( base, slot_count );
+    return view;
+}
+
+
 /*
     alloc_idx_slots -- allocate idx node slots
 */
@@ -1089,31 +1800,51 @@ extern view_s alloc_idx_slots(
 
 )   {
 
-    // attempt to remove from free index node list
-    view_s view = realloc_pooled_mem( base, IDX_SIZE, FREE_HEAD, FREE_HD_CNT, FREE_TAIL );
-    if ( view.slot != 0 ) {
+    return alloc_pooled_slots( base, IDX_SIZE, FREE_HEAD, FREE_HD_CNT, FREE_TAIL );
+}
 
-        return view;
 
-    }
+/*
+    data_class -- index of size class of a data allocation, where each power
+    of 2 is split into SIZE_CLASSES evenly spaced sizes, starting from a size
+    of SIZE_CLASSES slots
 
-    // attempt to allocate new node from current extent
-    view = alloc_new_data( base, IDX_SIZE );
-    return view;
+    Note:  slots must be a class size, such as returned by round_data_slots
+*/
+static inline long data_class(
+
+    long slots          // number of slots in allocation
+
+)   {
+
+    long shift = ( LONG_BIT - 1 - __builtin_clzl( slots ) ) - CLASS_BITS;
+    return ( shift * SIZE_CLASSES ) + ( slots >> shift ) - SIZE_CLASSES;
 }
 
 
-extern sh_status_e free_data_slots(
+/*
+    class_slots -- number of slots in data allocation of size class index
+*/
+static inline long class_slots(
 
-    shr_base_s *base,   // pointer to base struct -- not NULL
-    long slot           // start of slot range
+    long index          // index of size class
 
 )   {
 
-    long *array = base->current->array;
-    long count = array[ slot ];
-    long index = __builtin_ctzl( count ) - 2;
-    long bucket = MEM_BKT_START + ( index * 2 );
+    return ( SIZE_CLASSES + ( index % SIZE_CLASSES ) ) << ( index / SIZE_CLASSES );
+}
+
+
+/*
+    push_bucket -- lock-free push of data allocation onto memory bucket stack
+*/
+static void push_bucket(
+
+    long *array,        // pointer to base array -- not NULL
+    long bucket,        // memory bucket slot
+    long slot           // start of data allocation
+
+)   {
 
     DWORD after = { .low = slot };
 
@@ -1126,6 +1857,55 @@ extern sh_status_e free_data_slots(
         after.high = array[ slot + 1 ] + 1;
 
     } while ( !DWCAS( (DWORD*) &array[ bucket ], (DWORD*) &array[ slot ], after ) ); // push down stack
+}
+
+
+/*
+    pop_bucket -- lock-free pop of data allocation from memory bucket stack
+
+    returns start of data allocation, otherwise 0 if bucket is empty
+*/
+static long pop_bucket(
+
+    long *array,        // pointer to base array -- not NULL
+    long bucket         // memory bucket slot
+
+)   {
+
+    DWORD before;
+    DWORD after;
+
+    do {
+
+        before.low = array[ bucket ];
+        before.high = array[ bucket + 1 ];
+
+        if ( before.low == 0 ) {
+
+            return 0;
+
+        }
+
+        after.low = (volatile long) array[ before.low ];
+        after.high = before.high + 1;
+
+    } while ( !DWCAS( (DWORD*) &array[ bucket ], &before, after ) );
+
+    return before.low;
+}
+
+
+extern sh_status_e free_data_slots(
+
+    shr_base_s *base,   // pointer to base struct -- not NULL
+    long slot           // start of slot range
+
+)   {
+
+    long *array = base->current->array;
+    long index = data_class( array[ slot ] );
+
+    push_bucket( array, MEM_BKT_START + ( index * 2 ), slot );
 
     return SH_OK;
 }
@@ -1140,21 +1920,22 @@ extern sh_status_e free_data_slots(
 static long find_first_fit(
 
     shr_base_s *base,   // pointer to base struct -- not NULL
-    long count          // number of slots to return
+    long count,         // number of slots to return
+    long start          // start of free or released memory bucket slots
 
 )   {
 
-    if (count < 4) {
+    if ( count < SIZE_CLASSES ) {
 
         return 0;
 
     }
 
-    long index = __builtin_ctzl( count ) - 2;
+    long index = data_class( count );
     
-    for ( int retries = 3; retries && index < MEM_SLOTS; retries--, index++ ) {
+    for ( int retries = FIT_CLASSES; retries && index < MEM_SLOTS; retries--, index++ ) {
 
-        long bucket = MEM_BKT_START + ( 2 * index );
+        long bucket = start + ( 2 * index );
         
         if ( base->current->array[ bucket ] != 0 ) {
 
@@ -1170,7 +1951,8 @@ static long find_first_fit(
 /*
     lookup_freed_data -- looks for bucket that has first available
     allocation that is larger than requested numbers slots and
-    attempts to allocate from leaf
+    attempts to allocate from leaf, falling back to allocations whose
+    memory was released, which are backed again before reuse
 
     returns index slot of allocated memory, otherwise, 0
 */
@@ -1181,38 +1963,70 @@ static long lookup_freed_data(
 
 )   {
 
-    DWORD before;
-    DWORD after;
+    long *array = base->current->array;
+    long bucket = find_first_fit( base, slots, MEM_BKT_START );
+
+    if ( bucket != 0 ) {
+
+        long slot = pop_bucket( array, bucket );
+
+        if ( slot != 0 ) {
+
+            array[ slot ] = class_slots( ( bucket - MEM_BKT_START ) >> 1 );
+
+        }
 
-    long bucket = find_first_fit( base, slots );
+        return slot;
+
+    }
+
+    bucket = find_first_fit( base, slots, MEM_REL_START );
     if ( bucket == 0 ) {
 
         return 0;
 
     }
 
-    long *array = base->current->array;
+    long slot = pop_bucket( array, bucket );
+    if ( slot == 0 ) {
 
-    do {
+        return 0;
 
-        before.low = array[ bucket ];
-        before.high = array[ bucket + 1 ];
+    }
 
-        if ( before.low == 0 ) {
+    // writing to a released page of a full file system raises SIGBUS
+    long count = class_slots( ( bucket - MEM_REL_START ) >> 1 );
+    if ( fallocate( base->fd, 0, slot << SZ_SHIFT, count << SZ_SHIFT ) < 0 ) {
 
-            return 0;
+        push_bucket( array, bucket, slot );
+        return 0;
 
-        }
+    }
 
-        view_s view = insure_in_range( base, before.low );
-        array = view.extent->array;
-        after.low = (volatile long) array[ before.low ];
-        after.high = before.high + 1;
+    array[ slot ] = count;
+    return slot;
+}
 
-    } while ( !DWCAS( (DWORD*) &array[ bucket ], &before, after ) );
 
-    array[ before.low ] =  1 << ( ( ( bucket - MEM_BKT_START ) >> 1 ) + 2 );
-    return before.low;
+/*
+    round_data_slots -- size of data allocation for a request of slots, which
+    is rounded up to the next size class, so at most 1 / SIZE_CLASSES of an
+    allocation is unused
+*/
+static inline long round_data_slots(
+
+    long slots          // number of slots requested
+
+)   {
+
+    if ( slots <= SIZE_CLASSES ) {
+
+        return SIZE_CLASSES;
+
+    }
+
+    long step = 1L << ( ( LONG_BIT - 1 - __builtin_clzl( slots ) ) - CLASS_BITS );
+    return ( slots + step - 1 ) & ~( step - 1 );
 }
 
 
@@ -1266,14 +2080,7 @@ extern view_s alloc_data_slots(
 
 )   {
 
-    // check to see if power of 2 to reduce fragmentation
-    if ( __builtin_popcountl( slots ) > 1 ) {
-
-        // round up to next power of 2
-        slots = 1 << (LONG_BIT - __builtin_clzl( slots ) );
-
-    }
-
+    slots = round_data_slots( slots );
     view_s view = realloc_data_slots( base, slots );
 
     if ( view.slot != 0 ) {
@@ -1287,34 +2094,183 @@ extern view_s alloc_data_slots(
 }
 
 
-extern void release_prev_extents(
+/*
+    carve_pooled_slots -- carves count fixed size nodes from unused space in
+    a single allocation and appends them to the free node list specified
 
-    shr_base_s *base    // pointer to base struct -- not NULL
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+*/
+extern sh_status_e carve_pooled_slots(
+
+    shr_base_s *base,   // pointer to base struct -- not NULL
+    long slot_count,    // size of node as number of slots
+    long count,         // number of nodes to carve
+    long tail           // list tail slot
 
 )   {
 
-    extent_s *head = base->prev;
+    view_s view = alloc_new_data( base, count * slot_count );
 
-    while ( head != base->current ) {
+    if ( view.slot == 0 ) {
 
-        if ( base->accessors > 1 ) {
+        return SH_ERR_NOMEM;
 
-            return;
+    }
+
+    long slots[ CARVE_CHUNK ];
+    long node = view.slot;
+
+    while ( count > 0 ) {
+
+        long chunk = ( count < CARVE_CHUNK ) ? count : CARVE_CHUNK;
+
+        for ( long i = 0; i < chunk; i++ ) {
+
+            slots[ i ] = node;
+            node += slot_count;
 
         }
 
-        extent_s *next = head->next;
-        if ( !CAS( (long*) &base->prev, (long*) &head, (long) next ) ) {
+        add_chain_end( base, slots, chunk, tail );
+        count -= chunk;
+    }
 
-            return;
+    return SH_OK;
+}
+
+
+/*
+    carve_data_slots -- carves count data allocations of the size allocated
+    for a request of slots from unused space in a single allocation, and
+    frees them to the memory bucket for that size
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+*/
+extern sh_status_e carve_data_slots(
+
+    shr_base_s *base,   // pointer to base struct -- not NULL
+    long slots,         // number of slots requested per allocation
+    long count          // number of allocations to carve
+
+)   {
+
+    slots = round_data_slots( slots );
+    view_s view = alloc_new_data( base, count * slots );
+
+    if ( view.slot == 0 ) {
+
+        return SH_ERR_NOMEM;
+
+    }
+
+    for ( long i = 0; i < count; i++ ) {
+
+        long slot = view.slot + ( i * slots );
+        base->current->array[ slot ] = slots;
+        free_data_slots( base, slot );
+
+    }
+
+    return SH_OK;
+}
+
+
+/*
+    release_slots -- returns backing memory of the whole granules within a
+    range of slots to the system, after which the range reads as zeroes
+
+    returns number of bytes released
+*/
+static long release_slots(
+
+    shr_base_s *base,   // pointer to base struct -- not NULL
+    long slot,          // start of slot range
+    long slots          // number of slots in range
+
+)   {
+
+    long granule = base->current->array[ GRANULE ];
+    long start = ( ( slot << SZ_SHIFT ) + granule - 1 ) & ~( granule - 1 );
+    long end = ( ( slot + slots ) << SZ_SHIFT ) & ~( granule - 1 );
+
+    if ( end <= start ) {
+
+        return 0;
+
+    }
+
+    if ( fallocate( base->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                    start, end - start ) < 0 ) {
+
+        return 0;
+
+    }
+
+    return end - start;
+}
+
+
+/*
+    release_free_data -- returns backing memory of freed data allocations to
+    the system, keeping the two slot header of each allocation
+
+    Allocations large enough to hold a whole granule are taken off their
+    memory bucket one at a time, so a process ending mid compaction loses at
+    most one allocation, and are moved to the matching released bucket, which
+    is only used once free allocations run out.
+
+    returns number of bytes released
+*/
+extern long release_free_data(
+
+    shr_base_s *base    // pointer to base struct -- not NULL
+
+)   {
+
+    sync_extent( base );
+    long released = 0;
+    long granule_slots = base->current->array[ GRANULE ] >> SZ_SHIFT;
+
+    for ( long index = 0; index < MEM_SLOTS; index++ ) {
+
+        long bucket = MEM_BKT_START + ( 2 * index );
+        long *array = base->current->array;
+
+        // sizes of empty buckets may exceed the range of a long
+        if ( array[ bucket ] == 0 || class_slots( index ) < 2 * granule_slots ) {
+
+            continue;
 
         }
 
-        munmap( head->array, head->size );
-        free( head );
-        head = next;
+        long slots = class_slots( index );
+        long slot;
+
+        while ( ( slot = pop_bucket( array, bucket ) ) != 0 ) {
+
+            long bytes = release_slots( base, slot + 2, slots - 2 );
+
+            if ( bytes == 0 ) {
 
+                // file system can not release memory, leave allocation free
+                push_bucket( array, bucket, slot );
+                break;
+
+            }
+
+            push_bucket( array, MEM_REL_START + ( 2 * index ), slot );
+            released += bytes;
+
+        }
     }
+
+    return released;
 }
 
 
@@ -1342,17 +2298,7 @@ extern sh_status_e release_mapped_memory(
 
 )   {
 
-    if ( (*base)->current ) {
-
-        if ( (*base)->current->array ) {
-
-            munmap( (*base)->current->array, (*base)->current->size );
-
-        }
-
-        free( (*base)->current );
-
-    }
+    release_extents( (*base)->current );
 
     if ( (*base)->fd > 0 ) {
 
@@ -1362,7 +2308,7 @@ extern sh_status_e release_mapped_memory(
 
     if ( (*base)->name ) {
 
-        int rc = shm_unlink( (*base)->name );
+        int rc = unlink_object( (*base)->name );
 
         if ( rc < 0 ) {
 
@@ -1380,15 +2326,14 @@ extern sh_status_e release_mapped_memory(
 extern sh_status_e map_shared_memory(
 
     shr_base_s **base,          // address of base struct pointer-- not NULL
-    char const * const name,    // name as null terminated string -- not NULL
-    size_t size                 // size of shared memory
+    char const * const name     // name as null terminated string -- not NULL
 
 ) {
     (*base)->name = strdup( name );
     (*base)->prot = PROT_READ | PROT_WRITE;
     (*base)->flags = MAP_SHARED;
 
-    (*base)->fd = shm_open( (*base)->name, O_RDWR, FILE_MODE );
+    (*base)->fd = open_object( (*base)->name, O_RDWR );
 
     if ( (*base)->fd < 0 ) {
 
@@ -1398,55 +2343,100 @@ extern sh_status_e map_shared_memory(
 
     }
 
-    while ( true ) {
+    // map size recorded by object, as a file may be larger than the object
+    struct stat statbuf;
+    long size = 0;
+    sh_status_e status = SH_OK;
 
-        (*base)->current->array = mmap( 0, size, (*base)->prot, (*base)->flags,
-                                        (*base)->fd, 0 );
+    if ( fstat( (*base)->fd, &statbuf ) < 0 ) {
 
-        if ( (*base)->current->array == (void*) -1 ) {
+        status = convert_to_status( errno );
 
-            free( (*base)->current );
-            free( *base );
-            *base = NULL;
-            return convert_to_status( errno );
+    } else if ( pread( (*base)->fd, &size, sizeof(long), SIZE << SZ_SHIFT ) !=
+                sizeof(long) || size <= 0 ||
+                size > ( statbuf.st_size >> SZ_SHIFT ) ) {
 
-        }
+        size = statbuf.st_size >> SZ_SHIFT;
 
-        if ( size == (*base)->current->array[ SIZE ] << SZ_SHIFT ) {
+    }
 
-            break;
+    if ( status == SH_OK ) {
 
-        }
+        status = map_extent( (*base)->current, (*base)->fd, (*base)->prot,
+                             (*base)->flags, size << SZ_SHIFT );
+
+    }
+    if ( status != SH_OK ) {
 
-        size_t alt_size = (*base)->current->array[ SIZE ] << SZ_SHIFT;
-        munmap( (*base)->current->array, size );
-        size = alt_size;
+        close( (*base)->fd );
+        free( (*base)->current );
+        free( *base );
+        *base = NULL;
 
     }
 
-    (*base)->current->size = size;
-    (*base)->current->slots = size >> SZ_SHIFT;
-    return SH_OK;
+    return status;
 }
 
 
-extern void close_base(
+/*
+    hold_object -- registers file descriptor of base as holding a file backed
+    object open, and reports whether any other holder remains
+
+    Every holder keeps a shared lock on the first byte of the file, and
+    holders are registered one at a time under a lock on the second byte.
+    If no other holder remains, such as after a crash, the first byte is held
+    exclusively so the caller can repair the object before calling
+    share_object.  The locks belong to the open file, so they are released
+    when it is closed, including when the holding process ends.
+
+    returns true if caller is only holder, otherwise, false
+*/
+extern bool hold_object(
 
     shr_base_s *base    // pointer to base struct -- not NULL
 
 )   {
-    release_prev_extents( base );
 
-    if ( base->current ) {
+    struct flock lock = { .l_type = F_WRLCK, .l_whence = SEEK_SET,
+                          .l_start = 1, .l_len = 1 };
 
-        if ( base->current->array ) {
+    while ( fcntl( base->fd, F_OFD_SETLKW, &lock ) < 0 && errno == EINTR );
 
-            munmap(base->current->array, base->current->size);
+    lock.l_start = 0;
 
-        }
+    return ( fcntl( base->fd, F_OFD_SETLK, &lock ) == 0 );
+}
 
-        free( base->current );
-    }
+
+/*
+    share_object -- completes registration of holder started by hold_object,
+    allowing other holders to register
+*/
+extern void share_object(
+
+    shr_base_s *base    // pointer to base struct -- not NULL
+
+)   {
+
+    struct flock lock = { .l_type = F_RDLCK, .l_whence = SEEK_SET,
+                          .l_start = 0, .l_len = 1 };
+
+    while ( fcntl( base->fd, F_OFD_SETLKW, &lock ) < 0 && errno == EINTR );
+
+    lock.l_type = F_UNLCK;
+    lock.l_start = 1;
+    (void) fcntl( base->fd, F_OFD_SETLK, &lock );
+}
+
+
+extern void close_base(
+
+    shr_base_s *base    // pointer to base struct -- not NULL
+
+)   {
+
+    release_extents( base->current );
 
     if ( base->fd > 0 ) {
 
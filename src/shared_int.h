@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <time.h>
 #include <shared.h>
 
 
@@ -21,28 +22,36 @@ typedef atomic_long atomictype;
 #ifdef __x86_64__
 #define SZ_SHIFT 3
 #define REM 7
+#define RESERVE_SIZE (1L << 36)     // address space reserved for object mapping
 #else
 #define SZ_SHIFT 2
 #define REM 3
+#define RESERVE_SIZE (1L << 26)     // address space reserved for object mapping
 #endif
 
+#ifndef LONG_BIT
 #define LONG_BIT (CHAR_BIT * sizeof(long))
+#endif
 
 // define unchanging file system related constants
 #define FILE_MODE (S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)
-#define SHR_OBJ_DIR "/dev/shm/"
 
 
 // define useful integer constants (mostly sizes and offsets)
 enum shr_constants
 {
     PAGE_SIZE = 4096,       // initial size of memory mapped file
-    MEM_SLOTS = 48,         // number of memory bucket allocation slots
+    HUGE_SIZE = 1 << 21,    // growth step of object backed by transparent huge pages
+    MEM_SLOTS = 128,        // number of memory bucket size classes
+    LINE_SLOTS = ( 64 >> SZ_SHIFT ),    // slots in a cache line
+    GEN_STRIDE = ( 1024 << ( 3 - SZ_SHIFT ) ),  // list generation increment, list tail slots must be lower
+    SELECT_MAX = 128,       // maximum number of gates waited on by a select
 };
 
 
 
-// define shared data structure base offsets
+// define shared data structure base offsets, read mostly values share the
+// first cache line and each word written by every operation has its own line
 enum shr_base_disp
 {
 
@@ -50,19 +59,47 @@ enum shr_base_disp
     VERSION,                                        // implementation version number
     SIZE,                                           // size of queue array
     EXPAND_SIZE,                                    // size for current expansion
-    FREE_HEAD,                                      // free node list head
-    FREE_HD_CNT,                                    // free node head counter
-    DATA_ALLOC,                                     // next available data allocation slot
-    COUNT,                                          // number of items in structure
-    BUFFER,                                         // max buffer size needed to read
     FLAGS,                                          // configuration flag values
-    ID_CNTR,                                        // unique id/generation counter
-    SPARE,                                          // spare slot
-    FREE_TAIL,                                      // free node list tail
+    BUFFER,                                         // max buffer size needed to read
+    ID_CNTR,                                        // handle id counter, 32-bit generations
+    GRANULE,                                        // size in bytes object grows by
+    FREE_HEAD = LINE_SLOTS,                         // free node list head
+    FREE_HD_CNT,                                    // free node head counter
+    FREE_TAIL = 2 * LINE_SLOTS,                     // free node list tail
     FREE_TL_CNT,                                    // free node tail counter
-    MEM_BKT_START,                                  // start of free memory bucket slots
+    DATA_ALLOC = 3 * LINE_SLOTS,                    // next available data allocation slot
+    COUNT = 4 * LINE_SLOTS,                         // number of items in structure
+    MEM_BKT_START = 5 * LINE_SLOTS,                 // start of free memory bucket slots
     MEM_BKT_END = (MEM_BKT_START + (MEM_SLOTS * 2)),    // allocate space for free memory bucket slots
-    BASE = MEM_BKT_END
+    MEM_REL_START = MEM_BKT_END,                    // start of released memory bucket slots
+    MEM_REL_END = (MEM_REL_START + (MEM_SLOTS * 2)),    // allocate space for released memory bucket slots
+    BASE = MEM_REL_END
+
+};
+
+
+// define gate slot offsets, a gate is a count of available tokens with a
+// shared futex word that blocked callers wait on
+enum shr_gate_disp
+{
+
+    GATE_VALUE = 0,         // count of available tokens
+    GATE_WAITERS,           // count of blocked callers
+    GATE_FUTEX,             // futex sequence word (32 bits)
+    GATE_SELECTS,           // count of callers selecting on gate with others
+    GATE_SIZE = 4,          // gate slot count
+
+};
+
+
+// define watch slot offsets, a watch lets callers block until another slot
+// changes, with a shared futex word that blocked callers wait on
+enum shr_watch_disp
+{
+
+    WATCH_WAITERS = 0,      // count of blocked callers
+    WATCH_FUTEX,            // futex sequence word (32 bits)
+    WATCH_SIZE = 2,         // watch slot count
 
 };
 
@@ -96,15 +133,19 @@ typedef struct idx_leaf idx_leaf_s;
 
 
 /*
-    structure for managing mmapped data
+    structure for managing mmapped data, which maps the object over a reserved
+    address space so the array does not move as the object grows, until the
+    object outgrows half of the reserved range and is mapped again, a file on
+    hugetlbfs is only mapped up to the size of the object
 */
 typedef struct extent
 {
 
-    struct extent *next;
     long *array;
     long size;
     long slots;
+    long limit;             // slots usable before the mapping has to grow
+    struct extent *prev;    // earlier mapping, kept until close as it may be in use
 
 } extent_s;
 
@@ -123,9 +164,7 @@ typedef struct view
 
 #define BASEFIELDS          \
     char *name;             \
-    extent_s *prev;         \
     extent_s *current;      \
-    atomictype accessors;   \
     int fd;                 \
     int prot;               \
     int flags
@@ -220,8 +259,15 @@ static inline char DWCAS(
 
 #endif
 
+#define LOAD_ACQ(mem) __atomic_load_n(mem, __ATOMIC_ACQUIRE)
+#define STORE_REL(mem, v) __atomic_store_n(mem, v, __ATOMIC_RELEASE)
+
 #else
 
+#define LOAD_ACQ(mem) atomic_load_explicit((atomictype *)mem, \
+                                           memory_order_acquire)
+#define STORE_REL(mem, v) atomic_store_explicit((atomictype *)mem, v, \
+                                                memory_order_release)
 #define AFS(mem, v) atomic_fetch_sub_explicit((atomictype *)mem, v, \
                                               memory_order_relaxed)
 #define AFA(mem, v) atomic_fetch_add_explicit((atomictype *)mem, v, \
@@ -244,6 +290,15 @@ extern sh_status_e validate_name(
 );
 
 
+extern bool is_file_path(
+    char const * const name     // name as null terminated string -- not NULL
+);
+
+extern int open_object(
+    char const * const name,    // name as null terminated string -- not NULL
+    int oflag                   // open flags
+);
+
 extern sh_status_e validate_existence(
     char const * const name,        // name string of shared memory file
     size_t *size                    // pointer to size field -- possibly NULL
@@ -255,7 +310,9 @@ extern sh_status_e create_base_object(
     char const * const name,// name of q as a null terminated string -- not NULL
     char const * const tag, // tag to initialize base shared memory structure
     int tag_len,            // length of tag
-    long version            // version for memory layout
+    long version,           // version for memory layout
+    bool huge,              // true to back object with huge pages
+    size_t initial          // initial size in bytes, 0 for default
 );
 
 extern void prime_list(
@@ -294,12 +351,30 @@ extern void update_buffer_size(
 );
 
 
-extern view_s resize_extent(
+extern void remap_extent(
     shr_base_s *base,   // pointer to base struct -- not NULL
-    extent_s *extent    // pointer to working extent -- not NULL
+    long bytes          // size in bytes the new mapping must hold
 );
 
 
+/*
+    sync_extent -- grows mapping of object if another process has grown the
+    object past the slots usable through the mapping of this process
+*/
+static inline void sync_extent(
+
+    shr_base_s *base    // pointer to base struct -- not NULL
+
+)   {
+
+    if ( base->current->array[ SIZE ] > base->current->limit ) {
+
+        remap_extent( base, base->current->array[ SIZE ] << SZ_SHIFT );
+
+    }
+}
+
+
 extern view_s expand(
     shr_base_s *base,   // pointer to base struct -- not NULL
     extent_s *extent,   // pointer to current extent -- not NULL
@@ -307,9 +382,56 @@ extern view_s expand(
 );
 
 
-extern view_s insure_in_range(
+extern void init_gate(
+    long *gate,         // pointer to gate slots -- not NULL
+    long value          // initial token count
+);
+
+
+extern long gate_try(
+    atomictype *gate,   // pointer to gate slots -- not NULL
+    long min,           // minimum tokens required -- greater than 0
+    long max            // maximum tokens wanted -- not less than min
+);
+
+
+extern bool gate_wait(
+    atomictype *gate,           // pointer to gate slots -- not NULL
+    struct timespec *deadline   // absolute CLOCK_MONOTONIC time, or NULL
+);
+
+
+extern int gate_select(
+    atomictype **gates,         // array of pointers to gate slots -- not NULL
+    int count,                  // number of gates -- 1 to SELECT_MAX
+    struct timespec *deadline   // absolute CLOCK_MONOTONIC time, or NULL
+);
+
+
+extern void gate_post(
+    atomictype *gate,   // pointer to gate slots -- not NULL
+    long count          // number of tokens to make available
+);
+
+
+extern bool watch_wait(
+    atomictype *watch,          // pointer to watch slots -- not NULL
+    atomictype *word,           // pointer to slot watched -- not NULL
+    long value,                 // value slot is expected to leave
+    struct timespec *deadline   // absolute CLOCK_MONOTONIC time, or NULL
+);
+
+
+extern void watch_post(
+    atomictype *watch   // pointer to watch slots -- not NULL
+);
+
+
+extern void add_chain_end(
     shr_base_s *base,   // pointer to base struct -- not NULL
-    long start          // starting slot
+    long *slots,        // array of slot references -- not NULL
+    long count,         // number of slots in array -- greater than 0
+    long tail           // tail slot of list
 );
 
 
@@ -329,6 +451,24 @@ extern long remove_front(
 );
 
 
+extern long remove_front_chain(
+    shr_base_s *base,   // pointer to base struct -- not NULL
+    long *slots,        // array to hold removed slot references -- not NULL
+    long max,           // maximum nodes to remove -- greater than 0
+    long head,          // head slot of list
+    long tail           // tail slot of list
+);
+
+
+extern view_s alloc_pooled_slots(
+    shr_base_s *base,           // pointer to base struct -- not NULL
+    long slot_count,            // size of node as number of slots
+    long head,                  // list head slot
+    long head_counter,          // list head counter slot
+    long tail                   // list tail slot
+);
+
+
 extern view_s alloc_idx_slots(
     shr_base_s *base    // pointer to base struct -- not NULL
 );
@@ -351,11 +491,24 @@ extern view_s alloc_data_slots(
     long slots          // number of slots to allocate
 );
 
-extern void release_prev_extents(
-    shr_base_s *base    // pointer to base struct -- not NULL
+extern sh_status_e carve_pooled_slots(
+    shr_base_s *base,   // pointer to base struct -- not NULL
+    long slot_count,    // size of node as number of slots
+    long count,         // number of nodes to carve
+    long tail           // list tail slot
 );
 
 
+extern sh_status_e carve_data_slots(
+    shr_base_s *base,   // pointer to base struct -- not NULL
+    long slots,         // number of slots requested per allocation
+    long count          // number of allocations to carve
+);
+
+extern long release_free_data(
+    shr_base_s *base    // pointer to base struct -- not NULL
+);
+
 extern sh_status_e perform_name_validations(
     char const * const name,        // name string of shared memory file
     size_t *size                    // pointer to size field -- possibly NULL
@@ -367,8 +520,17 @@ extern sh_status_e release_mapped_memory(
 
 extern sh_status_e map_shared_memory(
     shr_base_s **base,          // address of base struct pointer-- not NULL
-    char const * const name,    // name as null terminated string -- not NULL
-    size_t size                 // size of shared memory
+    char const * const name     // name as null terminated string -- not NULL
+);
+
+
+extern bool hold_object(
+    shr_base_s *base    // pointer to base struct -- not NULL
+);
+
+
+extern void share_object(
+    shr_base_s *base    // pointer to base struct -- not NULL
 );
 
 
@@ -24,19 +24,27 @@ THE SOFTWARE.
 */
 
 
+#define _GNU_SOURCE
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
-#include <semaphore.h>
+#include <pthread.h>
+#include <sched.h>
 #include <signal.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <unistd.h>
+#ifdef __x86_64__
+#include <x86intrin.h>
+#endif
 
 #include <shared_q.h>
 #include "shared_int.h"
@@ -63,6 +71,8 @@ THE SOFTWARE.
 #define FLAG_EVNT_LEVEL 64              // event depth level reached
 #define FLAG_EVNT_EMPTY 128             // event last item on queue removed
 #define FLAG_EVNT_NONEMPTY 256          // event item added to empty queue
+#define FLAG_COALESCE 512               // signal subscribers once until observed
+#define FLAG_OCCUPIED 1024              // queue last seen holding items
 
 
 
@@ -70,10 +80,80 @@ THE SOFTWARE.
 enum shr_q_constants
 {
 
-    QVERSION = 3,           // queue memory layout version - spread head and tail to different cache lines
+    QVERSION = 18,          // queue memory layout version - file holder count
     NODE_SIZE = 4,          // node slot count
     EVENT_OFFSET = 2,       // offset in node for event for queued item
     VALUE_OFFSET = 3,       // offset in node for data slot for queued item
+    BATCH_NODES = 64,       // batch size that does not require node array allocation
+    MAG_SIZE = 64,          // capacity of process local magazine of queue nodes
+    MAG_CHUNK = 32,         // nodes moved per magazine refill or flush
+    COUNT_STRIPES = 8,      // number of item count stripes, a power of 2
+    SUB_SLOTS = 8,          // number of subscriber table entries
+    MAX_LANES = 8,          // maximum number of priority lanes
+    BCAST_GROUPS = 8,       // number of broadcast consumer groups
+    SYNC_MSEC = 1000,       // default milliseconds between periodic flushes
+    SNAP_FORMAT = 1,        // snapshot stream format version
+    SNAP_BUFFER = 1 << 20,  // bytes buffered per snapshot read or write call
+    SNAP_CHUNK = 1024,      // restored items linked onto queue as a unit
+    SNAP_END = -1,          // lane of snapshot trailer record
+    RESV_MARK = -0x52455356,    // timestamp nanoseconds of uncommitted reservation
+
+};
+
+
+// define subscriber kinds, each with its own generation counter
+enum shr_q_sub_kind
+{
+
+    SUB_LISTEN = 0,         // item arrival on empty queue
+    SUB_MONITOR,            // queue event
+    SUB_CALL,               // remove call on empty queue
+    SUB_READY,              // readiness socket, item arrival on empty queue
+    SUB_SPACE,              // readiness socket, space available on full queue
+    SUB_KINDS,              // number of subscriber kinds
+
+};
+
+
+// define subscriber table entry offsets, each entry has its own cache line
+enum shr_q_sub
+{
+
+    SUB_PID = 0,            // subscribed process id, 0 if entry free
+    SUB_SIGNAL,             // signal to send, -1 for socket, 0 while not ready
+    SUB_KIND,               // kind of notification subscribed to
+    SUB_SENT,               // generation of last signal sent
+    SUB_SEEN,               // generation last observed by subscriber
+    SUB_ADDR,               // handle id naming readiness socket, 0 for signal
+
+};
+
+
+// define broadcast consumer group entry offsets, each entry has its own line
+enum shr_q_group
+{
+
+    GROUP_CURSOR = 0,       // last node read by group
+    GROUP_SEQ,              // list position of last node read by group
+    GROUP_ACTIVE,           // non-zero if group holds items on queue
+
+};
+
+
+// define snapshot stream header offsets, each item follows as its lane and
+// its data header and data, and a trailer with lane SNAP_END and the count ends
+// the stream
+enum shr_q_snap
+{
+
+    SNAP_TAG = 0,           // snapshot identifier tag
+    SNAP_VERSION,           // snapshot stream format version
+    SNAP_DEPTH,             // max depth of queue
+    SNAP_FLAGS,             // create time attribute flags of queue
+    SNAP_ITEM_SIZE,         // fixed item size in bytes, 0 if variable
+    SNAP_LANES,             // number of priority lanes
+    SNAP_CLOCK,             // clock used for timestamps
+    SNAP_HDR,               // snapshot header length
 
 };
 
@@ -94,43 +174,86 @@ enum shr_q_data
 };
 
 
-// define queue header slot offsets
+// define queue header slot offsets, read mostly configuration is grouped at
+// the start and each word written on the add or remove path has its own line
 enum shr_q_disp
 {
 
-    EVENT_TAIL = BASE,              // event queue tail
-    EVENT_TL_CNT,                   // event queue tail counter
-    TAIL,                           // item queue tail
-    TAIL_CNT,                       // item queue tail counter
-    TS_SEC,                         // timestamp of last add in seconds
-    TS_NSEC,                        // timestamp of last add in nanoseconds
-    LISTEN_PID,                     // arrival notification process id
-    LISTEN_SIGNAL,                  // arrival notification signal
+    LEVEL = BASE,                   // queue depth event level
+    MAX_DEPTH,                      // queue max depth limit
     LIMIT_SEC,                      // time limit interval in seconds
     LIMIT_NSEC,                     // time limit interval in nanoseconds
-    EVENT_HEAD,                     // event queue head
-    EVENT_HD_CNT,                   // event queue head counter
-    NOTIFY_PID,                     // event notification process id
-    NOTIFY_SIGNAL,                  // event notification signal
-    HEAD,                           // item queue head
+    TARGET_SEC,                     // target CoDel delay in seconds
+    TARGET_NSEC,                    // target CoDel time limit in nanoseconds
+    ATTR_FLAGS,                     // create time attribute flags
+    RING,                           // slot of ring control block
+    RING_SIZE,                      // ring data size in slots
+    ITEM_SIZE,                      // fixed item size in bytes, 0 if variable
+    CLOCK,                          // clock used for timestamps
+    CLOCK_SEC,                      // offset of clock from wall time in seconds
+    CLOCK_NSEC,                     // offset of clock from wall time in nanoseconds
+    TSC_BASE,                       // time stamp counter at clock start
+    TSC_MULT,                       // nanoseconds per counter tick, 32 bit fraction
+    SUB_COUNT,                      // subscriber count for each kind
+    LANES = SUB_COUNT + SUB_KINDS,  // number of priority lanes
+    SYNC,                           // flush policy of file backed queue
+    SYNC_INTRVL,                    // milliseconds between periodic flushes
+    COMPACT_INTRVL,                 // milliseconds between background compactions
+    TAIL = BASE + ( 3 * LINE_SLOTS ),   // item queue tail
+    TAIL_CNT,                       // item queue tail counter
+    HEAD = BASE + ( 4 * LINE_SLOTS ),   // item queue head
     HEAD_CNT,                       // item queue head counter
-    EMPTY_SEC,                      // time q last empty in seconds
+    TS_SEC = BASE + ( 5 * LINE_SLOTS ), // timestamp of last add in seconds
+    TS_NSEC,                        // timestamp of last add in nanoseconds
+    EMPTY_SEC = BASE + ( 6 * LINE_SLOTS ),  // time q last empty in seconds
     EMPTY_NSEC,                     // time q last empty in nanoseconds
-    DEQ_SEM,                        // deq semaphore
-    ENQ_SEM = (DEQ_SEM + 4),        // enq semaphore
-    CALL_PID = (ENQ_SEM + 4),       // demand call notification process id
-    CALL_SIGNAL,                    // demand call notification signal
+    STACK_HEAD = BASE + ( 7 * LINE_SLOTS ), // head of stack for adaptive LIFO
+    STACK_HD_CNT,                   // head of stack counter
+    DEQ_GATE = BASE + ( 8 * LINE_SLOTS ),   // deq gate
+    ENQ_GATE = BASE + ( 9 * LINE_SLOTS ),   // enq gate
+    SLAB_HEAD = BASE + ( 10 * LINE_SLOTS ), // free slab node list head
+    SLAB_HD_CNT,                    // free slab node head counter
+    SLAB_TAIL = BASE + ( 11 * LINE_SLOTS ), // free slab node list tail
+    SLAB_TL_CNT,                    // free slab node tail counter
+    EVENT_HEAD = BASE + ( 12 * LINE_SLOTS ),    // event queue head
+    EVENT_HD_CNT,                   // event queue head counter
+    EVENT_TAIL,                     // event queue tail
+    EVENT_TL_CNT,                   // event queue tail counter
     CALL_BLOCKS,                    // count of blocked remove calls
     CALL_UNBLOCKS,                  // count of unblocked remove calls
-    TARGET_SEC,                     // target CoDel delay in seconds
-    TARGET_NSEC,                    // target CoDel time limit in nanoseconds
-    STACK_HEAD,                     // head of stack for adaptive LIFO
-    STACK_HD_CNT,                   // head of stack counter
-    LEVEL,                          // queue depth event level
-    MAX_DEPTH,                      // queue max depth limit
-    EVNT_SEM,                       // event semaphore
-    AVAIL = (EVNT_SEM + 4),         // next avail free slot
-    HDR_END = (AVAIL + 14),         // end of queue header
+    EVNT_GATE = BASE + ( 13 * LINE_SLOTS ), // event gate
+    CNT_STRIPE = BASE + ( 14 * LINE_SLOTS ),    // item count stripes, one per line
+    SUB_GEN = CNT_STRIPE + ( COUNT_STRIPES * LINE_SLOTS ),  // notification generation for each kind
+    SUB_TABLE = SUB_GEN + LINE_SLOTS,   // subscriber table entries
+    SYNC_REQ = SUB_TABLE + ( SUB_SLOTS * LINE_SLOTS ),  // adds waiting on group commit
+    SYNC_DONE,                      // adds covered by completed flush
+    SYNC_LOCK,                      // process id of flushing group commit leader
+    HOLDERS,                        // handles holding file backed queue open
+    AVAIL = SYNC_REQ + LINE_SLOTS,  // next avail free slot
+    HDR_END = AVAIL + LINE_SLOTS,   // end of queue header
+    LANE_SLOTS = 2 * LINE_SLOTS,    // tail and head lines of each extra lane
+    LANE_END = HDR_END + ( ( MAX_LANES - 1 ) * LANE_SLOTS ),  // end of extra lanes
+    BCAST_LOCK = HDR_END,           // process id of broadcast lock holder, in place of extra lanes
+    GROUP_TABLE = HDR_END + LINE_SLOTS, // broadcast consumer group entries
+    BCAST_END = GROUP_TABLE + ( BCAST_GROUPS * LINE_SLOTS ),  // end of broadcast header
+
+};
+
+
+// list generations are tagged with the tail slot, so every lane tail must fit
+_Static_assert( LANE_END - LANE_SLOTS < GEN_STRIDE, "lane tail exceeds GEN_STRIDE" );
+
+
+// define ring control block offsets, head and tail on separate cache lines
+enum shr_q_ring
+{
+
+    RING_HEAD = 0,                  // consumer position in slots
+    RING_WATCH,                     // watch of consumer position by blocked adds
+    RING_TAIL = LINE_SLOTS,         // producer position in slots
+    RING_DATA = 2 * LINE_SLOTS,     // start of ring data
+    RING_DEFAULT = 1 << 20,         // default ring size in bytes
+    RING_WRAP = -1,                 // marker for unused space at end of ring
 
 };
 
@@ -143,69 +266,95 @@ struct shr_q
 
     BASEFIELDS;
     sq_mode_e mode;
+    long attr_flags;
+    long slab_slots;        // slab node size, 0 if items are variable size
+    sq_clock_e clock;       // clock used for timestamps
+    clockid_t clock_id;     // posix clock id if not time stamp counter
+    struct timespec wall_offset;    // offset from clock to wall time
+    ulong tsc_base;         // time stamp counter at clock start
+    ulong tsc_mult;         // nanoseconds per counter tick, 32 bit fraction
+    long uid_prefix;        // handle id placed in high half of first item ids
+    atomictype uid_next;    // next item id of handle
+    atomictype mag_lock;    // magazine in use by a thread of this process
+    long mag_count;         // number of nodes held in magazine
+    long mag[ MAG_SIZE ];   // process local magazine of free queue nodes
+    long sub[ SUB_KINDS ];  // subscriber entry registered by handle, 0 if none
+    long lanes;             // number of priority lanes
+    sq_sync_e sync;         // flush policy of file backed queue
+    pthread_t sync_thread;  // periodic flush thread of handle
+    bool sync_running;      // true if periodic flush thread started
+    pthread_t compact_thread;   // background compaction thread of handle
+    bool compact_running;   // true if background compaction thread started
+    ulong lane_turn;        // weighted lane selection sequence of handle
+    int ready_fd;           // readiness socket of handle, -1 if none
+    atomictype wake_sock;   // socket used to wake readiness sockets, -1 if none
+    long ring_full;         // consumer position when ring was last found full
+    bool holding;           // true if counted in holders of file backed queue
 
 };
 
 
 /*
-================================================================================
-
-    private functions
-
-================================================================================
+    buffered snapshot stream
 */
+typedef struct snap_io
+{
 
+    int fd;                 // file descriptor of stream
+    char *buf;              // buffer of stream data
+    size_t size;            // size of buffer
+    size_t pos;             // position of next byte in buffer
+    size_t len;             // bytes of buffer holding data read
 
-static sh_status_e format_as_queue(
+} snap_io_s;
 
-    shr_q_s *q,             // pointer to queue struct -- not NULL
-    unsigned int max_depth, // max depth allowed at which add of an item blocks
-    sq_mode_e mode          // read/write mode
 
-)   {
+/*
+================================================================================
 
-    init_data_allocator( (shr_base_s*)q, HDR_END );
-    q->mode = mode;
-    long *array = q->current->array;
+    private functions
 
-    int rc = sem_init( (sem_t*)&array[ DEQ_SEM ], 1, 0 );
+================================================================================
+*/
 
-    if ( rc < 0 ) {
 
-        return SH_ERR_NOSUPPORT;
+/*
+    next_uid -- unique id for item from id of handle and local sequence, so
+    adds do not contend on a shared counter
 
-    }
+    Note:  when the local sequence is used up, the handle takes another id
+    from the shared counter to start a new sequence.  On 32-bit a split id
+    would allow only 2^16 handles and 2^16 items per handle before a new id
+    is needed, so the full width shared counter is used
+*/
+static inline long next_uid(
 
-    if ( max_depth == 0 ) {
+    shr_q_s *q
 
-        max_depth = SEM_VALUE_MAX;
+)   {
 
-    }
+#ifdef __x86_64__
+    long uid = q->uid_next;
 
-    array[ MAX_DEPTH ] = max_depth;
-    rc = sem_init( (sem_t*)&array[ ENQ_SEM ], 1, max_depth );
+    while ( true ) {
 
-    if ( rc < 0 ) {
+        long next = uid + 1;
 
-        return SH_ERR_NOSUPPORT;
+        if ( ( next & ( ( 1UL << ( LONG_BIT / 2 ) ) - 1 ) ) == 0 ) {
 
-    }
+            next = AFA( &q->current->array[ ID_CNTR ], 1 ) << ( LONG_BIT / 2 );
 
-    rc = sem_init( (sem_t*)&array[ EVNT_SEM ], 1, 0 );
+        }
 
-    if ( rc < 0 ) {
+        if ( CAS( &q->uid_next, &uid, next ) ) {
 
-        return SH_ERR_NOSUPPORT;
+            return uid;
 
+        }
     }
-
-    // init event queue
-    prime_list( (shr_base_s*)q, NODE_SIZE, EVENT_HEAD, EVENT_HD_CNT, EVENT_TAIL, EVENT_TL_CNT );
-
-    // init data queue
-    prime_list( (shr_base_s*)q, NODE_SIZE, HEAD, HEAD_CNT, TAIL, TAIL_CNT );
-
-    return SH_OK;
+#else
+    return AFA( &q->current->array[ ID_CNTR ], 1 );
+#endif
 }
 
 
@@ -231,2407 +380,6846 @@ static inline long calc_data_slots(
 }
 
 
-static long copy_value(
+/*
+    calc_slab_slots -- size of node holding fixed size item, kept to an even
+    number of slots so node links stay aligned for double word CAS
+*/
+static inline long calc_slab_slots(
 
-    shr_q_s *q,         // pointer to queue struct
-    void *value,        // pointer to value data
-    long length,        // length of data
-    sh_type_e type      // data type
+    long item_size
 
 )   {
 
-    if ( q == NULL || value == NULL || length <= 0 ) {
-
-        return 0;
-
-    }
-
-    struct timespec curr_time;
-    clock_gettime( CLOCK_REALTIME, &curr_time );
-    long space = calc_data_slots( length );
-    update_buffer_size( q->current->array, space, sizeof(sq_vec_s) );
-    view_s view = alloc_data_slots( (shr_base_s*)q, space );
-    long current = view.slot;
-
-    if ( current >= HDR_END ) {
-
-        long *array = view.extent->array;
-        array[ current + TM_SEC ] = curr_time.tv_sec;
-        array[ current + TM_NSEC ] = curr_time.tv_nsec;
-        array[ current + UID ] = AFA( &array[ ID_CNTR ], 1);
-        array[ current + TYPE ] = type;
-        array[ current + VEC_CNT ] = 1;
-        array[ current + DATA_LENGTH ] = length;
-        memcpy( &array[ current + DATA_HDR ], value, length );
-
-    }
-
-    return current;
+    long space = NODE_SIZE + calc_data_slots( item_size );
+    return ( space + 1 ) & ~1L;
 }
 
 
-static long calc_vector_slots(
+/*
+    load_clock -- set up clock used for timestamps from queue header
+*/
+static void load_clock(
 
-    sq_vec_s *vector,   // pointer to vector of items -- not NULL
-    int vcnt            // count of vector array -- must be >= 2
+    shr_q_s *q          // pointer to queue struct -- not NULL
 
 )   {
 
-    long space = DATA_HDR;
-
-    for( int i = 0; i < vcnt; i++ ) {
-
-        // increment for embedded for type and data length
-        space += 2;
-        // calculate number of slots needed for data
-        space += (vector[i].len >> SZ_SHIFT);
+    static const clockid_t clock_ids[] = {
+        CLOCK_REALTIME,
+        CLOCK_REALTIME_COARSE,
+        CLOCK_MONOTONIC,
+        CLOCK_MONOTONIC_COARSE,
+        CLOCK_MONOTONIC
+    };
 
-        // account for remainder
-        if (vector[i].len & REM) {
+    long *array = q->current->array;
+    q->clock = array[ CLOCK ];
+    q->clock_id = clock_ids[ q->clock ];
+    q->wall_offset.tv_sec = array[ CLOCK_SEC ];
+    q->wall_offset.tv_nsec = array[ CLOCK_NSEC ];
+    q->tsc_base = array[ TSC_BASE ];
+    q->tsc_mult = array[ TSC_MULT ];
+}
 
-            space += 2;
 
-        }
+/*
+    format_clock -- record clock for timestamps in queue header along with
+    offset to convert clock readings to wall time
 
-    }
+    Note:  time stamp counter is calibrated against CLOCK_MONOTONIC, and
+    CLOCK_MONOTONIC is used in its place if counter is not available
+*/
+static void format_clock(
 
-    return space;
-}
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_clock_e clock    // clock to use for timestamps
 
+)   {
 
-static long copy_vector(
+    long *array = q->current->array;
+    struct timespec wall;
+    struct timespec start = { 0, 0 };
 
-    shr_q_s *q,         // pointer to queue struct -- not NULL
-    sq_vec_s *vector,   // pointer to vector of items -- not NULL
-    int vcnt            // count of vector array -- must be >= 2
+#ifdef __x86_64__
+    if ( clock == SQ_CLOCK_TSC ) {
+
+        struct timespec t0;
+        struct timespec t1;
+        struct timespec pause = { 0, 2000000 };
+        clock_gettime( CLOCK_MONOTONIC, &t0 );
+        ulong c0 = __rdtsc();
+        clock_gettime( CLOCK_REALTIME, &wall );
+        nanosleep( &pause, NULL );
+        clock_gettime( CLOCK_MONOTONIC, &t1 );
+        ulong c1 = __rdtsc();
+        timespecsub( &t1, &t0, &t1 );
+        __extension__ unsigned __int128 ns = ( t1.tv_sec * 1000000000UL ) + t1.tv_nsec;
+        array[ TSC_BASE ] = c0;
+        array[ TSC_MULT ] = ( ns << 32 ) / ( c1 - c0 );
+        array[ CLOCK_SEC ] = wall.tv_sec;
+        array[ CLOCK_NSEC ] = wall.tv_nsec;
+        array[ CLOCK ] = clock;
+        load_clock( q );
+        return;
 
-)   {
+    }
+#endif
 
-    if ( q == NULL || vector == NULL || vcnt < 2 ) {
+    if ( clock == SQ_CLOCK_TSC ) {
 
-        return -1;
+        clock = SQ_CLOCK_MONOTONIC;
 
     }
 
-    struct timespec curr_time;
-    clock_gettime( CLOCK_REALTIME, &curr_time );
-    long space = calc_vector_slots( vector, vcnt );
-    update_buffer_size( q->current->array, space, vcnt * sizeof(sq_vec_s) );
-    view_s view = alloc_data_slots( (shr_base_s*)q, space );
-    long current = view.slot;
+    array[ CLOCK ] = clock;
+    load_clock( q );
 
-    if ( current >= HDR_END ) {
+    if ( clock == SQ_CLOCK_MONOTONIC || clock == SQ_CLOCK_MONOTONIC_COARSE ) {
 
-        long *array = view.extent->array;
-        array[ current + TM_SEC ] = curr_time.tv_sec;
-        array[ current + TM_NSEC ] = curr_time.tv_nsec;
-        array[ current + UID ] = AFA( &array[ ID_CNTR ], 1);
-        array[ current + TYPE ] = SH_VECTOR_T;
-        array[ current + VEC_CNT ] = vcnt;
-        array[ current + DATA_LENGTH ] = ( space - DATA_HDR ) << SZ_SHIFT;
-        long slot = current;
-        slot += DATA_HDR;
+        clock_gettime( CLOCK_REALTIME, &wall );
+        clock_gettime( q->clock_id, &start );
+        timespecsub( &wall, &start, &wall );
+        array[ CLOCK_SEC ] = wall.tv_sec;
+        array[ CLOCK_NSEC ] = wall.tv_nsec;
+        load_clock( q );
 
-        for ( int i = 0; i < vcnt; i++ ) {
+    }
+}
 
-            if ( vector[i].type <= 0 ||
-                vector[i].len <= 0  ||
-                vector[i].base == NULL ) {
 
-                return -1;
+/*
+    queue_time -- current time of clock used for queue timestamps
+*/
+static inline void queue_time(
 
-            }
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    struct timespec *curr_time  // pointer to time result -- not NULL
 
-            array[ slot++ ] = vector[ i ].type;
-            array[ slot++ ] = vector[ i ].len;
-            memcpy( &array[ slot ], vector[ i ].base, vector[ i ].len );
-            slot += vector[ i ].len >> SZ_SHIFT;
+)   {
 
-            if ( vector[ i ].len & REM ) {
+#ifdef __x86_64__
+    if ( q->clock == SQ_CLOCK_TSC ) {
 
-                slot++;
+        __extension__ unsigned __int128 ticks = __rdtsc() - q->tsc_base;
+        ulong ns = ( ticks * q->tsc_mult ) >> 32;
+        curr_time->tv_sec = ns / 1000000000UL;
+        curr_time->tv_nsec = ns % 1000000000UL;
+        return;
 
-            }
-        }
     }
+#endif
 
-    return current;
+    clock_gettime( q->clock_id, curr_time );
 }
 
 
-static void signal_arrival(
+static inline bool is_lean(
 
     shr_q_s *q
 
 )   {
 
-    if ( q->current->array[ LISTEN_SIGNAL ] == 0 ||
-         q->current->array[ LISTEN_PID ] == 0 ) {
+    return ( q->attr_flags & SQ_LEAN );
+}
 
-        return;
 
-    }
+/*
+    item_time -- time to stamp on added item, zero for lean queue
+*/
+static inline void item_time(
+
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    struct timespec *curr_time  // pointer to time result -- not NULL
 
-    int sval = -1;
-    (void)sem_getvalue( (sem_t*)&q->current->array[ DEQ_SEM ], &sval );
-    union sigval sv = { .sival_int = sval };
+)   {
 
-    if ( sval == 0 ) {
+    if ( is_lean( q ) ) {
 
-        (void)sigqueue(q->current->array[ LISTEN_PID ],
-                       q->current->array[ LISTEN_SIGNAL ], sv);
+        curr_time->tv_sec = 0;
+        curr_time->tv_nsec = 0;
+        return;
 
     }
 
+    queue_time( q, curr_time );
 }
 
 
-static void signal_event(
+/*
+    wall_time -- converts queue timestamp to wall time in place
+*/
+static inline void wall_time(
 
-    shr_q_s *q
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    struct timespec *stamp      // pointer to timestamp, or NULL
 
 )   {
 
-    if ( q->current->array[ NOTIFY_PID ] == 0 ||
-         q->current->array[ NOTIFY_SIGNAL ] == 0 ) {
+    if ( stamp != NULL && !is_lean( q ) &&
+         q->clock != SQ_CLOCK_REALTIME &&
+         q->clock != SQ_CLOCK_REALTIME_COARSE ) {
 
-        return;
+        timespecadd( stamp, &q->wall_offset, stamp );
 
     }
-
-    union sigval sv = { 0 };
-    (void)sigqueue( q->current->array[ NOTIFY_PID ],
-                    q->current->array[ NOTIFY_SIGNAL ], sv );
 }
 
 
-static void signal_call(
+/*
+    queue_stamp -- converts wall time to queue timestamp in place
+*/
+static inline void queue_stamp(
 
-    shr_q_s *q
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    struct timespec *stamp      // pointer to timestamp -- not NULL
 
 )   {
 
-    if ( q->current->array[ CALL_PID ] == 0 ||
-        q->current->array[ CALL_SIGNAL ] == 0 ) {
+    if ( !is_lean( q ) &&
+         q->clock != SQ_CLOCK_REALTIME &&
+         q->clock != SQ_CLOCK_REALTIME_COARSE ) {
 
-        return;
+        timespecsub( stamp, &q->wall_offset, stamp );
 
     }
-
-    union sigval sv = { 0 };
-    (void)sigqueue( q->current->array[ CALL_PID ],
-                    q->current->array[ CALL_SIGNAL ], sv );
 }
 
 
-static inline bool is_monitored(
+/*
+    lane_tail -- tail slot of item list for priority lane, lane 0 is the
+    original item list and the other lanes follow the queue header
+*/
+static inline long lane_tail(
 
-    long *array
+    long lane           // priority lane
 
 )   {
 
-    return ( array[ NOTIFY_SIGNAL ] && array[ NOTIFY_PID ] );
+    return ( lane == 0 ) ? TAIL : HDR_END + ( ( lane - 1 ) * LANE_SLOTS );
 }
 
 
-static inline bool is_call_monitored(
+/*
+    lane_head -- head slot of item list for priority lane
+*/
+static inline long lane_head(
 
-    long *array
+    long lane           // priority lane
 
 )   {
 
-    return ( array[ CALL_SIGNAL ] && array[ CALL_PID ] );
+    return ( lane == 0 ) ? HEAD : lane_tail( lane ) + LINE_SLOTS;
 }
 
 
-static inline bool is_discard_on_expire(
+static sh_status_e format_ring(
 
-    long *array
+    shr_q_s *q,             // pointer to queue struct -- not NULL
+    size_t ring_size        // size of ring in bytes, or 0 for default
 
 )   {
 
-    return ( array[ FLAGS ] & FLAG_DISCARD_EXPIRED );
-}
+    // a ring whose size in bytes can not be held in a long never fits
+    if ( ring_size > ( LONG_MAX >> 2 ) ) {
 
+        return SH_ERR_NOMEM;
 
-static inline bool is_adaptive_lifo(
+    }
 
-    long *array
+    long slots = ( ring_size ? ring_size : RING_DEFAULT ) >> SZ_SHIFT;
+    long size = LINE_SLOTS;
 
-)   {
+    while ( size < slots ) {
 
-    return ( array[ FLAGS ] & FLAG_LIFO_ON_LEVEL );
-}
+        size <<= 1;
 
+    }
 
-static inline bool is_codel_active(
+    // allocate extra line to allow alignment of control block
+    view_s view = alloc_new_data( (shr_base_s*) q, RING_DATA + size + LINE_SLOTS );
+    if ( view.slot == 0 ) {
 
-    long *array
+        return SH_ERR_NOMEM;
 
-)   {
+    }
 
-    return ( ( array[ TARGET_NSEC ] || array[ TARGET_SEC ] ) &&
-             ( array[ LIMIT_NSEC ] || array[ LIMIT_SEC ] ) );
+    long ring = ( view.slot + LINE_SLOTS - 1 ) & ~( LINE_SLOTS - 1 );
+    long *array = view.extent->array;
+    memset( &array[ ring ], 0, RING_DATA << SZ_SHIFT );
+    array[ RING_SIZE ] = size;
+    array[ RING ] = ring;
+
+    return SH_OK;
 }
 
 
-static long get_event_flag(
+/*
+    prealloc_items -- carve queue nodes, and data sized for items of
+    prealloc_len bytes, for prealloc items from unused space, so adds do not
+    grow the queue until they are used up
+*/
+static sh_status_e prealloc_items(
 
-    sq_event_e event
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_attr_s *attr     // pointer to create time attributes -- not NULL
 
 )   {
 
-    switch ( event ) {
+    if ( attr->prealloc == 0 ) {
 
-        case SQ_EVNT_ALL:
+        return SH_OK;
 
-            return ( FLAG_EVNT_INIT | FLAG_EVNT_LIMIT | FLAG_EVNT_EMPTY |
-                    FLAG_EVNT_LEVEL | FLAG_EVNT_NONEMPTY | FLAG_EVNT_TIME );
+    }
 
-        case SQ_EVNT_INIT:
+    if ( q->slab_slots > 0 ) {
 
-            return FLAG_EVNT_INIT;
+        return carve_pooled_slots( (shr_base_s*) q, q->slab_slots, attr->prealloc,
+                                   SLAB_TAIL );
 
-        case SQ_EVNT_LIMIT:
+    }
 
-            return FLAG_EVNT_LIMIT;
+    sh_status_e status = carve_pooled_slots( (shr_base_s*) q, NODE_SIZE,
+                                             attr->prealloc, FREE_TAIL );
 
-        case SQ_EVNT_EMPTY:
+    if ( status == SH_OK && attr->prealloc_len > 0 ) {
 
-            return FLAG_EVNT_EMPTY;
-
-        case SQ_EVNT_LEVEL:
+        status = carve_data_slots( (shr_base_s*) q,
+                                   calc_data_slots( attr->prealloc_len ),
+                                   attr->prealloc );
 
-            return FLAG_EVNT_LEVEL;
+    }
 
-        case SQ_EVNT_NONEMPTY:
+    return status;
+}
 
-            return FLAG_EVNT_NONEMPTY;
 
-        case SQ_EVNT_TIME:
+static sh_status_e format_as_queue(
 
-            return FLAG_EVNT_TIME;
+    shr_q_s *q,             // pointer to queue struct -- not NULL
+    unsigned int max_depth, // max depth allowed at which add of an item blocks
+    sq_mode_e mode,         // read/write mode
+    sq_attr_s *attr         // pointer to create time attributes, or NULL
 
-        default:
+)   {
 
-            break;
-        }
+    long lanes = ( attr != NULL && attr->lanes > 1 ) ? attr->lanes : 1;
 
-    return 0;
-}
+    // extra lanes or broadcast groups occupy the space following the header
+    if ( attr != NULL && ( attr->flags & SQ_BROADCAST ) ) {
 
+        init_data_allocator( (shr_base_s*)q, BCAST_END );
 
-static inline bool event_disabled(
+    } else {
 
-    long *array,
-    sq_event_e event
+        init_data_allocator( (shr_base_s*)q, HDR_END + ( ( lanes - 1 ) * LANE_SLOTS ) );
 
-)   {
+    }
 
-    return !( array[ FLAGS ] & get_event_flag( event ) );
-}
+    q->mode = mode;
+    long *array = q->current->array;
+    array[ LANES ] = lanes;
+    q->lanes = lanes;
+    q->uid_prefix = AFA( &array[ ID_CNTR ], 1 );
+    q->uid_next = q->uid_prefix << ( LONG_BIT / 2 );
 
+    if ( max_depth == 0 ) {
 
-static bool add_event(
+        max_depth = SEM_VALUE_MAX;
 
-    shr_q_s *q,
-    sq_event_e event
+    }
 
-)   {
+    array[ MAX_DEPTH ] = max_depth;
+    init_gate( &array[ DEQ_GATE ], 0 );
+    init_gate( &array[ ENQ_GATE ], max_depth );
+    init_gate( &array[ EVNT_GATE ], 0 );
 
-    view_s view = { .extent = q->current };
+    // init event queue
+    prime_list( (shr_base_s*)q, NODE_SIZE, EVENT_HEAD, EVENT_HD_CNT, EVENT_TAIL, EVENT_TL_CNT );
 
-    long *array = view.extent->array;
+    long node_size = NODE_SIZE;
 
-    if ( event == SQ_EVNT_NONE || event_disabled( array, event ) ) {
+    if ( attr != NULL && attr->item_size > 0 ) {
 
-        return false;
+        // fixed size items are held in data queue nodes from slab node list
+        array[ ITEM_SIZE ] = attr->item_size;
+        node_size = calc_slab_slots( attr->item_size );
+        prime_list( (shr_base_s*)q, node_size, SLAB_HEAD, SLAB_HD_CNT, SLAB_TAIL, SLAB_TL_CNT );
+        q->slab_slots = node_size;
 
     }
 
-    // insure event is a one shot by clearing subscription atomically
-    long flag = get_event_flag(event);
-    long prev = array[FLAGS];
-
-    if (!CAS( &array[ FLAGS ], &prev, prev & ~flag ) ) {
+    // init data queue for each lane
+    for ( long lane = 0; lane < lanes; lane++ ) {
 
-        return false;
+        prime_list( (shr_base_s*)q, node_size, lane_head( lane ), lane_head( lane ) + 1,
+                    lane_tail( lane ), lane_tail( lane ) + 1 );
 
     }
 
-    // allocate queue node
-    view = alloc_idx_slots( (shr_base_s*)q );
-    if ( view.slot == 0 ) {
+    format_clock( q, ( attr == NULL ) ? SQ_CLOCK_REALTIME : attr->clock );
 
-        return false;
+    if ( attr == NULL ) {
+
+        return SH_OK;
 
     }
 
-    array = view.extent->array;
-    array[ view.slot + EVENT_OFFSET ] = event;
+    if ( attr->flags & SQ_SPSC ) {
 
-    // append node to end of queue
-    add_end( (shr_base_s*)q, view.slot, EVENT_TAIL );
+        sh_status_e status = format_ring( q, attr->ring_size );
+        if ( status ) {
 
-    // release read of event
-    sem_post( (sem_t*) &array[ EVNT_SEM ] );
+            return status;
 
-    return true;
-}
+        }
+    }
 
+    q->current->array[ ATTR_FLAGS ] = attr->flags;
+    q->attr_flags = attr->flags;
+    q->current->array[ SYNC ] = attr->sync;
+    q->current->array[ SYNC_INTRVL ] = ( attr->sync_msec > 0 ) ? attr->sync_msec : SYNC_MSEC;
+    q->current->array[ COMPACT_INTRVL ] = attr->compact_msec;
 
-static void update_empty_timestamp(
+    return prealloc_items( q, attr );
+}
 
-    long *array      // active q array
 
-)   {
+static view_s alloc_value(
 
-    struct timespec curr_time;
-    clock_gettime( CLOCK_REALTIME, &curr_time );
-    struct timespec last = *(struct timespec * volatile) &array[ EMPTY_SEC ];
-    DWORD next = { .low = curr_time.tv_sec, .high = curr_time.tv_nsec };
+    shr_q_s *q,         // pointer to queue struct
+    long length,        // length of data
+    sh_type_e type      // data type
 
-    while ( timespeccmp(&curr_time, &last, > ) ) {
+)   {
 
-        if ( DWCAS( (DWORD*) &array[ EMPTY_SEC ], (DWORD*) &last, next ) ) {
+    long space = calc_data_slots( length );
+    update_buffer_size( q->current->array, space, sizeof(sq_vec_s) );
+    view_s view = alloc_data_slots( (shr_base_s*)q, space );
+    long current = view.slot;
 
-            break;
+    if ( current >= HDR_END ) {
 
-        }
+        long *array = view.extent->array;
+        array[ current + UID ] = next_uid( q );
+        array[ current + TYPE ] = type;
+        array[ current + VEC_CNT ] = 1;
+        array[ current + DATA_LENGTH ] = length;
 
-        last = *(struct timespec * volatile) &array[ EMPTY_SEC ];
     }
+
+    return view;
 }
 
 
-static void lifo_add(
+static long copy_value(
 
-    shr_q_s *q,         // pointer to queue struct -- not NULL
-    long slot           // slot reference
+    shr_q_s *q,         // pointer to queue struct
+    void *value,        // pointer to value data
+    long length,        // length of data
+    sh_type_e type      // data type
 
 )   {
 
-    view_s view = insure_in_range( (shr_base_s*) q, slot );
-    atomictype * volatile array = (atomictype*) view.extent->array;
+    if ( q == NULL || value == NULL || length <= 0 ) {
 
-    DWORD stack_before;
-    DWORD stack_after;
+        return 0;
 
-    do {
+    }
 
-        array[ slot ] = array[ STACK_HEAD ];
-        array[ slot + 1 ] = array[ STACK_HD_CNT ];
-        stack_before = *( (DWORD * volatile) &array[ slot ] );
-        stack_after.low = slot;
-        stack_after.high = stack_before.high + 1;
+    struct timespec curr_time;
+    item_time( q, &curr_time );
+    view_s view = alloc_value( q, length, type );
+    long current = view.slot;
 
-    } while ( !DWCAS( (DWORD*) &array[ STACK_HEAD ], &stack_before, stack_after ) );
-}
+    if ( current >= HDR_END ) {
 
+        long *array = view.extent->array;
+        array[ current + TM_SEC ] = curr_time.tv_sec;
+        array[ current + TM_NSEC ] = curr_time.tv_nsec;
+        memcpy( &array[ current + DATA_HDR ], value, length );
 
-static void post_process_enq(
+    }
 
-    shr_q_s *q,         // pointer to queue, not NULL
-    long count,         // prev count on queue
-    DWORD curr_time     // current item time stamp
+    return current;
+}
 
-)   {
 
-    long *array = q->current->array;
+static long calc_vector_slots(
 
-    if ( count == 0 ) {
+    sq_vec_s *vector,   // pointer to vector of items -- not NULL
+    int vcnt            // count of vector array -- must be >= 2
 
-        // queue emptied
-        update_empty_timestamp( array );
+)   {
 
-    }
+    long space = DATA_HDR;
 
-    bool need_signal = false;
+    for( int i = 0; i < vcnt; i++ ) {
 
-    if ( !( array[ FLAGS ] & FLAG_ACTIVATED ) ) {
+        // increment for embedded for type and data length
+        space += 2;
+        // calculate number of slots needed for data
+        space += (vector[i].len >> SZ_SHIFT);
 
-        if ( set_flag( array, FLAG_ACTIVATED ) ) {
+        // account for remainder
+        if (vector[i].len & REM) {
 
-            need_signal |= add_event( q, SQ_EVNT_INIT );
+            space += 2;
 
         }
 
     }
 
-    if ( count == 0 ) {
+    return space;
+}
 
-        need_signal |= add_event( q, SQ_EVNT_NONEMPTY );
 
-    }
+static bool valid_vector(
 
-    if ( count == array[ MAX_DEPTH ] - 1 ) {
+    sq_vec_s *vector,   // pointer to vector of items -- not NULL
+    int vcnt            // count of vector array
 
-        need_signal |= add_event( q, SQ_EVNT_LIMIT );
+)   {
 
-    }
+    for ( int i = 0; i < vcnt; i++ ) {
 
-    if ( need_signal && is_monitored( array ) ) {
+        if ( vector[i].type <= 0 ||
+            vector[i].len <= 0  ||
+            vector[i].base == NULL ) {
 
-        signal_event( q );
+            return false;
 
+        }
     }
 
-    // update last add timestamp
-    struct timespec prev_time = *(struct timespec*) &array[ TS_SEC ];
-    DWCAS( (DWORD*) &array[ TS_SEC ], (DWORD*) &prev_time, curr_time );
-    signal_arrival( q );
+    return true;
 }
 
 
-static inline void fifo_add(
+static void fill_vector(
 
-    shr_q_s *q,         // pointer to queue, not NULL
-    long slot          // slot reference
+    long *array,        // array containing data -- not NULL
+    long current,       // data slot
+    long space,         // total data slots
+    sq_vec_s *vector,   // pointer to vector of items -- not NULL
+    int vcnt,           // count of vector array -- must be >= 2
+    long uid            // unique id of item
 
 )   {
 
-    // append node to end of queue
-    add_end( (shr_base_s*) q, slot, TAIL );
+    array[ current + UID ] = uid;
+    array[ current + TYPE ] = SH_VECTOR_T;
+    array[ current + VEC_CNT ] = vcnt;
+    array[ current + DATA_LENGTH ] = ( space - DATA_HDR ) << SZ_SHIFT;
+    long slot = current;
+    slot += DATA_HDR;
+
+    for ( int i = 0; i < vcnt; i++ ) {
+
+        array[ slot++ ] = vector[ i ].type;
+        array[ slot++ ] = vector[ i ].len;
+        memcpy( &array[ slot ], vector[ i ].base, vector[ i ].len );
+        slot += vector[ i ].len >> SZ_SHIFT;
+
+        if ( vector[ i ].len & REM ) {
+
+            slot++;
+
+        }
+    }
 }
 
 
-static sh_status_e enq_data(
+static long copy_vector(
 
-    shr_q_s *q,         // pointer to queue, not NULL
-    long data_slot      // data to be added to queue
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_vec_s *vector,   // pointer to vector of items -- not NULL
+    int vcnt            // count of vector array -- must be >= 2
 
 )   {
 
-    long *array = q->current->array;
-    DWORD curr_time = { .low = array[ data_slot + TM_SEC ],
-                        .high = array[ data_slot + TM_NSEC ] };
+    if ( q == NULL || vector == NULL || vcnt < 2 ||
+         !valid_vector( vector, vcnt ) ) {
 
-    // allocate queue node
-    view_s view = alloc_idx_slots( (shr_base_s*) q );
+        return -1;
 
-    if ( view.slot == 0 ) {
+    }
 
-        free_data_slots( (shr_base_s*) q, data_slot );
-        return SH_ERR_NOMEM;
+    struct timespec curr_time;
+    item_time( q, &curr_time );
+    long space = calc_vector_slots( vector, vcnt );
+    update_buffer_size( q->current->array, space, vcnt * sizeof(sq_vec_s) );
+    view_s view = alloc_data_slots( (shr_base_s*)q, space );
+    long current = view.slot;
+
+    if ( current >= HDR_END ) {
+
+        long *array = view.extent->array;
+        array[ current + TM_SEC ] = curr_time.tv_sec;
+        array[ current + TM_NSEC ] = curr_time.tv_nsec;
+        fill_vector( array, current, space, vector, vcnt, next_uid( q ) );
 
     }
 
-    long node = view.slot;
-    array = view.extent->array;
+    return current;
+}
 
-    // point queue node to data slot
-    array[ node + VALUE_OFFSET ] = data_slot;
 
-    if ( is_adaptive_lifo( array ) && ( array[ COUNT ] >= array[ LEVEL ] ) ) {
+/*
+    ready_address -- abstract unix socket address of readiness socket of a
+    handle, returns length of address
 
-        lifo_add( q, node );
+    Note:  the queue name is reduced to a 64-bit FNV-1a hash, so the address
+    always fits and the handle id is never truncated away
+*/
+static socklen_t ready_address(
 
-    } else {
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    long addr,                  // handle id naming socket
+    struct sockaddr_un *sa      // pointer to address result -- not NULL
 
-        fifo_add( q, node );
-    }
+)   {
 
-    long count = AFA( &array[ COUNT ], 1 );
+    uint64_t hash = 0xcbf29ce484222325ULL;
 
-    post_process_enq( q, count, curr_time );
+    for ( const char *c = q->name; *c; c++ ) {
 
-    release_prev_extents( (shr_base_s*) q );
+        hash = ( hash ^ (uint8_t) *c ) * 0x100000001b3ULL;
 
-    return SH_OK;
-}
+    }
 
+    memset( sa, 0, sizeof(struct sockaddr_un) );
+    sa->sun_family = AF_UNIX;
+    int len = snprintf( &sa->sun_path[ 1 ], sizeof(sa->sun_path) - 1,
+                        "shr_q/%016llx/%lx", (unsigned long long) hash, addr );
 
-static sh_status_e enq(
+    return offsetof( struct sockaddr_un, sun_path ) + 1 + len;
+}
 
-    shr_q_s *q,         // pointer to queue, not NULL
-    void *value,        // pointer to item, not NULL
-    size_t length,      // length of item
-    sh_type_e type      // data type
 
-)   {
+/*
+    wake_ready -- makes readiness socket readable by sending it an empty
+    datagram, a full socket is already readable so errors are ignored
+*/
+static void wake_ready(
 
-    if ( q == NULL || value == NULL || length <= 0 ) {
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long addr           // handle id naming socket
 
-        return SH_ERR_ARG;
+)   {
 
-    }
+    long sock = q->wake_sock;
 
-    // allocate space and copy value
-    long data_slot = copy_value( q, value, length, type );
+    if ( sock < 0 ) {
 
-    if ( data_slot == 0 ) {
+        long prev = -1;
+        sock = socket( AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+        if ( sock < 0 ) {
 
-        return SH_ERR_NOMEM;
+            return;
 
-    }
+        }
 
-    if ( data_slot < HDR_END ) {
+        if ( !CAS( &q->wake_sock, &prev, sock ) ) {
 
-        return SH_ERR_STATE;
+            close( sock );
+            sock = q->wake_sock;
 
+        }
     }
 
-    return enq_data( q, data_slot );
+    struct sockaddr_un sa;
+    socklen_t len = ready_address( q, addr, &sa );
+    (void) sendto( sock, "", 0, MSG_DONTWAIT | MSG_NOSIGNAL,
+                   (struct sockaddr*) &sa, len );
 }
 
 
-static sh_status_e enqv(
+/*
+    notify -- signal subscribers of a kind
+
+    Note:  every notification advances the generation of its kind, and when
+    coalescing is on, or for readiness sockets, a subscriber is only signalled
+    again once it has observed the generation of its previous signal, so a
+    burst of notifications costs each subscriber at most one signal
+*/
+static void notify(
 
     shr_q_s *q,         // pointer to queue struct -- not NULL
-    sq_vec_s *vector,   // pointer to vector of items -- not NULL
-    int vcnt            // count of vector array -- must be >= 2
+    long kind           // kind of notification
 
 )   {
 
-    if ( q == NULL || vector == NULL || vcnt < 2 ) {
+    long *array = q->current->array;
 
-        return SH_ERR_ARG;
+    if ( array[ SUB_COUNT + kind ] == 0 ) {
+
+        return;
 
     }
 
-    long data_slot;
-    // allocate space and copy vector
-    data_slot = copy_vector( q, vector, vcnt );
+    long gen = AFA( &array[ SUB_GEN + kind ], 1 ) + 1;
+    bool coalesce = ( array[ FLAGS ] & FLAG_COALESCE ) != 0;
+    union sigval sv = { 0 };
 
-    if ( data_slot < 0 ) {
+    for ( long i = 0; i < SUB_SLOTS; i++ ) {
 
-        return SH_ERR_ARG;
+        // pid is read before signal, as entries are reclaimed in that order
+        long *entry = &array[ SUB_TABLE + ( i * LINE_SLOTS ) ];
+        long pid = LOAD_ACQ( &entry[ SUB_PID ] );
+        long signal = LOAD_ACQ( &entry[ SUB_SIGNAL ] );
 
-    }
+        if ( signal == 0 || entry[ SUB_KIND ] != kind ) {
 
-    if ( data_slot == 0 ) {
+            continue;
 
-        return SH_ERR_NOMEM;
+        }
 
-    }
+        if ( coalesce || signal < 0 ) {
 
-    if ( data_slot < HDR_END ) {
+            long sent = entry[ SUB_SENT ];
+            if ( sent > entry[ SUB_SEEN ] ) {
 
-        return SH_ERR_STATE;
+                continue;   // previous signal not yet observed
 
-    }
+            }
+
+            if ( !CAS( &entry[ SUB_SENT ], &sent, gen ) ) {
+
+                continue;
+
+            }
+        }
+
+        if ( signal < 0 ) {
+
+            wake_ready( q, entry[ SUB_ADDR ] );
+
+        } else {
 
-    return enq_data( q, data_slot );
+            (void) sigqueue( pid, signal, sv );
+
+        }
+    }
 }
 
 
-static long next_item(
+/*
+    observed_gen -- generation of a kind to be recorded as observed once the
+    subscriber has inspected the queue
+*/
+static inline long observed_gen(
 
-    shr_q_s *q,          // pointer to queue
-    long slot
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long kind           // kind of notification
 
 )   {
 
-    view_s view = insure_in_range( (shr_base_s*) q, slot );
-
-    if ( view.slot == 0 ) {
+    if ( q->sub[ kind ] == 0 ) {
 
         return 0;
 
     }
 
-    long *array = view.extent->array;
-    long next = array[ slot ];
+    return LOAD_ACQ( &q->current->array[ SUB_GEN + kind ] );
+}
 
-    if ( next == 0 ) {
 
-        return 0;
+/*
+    observe -- records generation read before inspecting queue as observed by
+    subscriber registered with handle, re-arming its signal
 
-    }
+    returns true if no notification of the kind happened since gen was read,
+    otherwise false and the queue needs to be inspected again
+*/
+static bool observe(
 
-    view = insure_in_range( (shr_base_s*) q, next + VALUE_OFFSET );
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long kind,          // kind of notification
+    long gen            // generation read before inspection
 
-    if ( view.slot == 0 ) {
+)   {
 
-        return 0;
+    long slot = q->sub[ kind ];
+
+    if ( slot == 0 ) {
+
+        return true;
 
     }
 
-    array = view.extent->array;
+    long *array = q->current->array;
+    long prev = array[ slot + SUB_SEEN ];
 
-    if ( next < HDR_END ) {
+    while ( prev < gen && !CAS( &array[ slot + SUB_SEEN ], &prev, gen ) ) {
 
-        return 0;
+        prev = array[ slot + SUB_SEEN ];
 
     }
 
-    return array[next + VALUE_OFFSET];
+    return ( LOAD_ACQ( &array[ SUB_GEN + kind ] ) == gen );
 }
 
 
-static bool item_exceeds_limit(
+static void signal_arrival(
 
-    shr_q_s *q,                     // pointer to queue
-    long item_slot,                 // array index for item
-    struct timespec *timelimit,     // expiration timelimit
-    struct timespec *curr_time      // current time
+    shr_q_s *q
 
 )   {
 
-    if ( q == NULL || item_slot < HDR_END || timelimit == NULL ) {
+    long *array = q->current->array;
 
-        return false;
+    if ( ( array[ SUB_COUNT + SUB_LISTEN ] || array[ SUB_COUNT + SUB_READY ] ) &&
+         array[ DEQ_GATE + GATE_VALUE ] == 0 ) {
 
-    }
+        notify( q, SUB_LISTEN );
+        notify( q, SUB_READY );
 
-    if ( timelimit->tv_sec == 0 && timelimit->tv_nsec == 0 ) {
+    }
+}
 
-        return false;
 
-    }
+/*
+    reclaim_sub -- claims subscriber entry for calling process if it is free or
+    its owner has ended without unsubscribing
 
-    view_s view = insure_in_range( (shr_base_s*) q, item_slot );
-    if ( view.slot != item_slot ) {
+    returns true if entry was claimed, otherwise false
+*/
+static bool reclaim_sub(
 
-        return false;
+    long *array,        // pointer to queue array -- not NULL
+    long slot,          // subscriber entry slot
+    long pid            // process id of calling process
 
-    }
+)   {
 
-    long *array = view.extent->array;
-    struct timespec diff = { 0, 0 };
-    struct timespec *item = (struct timespec *) &array[ item_slot + TM_SEC ];
-    timespecsub( curr_time, item, &diff );
-    return timespeccmp( &diff, timelimit, > );
-}
+    long owner = array[ slot + SUB_PID ];
 
-static bool item_exceeds_delay(
+    if ( owner == 0 ) {
 
-    shr_q_s *q,                     // pointer to queue
-    long item_slot,                 // array index for item
-    long *array                     // array to access
+        return CAS( &array[ slot + SUB_PID ], &owner, pid );
 
-)   {
+    }
 
-    if ( q == NULL || item_slot < HDR_END || array == NULL ) {
+    if ( kill( owner, 0 ) == 0 || errno != ESRCH ) {
 
         return false;
 
     }
 
-    struct timespec current;
-    clock_gettime( CLOCK_REALTIME, &current );
-    if ( is_codel_active( array ) ) {
+    // clearing signal of a complete entry decides which process reclaims it
+    long signal = array[ slot + SUB_SIGNAL ];
 
-        struct timespec intrvl = { 0 };
-        struct timespec last = *(struct timespec*) &array[ EMPTY_SEC ];
+    if ( signal != 0 ) {
 
-        if ( last.tv_sec == 0 ) {
+        if ( !CAS( &array[ slot + SUB_SIGNAL ], &signal, 0 ) ) {
 
-            return item_exceeds_limit(q, item_slot,
-                                      (struct timespec*) &array[ LIMIT_SEC ],
-                                      &current );
-        }
+            return false;
 
-        timespecsub( &current, (struct timespec*) &array[ LIMIT_SEC ], &intrvl );
+        }
 
-        if ( timespeccmp( &last, &intrvl, < ) ) {
+        (void) AFS( &array[ SUB_COUNT + array[ slot + SUB_KIND ] ], 1 );
 
-            return item_exceeds_limit(q, item_slot,
-                                      (struct timespec*) &array[ TARGET_SEC ],
-                                      &current );
-        }
     }
 
-    return item_exceeds_limit( q, item_slot,
-                               (struct timespec*) &array[ LIMIT_SEC ],
-                               &current );
+    return CAS( &array[ slot + SUB_PID ], &owner, pid );
 }
 
 
-static void clear_empty_timestamp(
+/*
+    subscribe -- registers, updates, or with a zero signal removes subscriber
+    entry of calling process for kind of notification, reclaiming entries of
+    processes that ended without unsubscribing
+*/
+static sh_status_e subscribe(
 
-    long *array      // active q array
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long kind,          // kind of notification
+    int signal,         // signal to send, -1 for socket, 0 to unsubscribe
+    long addr           // handle id naming readiness socket, 0 for signal
 
 )   {
 
-    volatile struct timespec last =
-        *(struct timespec * volatile) &array[ EMPTY_SEC ];
+    long *array = q->current->array;
+    long pid = getpid();
 
-    DWORD next = { .high = 0, .low = 0 };
+    for ( long i = 0; i < SUB_SLOTS; i++ ) {
 
-    while ( !DWCAS( (DWORD*) &array[ EMPTY_SEC ], (DWORD*) &last, next ) ) {
+        long slot = SUB_TABLE + ( i * LINE_SLOTS );
 
-        last = *(struct timespec * volatile) &array[ EMPTY_SEC ];
+        if ( array[ slot + SUB_PID ] != pid || array[ slot + SUB_KIND ] != kind ||
+             array[ slot + SUB_ADDR ] != addr ) {
 
-    }
-}
+            continue;
 
+        }
 
-static sh_status_e resize_buffer(
+        if ( signal != 0 ) {
 
-    long *array,        // pointer to queue array
-    long data_slot,     // data item index
-    void **buffer,      // address of buffer pointer, or NULL
-    size_t *buff_size,  // pointer to length of buffer if buffer present
-    long size           // required size of data
+            STORE_REL( &array[ slot + SUB_SIGNAL ], signal );
+            q->sub[ kind ] = slot;
+            return SH_OK;
 
-)   {
+        }
 
-    long total = size + array[ data_slot + VEC_CNT ] * sizeof(sq_vec_s);
+        STORE_REL( &array[ slot + SUB_SIGNAL ], 0 );
+        (void) AFS( &array[ SUB_COUNT + kind ], 1 );
+        STORE_REL( &array[ slot + SUB_PID ], 0 );
+        q->sub[ kind ] = 0;
+        return SH_OK;
 
-    if ( *buffer && *buff_size < total ) {
+    }
 
-        free( *buffer );
-        *buffer = NULL;
-        *buff_size = 0;
+    if ( signal == 0 ) {
+
+        q->sub[ kind ] = 0;
+        return SH_OK;
 
     }
 
-    if ( *buffer == NULL ) {
+    for ( long i = 0; i < SUB_SLOTS; i++ ) {
 
-        *buffer = malloc( total );
-        *buff_size = total;
+        long slot = SUB_TABLE + ( i * LINE_SLOTS );
 
-        if ( *buffer == NULL ) {
+        if ( !reclaim_sub( array, slot, pid ) ) {
 
-            *buff_size = 0;
-            return SH_ERR_NOMEM;
+            continue;
 
         }
+
+        long gen = array[ SUB_GEN + kind ];
+        array[ slot + SUB_KIND ] = kind;
+        array[ slot + SUB_ADDR ] = addr;
+        array[ slot + SUB_SENT ] = gen;
+        array[ slot + SUB_SEEN ] = gen;
+        STORE_REL( &array[ slot + SUB_SIGNAL ], signal );
+        (void) AFA( &array[ SUB_COUNT + kind ], 1 );
+        q->sub[ kind ] = slot;
+        return SH_OK;
+
     }
 
-    return SH_OK;
+    return SH_ERR_STATE;    // subscriber table full
 }
 
 
-static void initialize_item_vector(
+static inline bool is_discard_on_expire(
 
-    sq_item_s *item     // pointer to item -- not NULL
+    long *array
 
 )   {
 
-    uint8_t *current = (uint8_t*) item->value;
+    return ( array[ FLAGS ] & FLAG_DISCARD_EXPIRED );
+}
 
-    for ( int i = 0; i < item->vcount; i++ ) {
 
-        item->vector[ i ].type = (sh_type_e) *(long*) current;
-        current += sizeof(long);
-        item->vector[ i ].len = *(long*) current;
-        current += sizeof(long);
-        item->vector[ i ].base = current;
+static inline bool is_adaptive_lifo(
 
-        if ( item->vector[ i ].len <= sizeof(long) ) {
+    long *array
 
-            current += sizeof(long);
+)   {
 
-        } else {
+    return ( array[ FLAGS ] & FLAG_LIFO_ON_LEVEL );
+}
 
-            current += ( item->vector[ i ].len >> SZ_SHIFT ) << SZ_SHIFT;
 
-            if ( item->vector[ i ].len & REM ) {
+static inline bool is_ring(
 
-                current += sizeof(long);
+    shr_q_s *q
 
-            }
-        }
-    }
+)   {
+
+    return ( q->attr_flags & SQ_SPSC );
 }
 
 
-static void copy_to_buffer(
+static inline bool is_slab(
 
-    long *array,        // pointer to queue array -- not NULL
-    long data_slot,     // data item index
-    sq_item_s *item,    // pointer to item -- not NULL
-    void **buffer,      // address of buffer pointer, or NULL
-    size_t *buff_size   // pointer to length of buffer if buffer present
+    shr_q_s *q
 
 )   {
 
-    long size = ( array[ data_slot + DATA_SLOTS ] << SZ_SHIFT ) - sizeof(long);
-    sh_status_e status = resize_buffer( array, data_slot, buffer, buff_size, size );
-
-    if ( status != SH_OK ) {
-
-        item->status = SH_ERR_NOMEM;
-        return;
-
-    }
+    return q->slab_slots > 0;
+}
 
-    memcpy( *buffer, &array[ data_slot + 1 ], size );
-    item->buffer = *buffer;
-    item->buf_size = size;
-    item->type = array[ data_slot + TYPE ];
-    item->length = array[ data_slot + DATA_LENGTH ];
-    item->timestamp = *buffer;
-    item->value = (uint8_t*) *buffer + ( ( DATA_HDR - 1 ) * sizeof(long) );
-    item->vcount = array[ data_slot + VEC_CNT ];
-    item->vector = (sq_vec_s*) ( (uint8_t*) *buffer + size );
 
-    if ( item->vcount == 1 ) {
+/*
+    next_lane -- lane to remove next item from, the highest non-empty lane
+    unless weighted, in which case lane k is tried first on every 2^(n-k)th
+    remove so lower lanes keep draining while higher lanes stay busy
 
-        item->vector[ 0 ].type = (sh_type_e) array[ data_slot + TYPE ];
-        item->vector[ 0 ].len = item->length;
-        item->vector[ 0 ].base = item->value;
+    returns lane number, or -1 if all lanes are empty
+*/
+static long next_lane(
 
-    } else {
+    shr_q_s *q          // pointer to queue
 
-        initialize_item_vector( item );
-    }
-}
+)   {
 
+    long *array = q->current->array;
+    long top = q->lanes - 1;
+    long start = top;
 
-static long remove_top(
+    if ( top > 0 && ( q->attr_flags & SQ_WEIGHTED ) ) {
 
-    shr_q_s *q,         // pointer to queue struct -- not NULL
-    long top,           // expected slot number -- 0 if no interest
-    long gen            // generation count
+        start -= __builtin_ctzl( ++q->lane_turn );
+        if ( start < 0 ) {
 
-)   {
+            start = 0;
 
-    view_s view = { .status = SH_OK, .extent = q->current, .slot = 0 };
-    volatile long * volatile array = view.extent->array;
-    DWORD before;
-    DWORD after;
+        }
+    }
 
-    if ( top >= HDR_END && top == array[ STACK_HEAD ] &&
-         gen == array[STACK_HD_CNT] ) {
+    // try starting lane and those below it, then wrap to those above it
+    for ( long i = 0; i <= top; i++ ) {
 
-        view = insure_in_range( (shr_base_s*) q, top );
-        array = view.extent->array;
-        after.low = array[ top ];
-        before.high = gen;
-        after.high = before.high + 1;
-        before.low = (ulong) top;
+        long lane = ( start - i >= 0 ) ? start - i : top - ( i - start - 1 );
 
-        if ( DWCAS( (DWORD*) &array[ STACK_HEAD ], &before, after ) ) {
+        if ( array[ lane_head( lane ) ] != array[ lane_tail( lane ) ] ) {
 
-            memset( (void*) &array[ top ], 0, 2 << SZ_SHIFT );
-            return top;
+            return lane;
 
         }
     }
 
-    return 0;
+    return -1;
 }
 
 
-static long lifo_remove(
+static inline bool is_broadcast(
 
-    shr_q_s *q          // pointer to queue
+    shr_q_s *q
 
 )   {
 
-    long *array = q->current->array;
-    long gen = array[ STACK_HD_CNT ];
-    long top = array[ STACK_HEAD ];
+    return ( q->attr_flags & SQ_BROADCAST );
+}
 
-    view_s view = insure_in_range( (shr_base_s*) q, top );
-    array = view.extent->array;
-    long data_slot = array[ top + VALUE_OFFSET ];
 
-    if ( data_slot == 0 ) {
+static inline bool is_codel_active(
 
-        return 0;   // try again
+    long *array
 
-    }
+)   {
 
-    if ( remove_top( q, top, gen ) == 0) {
+    return ( ( array[ TARGET_NSEC ] || array[ TARGET_SEC ] ) &&
+             ( array[ LIMIT_NSEC ] || array[ LIMIT_SEC ] ) );
+}
 
-        return 0;   // try again
 
-    }
+/*
+    mag_acquire -- attempts to take exclusive use of process local magazine,
+    does not wait if another thread of this process is using it
+*/
+static inline bool mag_acquire(
 
-    // free queue node
-    add_end( (shr_base_s*) q, top, FREE_TAIL );
-    return data_slot;
+    shr_q_s *q
+
+)   {
+
+    atomictype unlocked = 0;
+    return CAS( &q->mag_lock, &unlocked, 1 );
 }
 
 
-static long fifo_remove(
+static inline void mag_release(
 
-    shr_q_s *q          // pointer to queue
+    shr_q_s *q
 
 )   {
 
-    long *array = q->current->array;
-    long gen = array[ HEAD_CNT ];
-    long head = array[ HEAD ];
+    STORE_REL( &q->mag_lock, 0 );
+}
 
-    if ( head == array[ TAIL ] ) {
 
-        return 0;   // try again
+/*
+    mag_refill -- refill magazine with a chunk of nodes taken from the shared
+    free node list in one update, or carved from unused space
+*/
+static void mag_refill(
 
-    }
+    shr_q_s *q          // pointer to queue struct -- not NULL
 
-    view_s view = insure_in_range( (shr_base_s*) q, head );
-    array = view.extent->array;
-    long data_slot = next_item( q, head );
+)   {
 
-    if ( data_slot == 0 ) {
+    for ( int i = 0; i < 4 && q->mag_count == 0; i++ ) {
 
-        return 0;   // try again
+        q->mag_count = remove_front_chain( (shr_base_s*) q, q->mag, MAG_CHUNK,
+                                           FREE_HEAD, FREE_TAIL );
 
     }
 
-    if ( remove_front( (shr_base_s*) q, head, gen, HEAD, TAIL ) == 0 ) {
+    if ( q->mag_count > 0 ) {
 
-        return 0;   // try again
+        return;
 
     }
 
-    // free queue node
-    add_end( (shr_base_s*) q, head, FREE_TAIL );
-    return data_slot;
-}
-
+    view_s view = alloc_new_data( (shr_base_s*) q, MAG_CHUNK * NODE_SIZE );
 
-static bool safely_copy_data(
+    if ( view.slot == 0 ) {
 
-    shr_q_s *q,         // pointer to queue
-    long data_slot,     // array index of data
-    sq_item_s *item,    // item pointer
-    void **buffer,      // address of buffer pointer, or NULL
-    size_t *buff_size   // pointer to length of buffer if buffer present
+        return;
 
-)   {
+    }
 
-    // insure data is accessible
-    view_s view = insure_in_range( (shr_base_s*) q, data_slot );
-    if ( view.slot == 0 ) {
+    for ( long i = 0; i < MAG_CHUNK; i++ ) {
 
-        return false;
+        q->mag[ i ] = view.slot + ( ( MAG_CHUNK - 1 - i ) * NODE_SIZE );
 
     }
 
-    long *array = view.extent->array;
-    long end_slot = data_slot + array[ data_slot + DATA_SLOTS ] - 1;
-    view = insure_in_range( (shr_base_s*) q, end_slot );
+    q->mag_count = MAG_CHUNK;
+}
 
-    if ( view.slot == 0 ) {
 
-        return false;
+/*
+    mag_flush -- return nodes held in magazine to shared free node list with
+    a single splice
+*/
+static void mag_flush(
 
-    }
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long count          // number of nodes to flush
 
-    array = view.extent->array;
+)   {
 
-    copy_to_buffer( array, data_slot, item, buffer, buff_size );
-    return true;
+    if ( count > 0 ) {
+
+        q->mag_count -= count;
+        add_chain_end( (shr_base_s*) q, &q->mag[ q->mag_count ], count, FREE_TAIL );
+
+    }
 }
 
 
-static void post_process_deq(
+/*
+    alloc_node -- allocate queue node from process local magazine, falling
+    back to the shared free node list if magazine is in use by another thread
+*/
+static view_s alloc_node(
 
-    shr_q_s *q,         // pointer to queue
-    long data_slot,     // array index of data
-    sq_item_s *item     // item pointer
+    shr_q_s *q          // pointer to queue struct -- not NULL
 
 )   {
 
-    view_s view = { .extent = q->current };
-    long *array = view.extent->array;
-    long count = AFS( (atomictype*)&array[ COUNT ], 1 );
+    if ( mag_acquire( q ) ) {
 
-    if ( is_codel_active( array ) && count == 1 ) {
+        if ( q->mag_count == 0 ) {
 
-        clear_empty_timestamp( array );
+            mag_refill( q );
 
-    }
+        }
 
-    bool expired = is_discard_on_expire( array ) &&
-                   item_exceeds_delay( q, data_slot, array );
-    bool need_signal = false;
+        if ( q->mag_count > 0 ) {
 
-    if ( count == 1 ) {
+            long node = q->mag[ --q->mag_count ];
+            mag_release( q );
+            memset( &q->current->array[ node ], 0, NODE_SIZE << SZ_SHIFT );
+            return (view_s) { .status = SH_OK, .slot = node, .extent = q->current };
+
+        }
 
-        need_signal |= add_event( q, SQ_EVNT_EMPTY );
+        mag_release( q );
 
     }
 
-    if ( expired ) {
+    return alloc_idx_slots( (shr_base_s*) q );
+}
 
-        need_signal |= add_event( q, SQ_EVNT_TIME );
 
-    }
+/*
+    free_node -- return queue node to process local magazine, flushing a chunk
+    to the shared free node list when magazine is full
+*/
+static void free_node(
 
-    if ( expired && is_discard_on_expire( array ) ) {
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long node           // queue node
 
-        memset( item, 0, sizeof(sq_item_s) );
-        free_data_slots( (shr_base_s*) q, data_slot );
-        item->status = SH_ERR_EXIST;
+)   {
 
-    } else {
+    if ( mag_acquire( q ) ) {
 
-        item->status = free_data_slots( (shr_base_s*) q, data_slot );
+        if ( q->mag_count == MAG_SIZE ) {
 
-    }
+            mag_flush( q, MAG_CHUNK );
 
-    if ( need_signal && is_monitored( array ) ) {
+        }
 
-        signal_event( q );
+        q->mag[ q->mag_count++ ] = node;
+        mag_release( q );
+        return;
 
     }
 
+    add_end( (shr_base_s*) q, node, FREE_TAIL );
 }
 
 
-static sq_item_s deq(
+static long get_event_flag(
 
-    shr_q_s *q,         // pointer to queue
-    void **buffer,      // address of buffer pointer, or NULL
-    size_t *buff_size   // pointer to length of buffer if buffer present
+    sq_event_e event
 
 )   {
 
-    view_s view = { .extent = q->current };
-    long *array = view.extent->array;
-    sq_item_s item = { .status = SH_ERR_EMPTY };
-    long data_slot = 0;
-
-    while ( data_slot == 0 ) {
-
-        if ( array[ STACK_HEAD ] == 0 ) {
-
-            long head = array[ HEAD ];
-            if (head == array[ TAIL ] ) {
+    switch ( event ) {
 
-                release_prev_extents( (shr_base_s*) q );
-                return item;    // queue empty
+        case SQ_EVNT_ALL:
 
-            }
+            return ( FLAG_EVNT_INIT | FLAG_EVNT_LIMIT | FLAG_EVNT_EMPTY |
+                    FLAG_EVNT_LEVEL | FLAG_EVNT_NONEMPTY | FLAG_EVNT_TIME );
 
-            data_slot = fifo_remove( q );
+        case SQ_EVNT_INIT:
 
-        } else {
+            return FLAG_EVNT_INIT;
 
-            data_slot = lifo_remove( q );
+        case SQ_EVNT_LIMIT:
 
-        }
-    }
+            return FLAG_EVNT_LIMIT;
 
-    if ( safely_copy_data( q, data_slot, &item, buffer, buff_size ) ) {
+        case SQ_EVNT_EMPTY:
 
-        post_process_deq( q, data_slot, &item );
+            return FLAG_EVNT_EMPTY;
 
-    }
+        case SQ_EVNT_LEVEL:
 
-    release_prev_extents( (shr_base_s*) q );
-    return item;
-}
+            return FLAG_EVNT_LEVEL;
 
+        case SQ_EVNT_NONEMPTY:
 
-static sq_event_e next_event(
+            return FLAG_EVNT_NONEMPTY;
 
-    shr_q_s *q,          // pointer to queue
-    long slot
+        case SQ_EVNT_TIME:
 
-)   {
+            return FLAG_EVNT_TIME;
 
-    view_s view = insure_in_range( (shr_base_s*) q, slot );
-    if ( view.slot == 0 ) {
+        default:
 
-        return SQ_EVNT_NONE;
+            break;
+        }
 
-    }
+    return 0;
+}
 
-    long *array = view.extent->array;
-    long next = array[ slot ];
 
-    view = insure_in_range( (shr_base_s*) q, next );
-    if ( view.slot == 0 ) {
+static inline bool event_disabled(
 
-        return SQ_EVNT_NONE;
+    long *array,
+    sq_event_e event
 
-    }
+)   {
 
-    array = view.extent->array;
-    return array [ next + EVENT_OFFSET ];
+    return !( array[ FLAGS ] & get_event_flag( event ) );
 }
 
 
-static void check_for_level_event(
+static bool add_event(
 
-    shr_q_s *q          // pointer to queue
+    shr_q_s *q,
+    sq_event_e event
 
 )   {
 
     view_s view = { .extent = q->current };
+
     long *array = view.extent->array;
 
-    long level = array[ LEVEL ];
-    if ( level <= 0 ) {
+    if ( event == SQ_EVNT_NONE || event_disabled( array, event ) ) {
 
-        return;
+        return false;
 
     }
 
-    if ( event_disabled( array, SQ_EVNT_LEVEL ) )
-    {
-        return;
-    }
+    // insure event is a one shot by clearing subscription atomically
+    long flag = get_event_flag(event);
+    long prev = array[FLAGS];
 
-    if ( array[ COUNT ] >= level && add_event( q, SQ_EVNT_LEVEL ) ) {
+    if (!CAS( &array[ FLAGS ], &prev, prev & ~flag ) ) {
 
-        signal_event( q );
+        return false;
 
     }
 
-    return;
-}
-
-
-static sh_status_e initialize_q_struct(
-
-    shr_q_s **q,            // address of q struct pointer -- not NULL
-    sq_mode_e mode          // read/write mode
-
-) {
-
-    *q = calloc( 1, sizeof(shr_q_s) );
-    if ( *q == NULL ) {
+    // allocate queue node
+    view = alloc_node( q );
+    if ( view.slot == 0 ) {
 
-        return SH_ERR_NOMEM;
+        return false;
 
     }
 
-    (*q)->current = calloc( 1, sizeof(extent_s) );
-    if ( (*q)->current == NULL ) {
-
-        free( *q );
-        *q = NULL;
-        return SH_ERR_NOMEM;
+    array = view.extent->array;
+    array[ view.slot + EVENT_OFFSET ] = event;
 
-    }
+    // append node to end of queue
+    add_end( (shr_base_s*)q, view.slot, EVENT_TAIL );
 
-    (*q)->prev = (*q)->current;
-    (*q)->mode = mode;
+    // release read of event
+    gate_post( &array[ EVNT_GATE ], 1 );
 
-    return SH_OK;
+    return true;
 }
 
 
+static void update_empty_timestamp(
 
-static bool is_valid_queue(
-
-    shr_q_s *q          // pointer to queue
+    shr_q_s *q,      // pointer to queue, not NULL
+    long *array      // active q array
 
 )   {
 
-    if ( memcmp( &q->current->array[ TAG ], SHRQ, sizeof(SHRQ) - 1 ) != 0 ) {
+    struct timespec curr_time;
+    queue_time( q, &curr_time );
+    struct timespec last = *(struct timespec * volatile) &array[ EMPTY_SEC ];
+    DWORD next = { .low = curr_time.tv_sec, .high = curr_time.tv_nsec };
 
-        return false;
+    while ( timespeccmp(&curr_time, &last, > ) ) {
 
-    }
+        if ( DWCAS( (DWORD*) &array[ EMPTY_SEC ], (DWORD*) &last, next ) ) {
 
-    if ( q->current->array[ VERSION ] != QVERSION ) {
+            break;
 
-        return false;
+        }
 
+        last = *(struct timespec * volatile) &array[ EMPTY_SEC ];
     }
-
-    return true;
 }
 
 
-static sh_status_e release_semaphores(
+static void clear_empty_timestamp(
 
-    shr_q_s **q         // address of q struct pointer -- not NULL
+    long *array      // active q array
 
 )   {
 
-    int rc = sem_destroy( (sem_t*) &(*q)->current->array[ DEQ_SEM ] );
-    if ( rc < 0 ) {
-
-        return SH_ERR_SYS;
+    volatile struct timespec last =
+        *(struct timespec * volatile) &array[ EMPTY_SEC ];
 
-    }
+    DWORD next = { .high = 0, .low = 0 };
 
-    rc = sem_destroy( (sem_t*) &(*q)->current->array[ ENQ_SEM ] );
-    if ( rc < 0 ) {
+    while ( !DWCAS( (DWORD*) &array[ EMPTY_SEC ], (DWORD*) &last, next ) ) {
 
-        return SH_ERR_SYS;
+        last = *(struct timespec * volatile) &array[ EMPTY_SEC ];
 
     }
+}
 
-    rc = sem_destroy( (sem_t*) &(*q)->current->array[ EVNT_SEM ] );
-    if ( rc < 0 ) {
-
-        return SH_ERR_SYS;
 
-    }
+/*
+    count_add -- adjust item count in the stripe for the cpu of the caller
+*/
+static inline void count_add(
 
-    return SH_OK;
-}
+    long *array,        // active q array
+    long value          // value to add to count
 
+)   {
 
-static sh_status_e deq_gate_try(
+    int cpu = sched_getcpu();
+    long stripe = CNT_STRIPE;
 
-    shr_q_s *q          // pointer to queue
+    if ( cpu > 0 ) {
 
-)   {
+        stripe += ( cpu & ( COUNT_STRIPES - 1 ) ) * LINE_SLOTS;
 
-    while ( sem_trywait( (sem_t*) &q->current->array[ DEQ_SEM ] ) < 0 ) {
+    }
 
-        if ( errno == EAGAIN ) {
+    (void) AFA( &array[ stripe ], value );
+}
 
-            if ( is_call_monitored( q->current->array ) ) {
 
-                signal_call( q );
+/*
+    count_items -- exact item count as sum of count stripes
+*/
+static long count_items(
 
-            }
+    long *array         // active q array
 
-            return SH_ERR_EMPTY;
+)   {
 
-        }
+    long count = 0;
 
-        if ( errno == EINVAL ) {
+    for ( long i = 0; i < COUNT_STRIPES; i++ ) {
 
-            return SH_ERR_STATE;
+        count += array[ CNT_STRIPE + ( i * LINE_SLOTS ) ];
 
-        }
     }
 
-    return SH_OK;
+    return count;
 }
 
 
-static sh_status_e deq_gate_blk(
+/*
+    count_approx -- approximate item count from the tokens of the deq gate,
+    items being added or removed by other callers may not be reflected
+*/
+static inline long count_approx(
 
-    shr_q_s *q          // pointer to queue
+    long *array         // active q array
 
 )   {
 
-    (void) AFA( &q->current->array[CALL_BLOCKS], 1 );
+    return array[ DEQ_GATE + GATE_VALUE ];
+}
 
-    if ( is_call_monitored( q->current->array ) ) {
-        signal_call( q );
-    }
 
-    while ( sem_wait( (sem_t*) &q->current->array[ DEQ_SEM ] ) < 0 ) {
+/*
+    settle_occupancy -- records transitions of queue between empty and holding
+    items in FLAG_OCCUPIED, and adds an event for each transition made by the
+    caller
 
-        if ( errno == EINVAL ) {
+    Note:  the count is read again after each transition, so the flag agrees
+    with the count once the last caller to change the count returns, and the
+    count may lag adds still in progress, which settle the flag themselves
 
-            (void) AFA( &q->current->array[ CALL_UNBLOCKS ], 1 );
-            return SH_ERR_STATE;
+    returns true if an event was added, otherwise, false
+*/
+static bool settle_occupancy(
 
-        }
-    }
+    shr_q_s *q,         // pointer to queue, not NULL
+    long *array         // active q array
 
-    (void) AFA( &q->current->array[CALL_UNBLOCKS], 1 );
-    return SH_OK;
-}
+)   {
 
+    bool need_signal = false;
 
-static sh_status_e deq_gate_tm(
+    while ( true ) {
 
-    shr_q_s *q,                 // pointer to queue
-    struct timespec *timeout    // timeout value -- not NULL
+        bool occupied = ( LOAD_ACQ( &array[ FLAGS ] ) & FLAG_OCCUPIED ) != 0;
 
-)   {
+        // posted tokens are items already counted, so avoid summing stripes
+        bool holds = count_approx( array ) > 0 || count_items( array ) > 0;
 
-    (void) AFA( &q->current->array[ CALL_BLOCKS ], 1 );
+        if ( holds == occupied ) {
 
-    if ( is_call_monitored( q->current->array ) ) {
+            return need_signal;
 
-        signal_call( q );
+        }
 
-    }
+        if ( holds ) {
 
-    struct timespec ts;
-    clock_gettime( CLOCK_REALTIME, &ts );
-    timespecadd( &ts, timeout, &ts );
+            if ( set_flag( array, FLAG_OCCUPIED ) ) {
 
-    while ( sem_timedwait( (sem_t*) &q->current->array[ DEQ_SEM ], &ts ) < 0 ) {
+                update_empty_timestamp( q, array );
+                need_signal |= add_event( q, SQ_EVNT_NONEMPTY );
 
-        if ( errno == ETIMEDOUT ) {
+            }
 
-            (void) AFA( &q->current->array[ CALL_UNBLOCKS ], 1 );
-            return SH_ERR_EMPTY;
+        } else if ( clear_flag( array, FLAG_OCCUPIED ) ) {
 
-        }
+            if ( is_codel_active( array ) ) {
 
-        if ( errno == EINVAL ) {
+                clear_empty_timestamp( array );
 
-            (void) AFA( &q->current->array[ CALL_UNBLOCKS ], 1 );
-            return SH_ERR_STATE;
+            }
+
+            need_signal |= add_event( q, SQ_EVNT_EMPTY );
 
         }
     }
-
-    (void) AFA( &q->current->array[ CALL_UNBLOCKS ], 1 );
-    return SH_OK;
 }
 
 
-static sh_status_e enq_gate_try(
+static void lifo_add(
 
-    shr_q_s *q          // pointer to queue
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long slot           // slot reference
 
 )   {
 
-    while ( sem_trywait( (sem_t*) &q->current->array[ ENQ_SEM ] ) < 0 ) {
+    atomictype * volatile array = (atomictype*) q->current->array;
 
-        if ( errno == EAGAIN ) {
+    DWORD stack_before;
+    DWORD stack_after;
 
-            return SH_ERR_LIMIT;
+    do {
 
-        }
+        array[ slot ] = array[ STACK_HEAD ];
+        array[ slot + 1 ] = array[ STACK_HD_CNT ];
+        stack_before = *( (DWORD * volatile) &array[ slot ] );
+        stack_after.low = slot;
+        stack_after.high = stack_before.high + 1;
 
-        if ( errno == EINVAL ) {
+    } while ( !DWCAS( (DWORD*) &array[ STACK_HEAD ], &stack_before, stack_after ) );
+}
 
-            return SH_ERR_STATE;
 
-        }
-    }
+/*
+    commit_adds -- returns once file of queue has been flushed after adds of
+    caller, the first caller to find no flush in progress flushes the file for
+    itself and every caller waiting with it
 
-    return SH_OK;
-}
+    Note:  a flush left unfinished by an ended process is taken over
+*/
+static void commit_adds(
 
+    shr_q_s *q          // pointer to queue, not NULL
 
-static sh_status_e enq_gate_blk(
+)   {
 
-    shr_q_s *q          // pointer to queue
+    long *array = q->current->array;
+    long ticket = AFA( &array[ SYNC_REQ ], 1 ) + 1;
 
-)   {
+    while ( LOAD_ACQ( &array[ SYNC_DONE ] ) < ticket ) {
 
-    while ( sem_wait( (sem_t*) &q->current->array[ ENQ_SEM ] ) < 0 ) {
+        long leader = array[ SYNC_LOCK ];
 
-        if ( errno == EINVAL ) {
+        if ( leader != 0 && ( kill( leader, 0 ) == 0 || errno != ESRCH ) ) {
 
-            return SH_ERR_STATE;
+            sched_yield();
+            continue;
 
         }
-    }
 
-    return SH_OK;
+        if ( !CAS( &array[ SYNC_LOCK ], &leader, getpid() ) ) {
+
+            continue;
+
+        }
+
+        // every ticket taken so far was taken after its adds completed
+        long covered = LOAD_ACQ( &array[ SYNC_REQ ] );
+        (void) fdatasync( q->fd );
+
+        long done = array[ SYNC_DONE ];
+        while ( done < covered && !CAS( &array[ SYNC_DONE ], &done, covered ) );
+
+        STORE_REL( &array[ SYNC_LOCK ], 0 );
+    }
 }
 
 
-static sh_status_e enq_gate_tm(
+/*
+    Note:  called before deq gate tokens for items added are posted, the enq
+    gate has no tokens left when the add reached the depth limit, and a lean
+    queue only maintains the count
+*/
+static void post_process_enq(
 
-    shr_q_s *q,                 // pointer to queue
-    struct timespec *timeout    // timeout value -- not NULL
+    shr_q_s *q,         // pointer to queue, not NULL
+    long added,         // number of items added
+    DWORD curr_time     // current item time stamp
 
 )   {
 
+    if ( q->sync == SQ_SYNC_COMMIT ) {
+
+        commit_adds( q );
+
+    }
+
     long *array = q->current->array;
-    struct timespec ts;
-    clock_gettime( CLOCK_REALTIME, &ts );
-    timespecadd( &ts, timeout, &ts );
+    count_add( array, added );
 
-    while ( sem_timedwait( (sem_t*) &array[ ENQ_SEM ], &ts ) < 0 ) {
+    if ( is_lean( q ) ) {
 
-        if ( errno == ETIMEDOUT ) {
+        return;
 
-            return SH_ERR_LIMIT;
+    }
 
-        }
+    bool need_signal = false;
 
-        if ( errno == EINVAL ) {
+    if ( !( array[ FLAGS ] & FLAG_ACTIVATED ) ) {
 
-            return SH_ERR_STATE;
+        if ( set_flag( array, FLAG_ACTIVATED ) ) {
+
+            need_signal |= add_event( q, SQ_EVNT_INIT );
 
         }
+
     }
 
-    return SH_OK;
-}
+    // an add can only fill a queue, so skip the count when already occupied
+    if ( !( LOAD_ACQ( &array[ FLAGS ] ) & FLAG_OCCUPIED ) ) {
 
+        need_signal |= settle_occupancy( q, array );
 
-static sh_status_e deq_release_gate(
+    }
 
-    shr_q_s *q          // pointer to queue
+    if ( array[ ENQ_GATE + GATE_VALUE ] == 0 ) {
 
-)   {
+        need_signal |= add_event( q, SQ_EVNT_LIMIT );
 
-    while ( sem_post( (sem_t*) &q->current->array[ DEQ_SEM ]) < 0 ) {
+    }
 
-        if ( errno == EINVAL ) {
+    if ( need_signal ) {
 
-            return SH_ERR_STATE;
+        notify( q, SUB_MONITOR );
 
-        }
     }
 
-    return SH_OK;
+    // update last add timestamp
+    struct timespec prev_time = *(struct timespec*) &array[ TS_SEC ];
+    DWCAS( (DWORD*) &array[ TS_SEC ], (DWORD*) &prev_time, curr_time );
+    signal_arrival( q );
 }
 
 
-static sh_status_e enq_release_gate(
+static inline void fifo_add(
 
-    shr_q_s *q          // pointer to queue
+    shr_q_s *q,         // pointer to queue, not NULL
+    long slot,          // slot reference
+    long lane           // priority lane
 
 )   {
 
-    while ( sem_post( (sem_t*) &q->current->array[ ENQ_SEM ] ) < 0 ) {
+    // append node to end of lane
+    add_end( (shr_base_s*) q, slot, lane_tail( lane ) );
+}
 
-        if ( errno == EINVAL ) {
 
-            return SH_ERR_STATE;
+static sh_status_e enq_node(
 
-        }
+    shr_q_s *q,         // pointer to queue, not NULL
+    long node,          // queue node pointing to data to be added
+    long lane           // priority lane
+
+)   {
+
+    long *array = q->current->array;
+    long data_slot = array[ node + VALUE_OFFSET ];
+    DWORD curr_time = { .low = array[ data_slot + TM_SEC ],
+                        .high = array[ data_slot + TM_NSEC ] };
+
+    if ( is_adaptive_lifo( array ) && ( count_approx( array ) >= array[ LEVEL ] ) ) {
+
+        lifo_add( q, node );
+
+    } else {
+
+        fifo_add( q, node, lane );
     }
 
+    post_process_enq( q, 1, curr_time );
+
     return SH_OK;
 }
 
 
-static inline void guard_q_memory(
+static sh_status_e enq_data(
 
-    shr_q_s *q          // pointer to queue
+    shr_q_s *q,         // pointer to queue, not NULL
+    long data_slot,     // data to be added to queue
+    long lane           // priority lane
 
 )   {
-    (void) AFA( &q->accessors, 1 );
-}
-
 
-static inline void unguard_q_memory(
+    // allocate queue node
+    view_s view = alloc_node( q );
 
-    shr_q_s *q          // pointer to queue
+    if ( view.slot == 0 ) {
 
-)   {
-    (void) AFS( &q->accessors, 1 );
-}
+        free_data_slots( (shr_base_s*) q, data_slot );
+        return SH_ERR_NOMEM;
 
+    }
 
-/*
-================================================================================
+    long node = view.slot;
+    long *array = view.extent->array;
 
-    public function interface
+    // point queue node to data slot
+    array[ node + VALUE_OFFSET ] = data_slot;
 
-================================================================================
-*/
+    return enq_node( q, node, lane );
+}
 
 
 /*
-    shr_q_create -- create shared memory queue using name
+    slab_value -- allocate slab node and copy value or vector into data area
+    that follows node header
 
-    Creates shared queue using name to mmap POSIX shared memory object.
+    returns slot of node, 0 if memory not available, or -1 if item does not
+    fit in fixed item size
+*/
+static long slab_value(
 
-    The max depth argument specifies the maximum number of items allowed on
-    queue.  When max depth is reached a depth event is generated and no more
-    items can be added to queue.  A value of 0 defaults to max possible value.
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    void *value,        // pointer to value data, or NULL if vector
+    long length,        // length of data
+    sh_type_e type,     // data type
+    sq_vec_s *vector,   // pointer to vector of items, or NULL
+    int vcnt            // count of vector array
 
-    The mode specifies the ability to add items to or remove items from the
-    queue.  The default of 0 indicates that queue instance is unable to make
-    changes to the shared queue.
+)   {
 
-    The returned queue will be opened for updates unless the mode specifies it
-    as immutable.
+    long space = q->slab_slots - NODE_SIZE;
+    long item_size = q->current->array[ ITEM_SIZE ];
+    long needed;
 
-    returns sh_status_e:
+    if ( vector == NULL ) {
 
-    SH_OK           on success
-    SH_ERR_ARG      if pointer to queue struct is NULL, max_depth is less than
-                    zero, or if no queue name
-    SH_ERR_ACCESS   on permissions error for queue name
-    SH_ERR_EXIST    if queue already exists
-    SH_ERR_NOMEM    if not enough memory to allocate
-    SH_ERR_PATH     if error in queue name
-    SH_ERR_SYS      if system call returns an error
-*/
-extern sh_status_e shr_q_create(
+        if ( length > item_size ) {
 
-    shr_q_s **q,            // address of q struct pointer -- not NULL
-    char const * const name,// name of q as a null terminated string -- not NULL
-    unsigned int max_depth, // max depth allowed at which add of item is blocked
-    sq_mode_e mode          // read/write mode
+            return -1;
 
-)   {
+        }
 
-    if ( q == NULL || name == NULL || max_depth > SEM_VALUE_MAX ) {
+        needed = calc_data_slots( length );
+        vcnt = 1;
 
-        return SH_ERR_ARG;
+    } else {
 
-    }
+        needed = calc_vector_slots( vector, vcnt );
 
-    sh_status_e status = perform_name_validations( name, NULL );
-    if ( status == SH_ERR_STATE ) {
+        if ( needed > calc_data_slots( item_size ) ) {
 
-        return SH_ERR_EXIST;
+            return -1;
 
+        }
     }
 
-    if ( status != SH_ERR_EXIST ) {
+    struct timespec curr_time;
+    item_time( q, &curr_time );
+    update_buffer_size( q->current->array, space, vcnt * sizeof(sq_vec_s) );
+    view_s view = alloc_pooled_slots( (shr_base_s*) q, q->slab_slots, SLAB_HEAD,
+                                      SLAB_HD_CNT, SLAB_TAIL );
+    long node = view.slot;
 
-        return status;
+    if ( node == 0 ) {
+
+        return 0;
 
     }
 
-    status = create_base_object( (shr_base_s**) q, sizeof(shr_q_s), name, SHRQ,
-                                 sizeof(SHRQ) - 1, QVERSION );
-    if ( status ) {
+    long *array = view.extent->array;
+    long current = node + NODE_SIZE;
+    array[ node + VALUE_OFFSET ] = current;
+    array[ current + DATA_SLOTS ] = space;
+    array[ current + TM_SEC ] = curr_time.tv_sec;
+    array[ current + TM_NSEC ] = curr_time.tv_nsec;
 
-        return status;
+    if ( vector == NULL ) {
 
-    }
+        array[ current + UID ] = next_uid( q );
+        array[ current + TYPE ] = type;
+        array[ current + VEC_CNT ] = 1;
+        array[ current + DATA_LENGTH ] = length;
+        memcpy( &array[ current + DATA_HDR ], value, length );
 
-    status = format_as_queue( *q, max_depth, mode );
-    if ( status ) {
+    } else {
 
-        free( *q );
-        *q = NULL;
+        fill_vector( array, current, needed, vector, vcnt, next_uid( q ) );
 
     }
 
-    return status;
+    return node;
 }
 
 
 /*
-    shr_q_open -- open shared memory queue for modification using name
-
-    Opens shared queue using name to mmap shared memory.  Queue must already
-    exist before it is opened.
-
-    returns sh_status_e:
-
-    SH_OK           on success
-    SH_ERR_ARG      if pointer to queue struct or name is not NULL
-	SH_ERR_NOMEM	failed memory allocation
-    SH_ERR_ACCESS   on permissions error for queue name
-    SH_ERR_EXIST    if queue does not already exist
-    SH_ERR_PATH     if error in queue name
-    SH_ERR_STATE    if incompatible implementation
-    SH_ERR_SYS      if system call returns an error
+    release_node -- returns queue node to free list it was allocated from
 */
-extern sh_status_e shr_q_open(
+static void release_node(
 
-    shr_q_s **q,            // address of q struct pointer -- not NULL
-    char const * const name,// name of q as a null terminated string -- not NULL
-    sq_mode_e mode          // read/write mode
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long node           // queue node
 
 )   {
 
-    if ( q == NULL || name == NULL ) {
-
-        return SH_ERR_ARG;
-    }
+    if ( is_slab( q ) ) {
 
+        add_end( (shr_base_s*) q, node, SLAB_TAIL );
 
-    size_t size = 0;
-    sh_status_e status = perform_name_validations( name, &size );
-    if ( status ) {
+    } else {
 
-        return status;
+        free_node( q, node );
 
     }
+}
 
-    status = initialize_q_struct( q, mode );
-    if ( status ) {
-
-        return status;
-
-    }
 
-    status = map_shared_memory( (shr_base_s**) q, name, size );
-    if ( status ) {
+/*
+    release_data -- releases data slots of removed item, slab data is released
+    with its queue node
+*/
+static sh_status_e release_data(
 
-        return status;
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long data_slot      // data slot
 
-    }
+)   {
 
-    if ( is_valid_queue( *q ) ) {
+    if ( is_slab( q ) ) {
 
         return SH_OK;
 
     }
 
-    shr_q_close( q );
-    return SH_ERR_STATE;
+    return free_data_slots( (shr_base_s*) q, data_slot );
 }
 
 
 /*
-    shr_q_close -- close shared memory queue
+    ring_reserve -- reserve space at producer end of ring
 
-    Closes shared queue and releases associated memory.  The pointer to the
-    queue instance will be NULL on return.
+    Note:  the consumer does not move its position while the ring is empty, so
+    an item that only fits at the start of an empty ring moves the consumer
+    past the unused end of the ring, otherwise, an item larger than the space
+    left before the end of the ring could never be added
 
-    returns sh_status_e:
-
-    SH_OK       on success
-    SH_ERR_ARG  if pointer to queue struct is NULL
+    returns slot of reserved space and total ring advance including any space
+    skipped at end of ring, otherwise, 0 if ring does not have room
 */
-extern sh_status_e shr_q_close(
+static long ring_reserve(
 
-    shr_q_s **q         // address of q struct pointer -- not NULL
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long space,         // slots needed
+    long *advance       // pointer to ring advance -- not NULL
 
 )   {
 
-    if ( q == NULL || *q == NULL ) {
+    long *array = q->current->array;
+    long ring = array[ RING ];
+    long size = array[ RING_SIZE ];
+    long tail = array[ ring + RING_TAIL ];
+    long head = LOAD_ACQ( &array[ ring + RING_HEAD ] );
+    long offset = tail & ( size - 1 );
+    long skip = 0;
 
-        return SH_ERR_ARG;
+    if ( offset + space > size ) {
+
+        skip = size - offset;
 
     }
 
-    close_base( (shr_base_s*) *q );
+    if ( tail + skip + space - head > size && ( head != tail || !skip ) ) {
 
-    free( *q );
-    *q = NULL;
+        q->ring_full = head;
+        return 0;
 
-    return SH_OK;
-}
+    }
 
+    if ( skip ) {
 
-/*
-    shr_q_destroy -- unlink and release shared memory queue
+        array[ ring + RING_DATA + offset ] = RING_WRAP;
 
-    Unlink shared queue and releases associated memory and resources.  The
-    pointer to the queue instance will be NULL on return. Shared queue will not
-    be available or usable to other processes.
+        if ( head == tail ) {
 
-    returns sh_status_e:
+            STORE_REL( &array[ ring + RING_HEAD ], tail + skip );
+
+        }
+
+        offset = 0;
+
+    }
+
+    *advance = skip + space;
+    return ring + RING_DATA + offset;
+}
+
+
+static void ring_publish(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long advance        // slots to advance producer position
+
+)   {
+
+    long *array = q->current->array;
+    long ring = array[ RING ];
+    STORE_REL( &array[ ring + RING_TAIL ], array[ ring + RING_TAIL ] + advance );
+}
+
+
+/*
+    ring_next -- locate next item at consumer end of ring
+
+    returns slot of next item, otherwise, 0 if ring is empty
+*/
+static long ring_next(
+
+    shr_q_s *q          // pointer to queue struct -- not NULL
+
+)   {
+
+    long *array = q->current->array;
+    long ring = array[ RING ];
+    long size = array[ RING_SIZE ];
+    long head = array[ ring + RING_HEAD ];
+
+    if ( head == LOAD_ACQ( &array[ ring + RING_TAIL ] ) ) {
+
+        return 0;
+
+    }
+
+    long offset = head & ( size - 1 );
+
+    if ( array[ ring + RING_DATA + offset ] == RING_WRAP ) {
+
+        STORE_REL( &array[ ring + RING_HEAD ], head + size - offset );
+        offset = 0;
+
+    }
+
+    return ring + RING_DATA + offset;
+}
+
+
+static void ring_release(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long data_slot      // slot of item being released
+
+)   {
+
+    long *array = q->current->array;
+    long ring = array[ RING ];
+    STORE_REL( &array[ ring + RING_HEAD ],
+               array[ ring + RING_HEAD ] + array[ data_slot + DATA_SLOTS ] );
+    watch_post( &array[ ring + RING_WATCH ] );
+}
+
+
+/*
+    ring_wait -- block until consumer has moved since ring was last found full
+    by caller, or the deadline passes
+
+    returns true if consumer moved, otherwise, false if deadline passed
+*/
+static bool ring_wait(
+
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    struct timespec *deadline   // absolute CLOCK_MONOTONIC time, or NULL
+
+)   {
+
+    long *array = q->current->array;
+    long ring = array[ RING ];
+    return watch_wait( &array[ ring + RING_WATCH ], &array[ ring + RING_HEAD ],
+                       q->ring_full, deadline );
+}
+
+
+static sh_status_e ring_enq(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    void *value,        // pointer to item, or NULL if vector
+    size_t length,      // length of item
+    sh_type_e type,     // data type
+    sq_vec_s *vector,   // pointer to vector of items, or NULL
+    int vcnt            // count of vector array
+
+)   {
+
+    long space;
+
+    if ( vector ) {
+
+        if ( !valid_vector( vector, vcnt ) ) {
+
+            return SH_ERR_ARG;
+
+        }
+
+        space = calc_vector_slots( vector, vcnt );
+        update_buffer_size( q->current->array, space, vcnt * sizeof(sq_vec_s) );
+
+    } else {
+
+        space = calc_data_slots( length );
+        update_buffer_size( q->current->array, space, sizeof(sq_vec_s) );
+
+    }
+
+    if ( space > q->current->array[ RING_SIZE ] ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    long advance = 0;
+    long current = ring_reserve( q, space, &advance );
+
+    if ( current == 0 ) {
+
+        return SH_ERR_LIMIT;
+
+    }
+
+    struct timespec curr_time;
+    item_time( q, &curr_time );
+    long *array = q->current->array;
+    array[ current + DATA_SLOTS ] = space;
+    array[ current + TM_SEC ] = curr_time.tv_sec;
+    array[ current + TM_NSEC ] = curr_time.tv_nsec;
+
+    if ( vector ) {
+
+        fill_vector( array, current, space, vector, vcnt, next_uid( q ) );
+
+    } else {
+
+        array[ current + UID ] = next_uid( q );
+        array[ current + TYPE ] = type;
+        array[ current + VEC_CNT ] = 1;
+        array[ current + DATA_LENGTH ] = length;
+        memcpy( &array[ current + DATA_HDR ], value, length );
+
+    }
+
+    ring_publish( q, advance );
+
+    post_process_enq( q, 1,
+                      (DWORD) { .low = curr_time.tv_sec,
+                                .high = curr_time.tv_nsec } );
+
+    return SH_OK;
+}
+
+
+static sh_status_e enq(
+
+    shr_q_s *q,         // pointer to queue, not NULL
+    void *value,        // pointer to item, not NULL
+    size_t length,      // length of item
+    sh_type_e type,     // data type
+    long lane           // priority lane
+
+)   {
+
+    if ( q == NULL || value == NULL || length <= 0 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( is_ring( q ) ) {
+
+        return ring_enq( q, value, length, type, NULL, 0 );
+
+    }
+
+    if ( is_slab( q ) ) {
+
+        long node = slab_value( q, value, length, type, NULL, 0 );
+
+        if ( node <= 0 ) {
+
+            return node < 0 ? SH_ERR_ARG : SH_ERR_NOMEM;
+
+        }
+
+        return enq_node( q, node, lane );
+    }
+
+    // allocate space and copy value
+    long data_slot = copy_value( q, value, length, type );
+
+    if ( data_slot == 0 ) {
+
+        return SH_ERR_NOMEM;
+
+    }
+
+    if ( data_slot < HDR_END ) {
+
+        return SH_ERR_STATE;
+
+    }
+
+    return enq_data( q, data_slot, lane );
+}
+
+
+static sh_status_e enqv(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_vec_s *vector,   // pointer to vector of items -- not NULL
+    int vcnt            // count of vector array -- must be >= 2
+
+)   {
+
+    if ( q == NULL || vector == NULL || vcnt < 2 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( is_ring( q ) ) {
+
+        return ring_enq( q, NULL, 0, SH_VECTOR_T, vector, vcnt );
+
+    }
+
+    if ( is_slab( q ) ) {
+
+        if ( !valid_vector( vector, vcnt ) ) {
+
+            return SH_ERR_ARG;
+
+        }
+
+        long node = slab_value( q, NULL, 0, SH_VECTOR_T, vector, vcnt );
+
+        if ( node <= 0 ) {
+
+            return node < 0 ? SH_ERR_ARG : SH_ERR_NOMEM;
+
+        }
+
+        return enq_node( q, node, 0 );
+    }
+
+    long data_slot;
+    // allocate space and copy vector
+    data_slot = copy_vector( q, vector, vcnt );
+
+    if ( data_slot < 0 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( data_slot == 0 ) {
+
+        return SH_ERR_NOMEM;
+
+    }
+
+    if ( data_slot < HDR_END ) {
+
+        return SH_ERR_STATE;
+
+    }
+
+    return enq_data( q, data_slot, 0 );
+}
+
+
+static void release_batch(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long *nodes,        // array of allocated queue nodes -- not NULL
+    long count          // number of nodes in array
+
+)   {
+
+    for ( long i = 0; i < count; i++ ) {
+
+        long data_slot = q->current->array[ nodes[ i ] + VALUE_OFFSET ];
+        release_data( q, data_slot );
+        release_node( q, nodes[ i ] );
+
+    }
+}
+
+
+/*
+    enq_wait -- add item, or vector of items, and if the ring of an SPSC
+    queue does not have room, block until the item fits or the deadline, if
+    not NULL, passes
+
+    returns sh_status_e as enq, and SH_ERR_LIMIT if deadline passed
+*/
+static sh_status_e enq_wait(
+
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    sq_vec_s *vector,           // pointer to vector of items -- not NULL
+    int vcnt,                   // count of vector array -- must be >= 1
+    struct timespec *deadline   // absolute CLOCK_MONOTONIC time, or NULL
+
+)   {
+
+    while ( true ) {
+
+        sh_status_e status;
+
+        if ( vcnt == 1 ) {
+
+            status = enq( q, vector[ 0 ].base, vector[ 0 ].len,
+                          vector[ 0 ].type, 0 );
+
+        } else {
+
+            status = enqv( q, vector, vcnt );
+
+        }
+
+        if ( status != SH_ERR_LIMIT || !is_ring( q ) ||
+             !ring_wait( q, deadline ) ) {
+
+            return status;
+
+        }
+    }
+}
+
+
+static sh_status_e enq_batch(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_vec_s *items,    // pointer to array of items -- not NULL
+    long *nodes,        // array to hold queue nodes -- not NULL
+    int count           // count of items array -- greater than 0
+
+)   {
+
+    struct timespec curr_time;
+    item_time( q, &curr_time );
+
+    // allocate and fill every item before anything is published
+    for ( long i = 0; i < count; i++ ) {
+
+        if ( is_slab( q ) ) {
+
+            long node = slab_value( q, items[ i ].base, items[ i ].len,
+                                    items[ i ].type, NULL, 0 );
+
+            if ( node <= 0 ) {
+
+                release_batch( q, nodes, i );
+                return node < 0 ? SH_ERR_ARG : SH_ERR_NOMEM;
+
+            }
+
+            nodes[ i ] = node;
+            continue;
+        }
+
+        long data_slot = copy_value( q, items[ i ].base, items[ i ].len,
+                                     items[ i ].type );
+
+        if ( data_slot < HDR_END ) {
+
+            release_batch( q, nodes, i );
+            return data_slot == 0 ? SH_ERR_NOMEM : SH_ERR_STATE;
+
+        }
+
+        view_s view = alloc_node( q );
+
+        if ( view.slot == 0 ) {
+
+            free_data_slots( (shr_base_s*) q, data_slot );
+            release_batch( q, nodes, i );
+            return SH_ERR_NOMEM;
+
+        }
+
+        nodes[ i ] = view.slot;
+        view.extent->array[ view.slot + VALUE_OFFSET ] = data_slot;
+    }
+
+    long *array = q->current->array;
+    long depth = count_approx( array );
+
+    if ( is_adaptive_lifo( array ) && ( depth + count > array[ LEVEL ] ) ) {
+
+        // preserve adaptive lifo ordering of individual adds
+        for ( long i = 0; i < count; i++ ) {
+
+            if ( depth + i >= array[ LEVEL ] ) {
+
+                lifo_add( q, nodes[ i ] );
+
+            } else {
+
+                fifo_add( q, nodes[ i ], 0 );
+
+            }
+        }
+
+    } else {
+
+        // splice whole chain onto queue
+        add_chain_end( (shr_base_s*) q, nodes, count, TAIL );
+
+    }
+
+    post_process_enq( q, count,
+                      (DWORD) { .low = curr_time.tv_sec,
+                                .high = curr_time.tv_nsec } );
+
+    return SH_OK;
+}
+
+
+static long next_item(
+
+    shr_q_s *q,          // pointer to queue
+    long slot
+
+)   {
+
+    long *array = q->current->array;
+    long next = array[ slot ];
+
+    if ( next < HDR_END ) {
+
+        return 0;
+
+    }
+
+    return array[next + VALUE_OFFSET];
+}
+
+
+static bool stamp_exceeds_limit(
+
+    struct timespec *stamp,         // item timestamp
+    struct timespec *timelimit,     // expiration timelimit
+    struct timespec *curr_time      // current time
+
+)   {
+
+    if ( timelimit->tv_sec == 0 && timelimit->tv_nsec == 0 ) {
+
+        return false;
+
+    }
+
+    struct timespec diff = { 0, 0 };
+    timespecsub( curr_time, stamp, &diff );
+    return timespeccmp( &diff, timelimit, > );
+}
+
+
+static bool item_exceeds_limit(
+
+    shr_q_s *q,                     // pointer to queue
+    long item_slot,                 // array index for item
+    struct timespec *timelimit,     // expiration timelimit
+    struct timespec *curr_time      // current time
+
+)   {
+
+    if ( q == NULL || item_slot < HDR_END || timelimit == NULL ) {
+
+        return false;
+
+    }
+
+    long *array = q->current->array;
+    return stamp_exceeds_limit( (struct timespec *) &array[ item_slot + TM_SEC ],
+                                timelimit, curr_time );
+}
+
+static bool item_exceeds_delay(
+
+    shr_q_s *q,                     // pointer to queue
+    struct timespec *stamp,         // item timestamp
+    long *array                     // array to access
+
+)   {
+
+    if ( stamp == NULL || array == NULL ) {
+
+        return false;
+
+    }
+
+    struct timespec current;
+    queue_time( q, &current );
+    if ( is_codel_active( array ) ) {
+
+        struct timespec intrvl = { 0 };
+        struct timespec last = *(struct timespec*) &array[ EMPTY_SEC ];
+
+        if ( last.tv_sec == 0 ) {
+
+            return stamp_exceeds_limit( stamp,
+                                        (struct timespec*) &array[ LIMIT_SEC ],
+                                        &current );
+        }
+
+        timespecsub( &current, (struct timespec*) &array[ LIMIT_SEC ], &intrvl );
+
+        if ( timespeccmp( &last, &intrvl, < ) ) {
+
+            return stamp_exceeds_limit( stamp,
+                                        (struct timespec*) &array[ TARGET_SEC ],
+                                        &current );
+        }
+    }
+
+    return stamp_exceeds_limit( stamp, (struct timespec*) &array[ LIMIT_SEC ],
+                                &current );
+}
+
+
+static sh_status_e resize_buffer(
+
+    void **buffer,      // address of buffer pointer, or NULL
+    size_t *buff_size,  // pointer to length of buffer if buffer present
+    long total          // required size of buffer
+
+)   {
+
+    if ( *buffer && *buff_size < total ) {
+
+        free( *buffer );
+        *buffer = NULL;
+        *buff_size = 0;
+
+    }
+
+    if ( *buffer == NULL ) {
+
+        *buffer = malloc( total );
+        *buff_size = total;
+
+        if ( *buffer == NULL ) {
+
+            *buff_size = 0;
+            return SH_ERR_NOMEM;
+
+        }
+    }
+
+    return SH_OK;
+}
+
+
+static void initialize_item_vector(
+
+    sq_item_s *item     // pointer to item -- not NULL
+
+)   {
+
+    uint8_t *current = (uint8_t*) item->value;
+
+    for ( int i = 0; i < item->vcount; i++ ) {
+
+        item->vector[ i ].type = (sh_type_e) *(long*) current;
+        current += sizeof(long);
+        item->vector[ i ].len = *(long*) current;
+        current += sizeof(long);
+        item->vector[ i ].base = current;
+
+        if ( item->vector[ i ].len <= sizeof(long) ) {
+
+            current += sizeof(long);
+
+        } else {
+
+            current += ( item->vector[ i ].len >> SZ_SHIFT ) << SZ_SHIFT;
+
+            if ( item->vector[ i ].len & REM ) {
+
+                current += sizeof(long);
+
+            }
+        }
+    }
+}
+
+
+/*
+    setup_item -- fills in item from data header copied to start of buffer,
+    vectors are built at the specified offset in buffer
+*/
+static void setup_item(
+
+    sq_item_s *item,    // pointer to item -- not NULL
+    void *buffer,       // pointer to buffer -- not NULL
+    size_t buff_size,   // size of buffer
+    long size           // offset of vector array in buffer
+
+)   {
+
+    // buffer starts with timestamp, header slot 1
+    long *header = buffer;
+    item->buffer = buffer;
+    item->buf_size = buff_size;
+    item->type = header[ TYPE - 1 ];
+    item->length = header[ DATA_LENGTH - 1 ];
+    item->timestamp = buffer;
+    item->value = (uint8_t*) buffer + ( ( DATA_HDR - 1 ) * sizeof(long) );
+    item->vcount = header[ VEC_CNT - 1 ];
+    item->vector = (sq_vec_s*) ( (uint8_t*) buffer + size );
+
+    if ( item->vcount == 1 ) {
+
+        item->vector[ 0 ].type = item->type;
+        item->vector[ 0 ].len = item->length;
+        item->vector[ 0 ].base = item->value;
+
+    } else {
+
+        initialize_item_vector( item );
+    }
+}
+
+
+static void copy_to_buffer(
+
+    long *array,        // pointer to queue array -- not NULL
+    long data_slot,     // data item index
+    sq_item_s *item,    // pointer to item -- not NULL
+    void **buffer,      // address of buffer pointer, or NULL
+    size_t *buff_size   // pointer to length of buffer if buffer present
+
+)   {
+
+    long size = ( array[ data_slot + DATA_SLOTS ] << SZ_SHIFT ) - sizeof(long);
+    long total = size + array[ data_slot + VEC_CNT ] * sizeof(sq_vec_s);
+    sh_status_e status = resize_buffer( buffer, buff_size, total );
+
+    if ( status != SH_OK ) {
+
+        item->status = SH_ERR_NOMEM;
+        return;
+
+    }
+
+    memcpy( *buffer, &array[ data_slot + 1 ], size );
+    setup_item( item, *buffer, *buff_size, size );
+}
+
+
+static long remove_top(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long top,           // expected slot number -- 0 if no interest
+    long gen            // generation count
+
+)   {
+
+    view_s view = { .status = SH_OK, .extent = q->current, .slot = 0 };
+    volatile long * volatile array = view.extent->array;
+    DWORD before;
+    DWORD after;
+
+    if ( top >= HDR_END && top == array[ STACK_HEAD ] &&
+         gen == array[STACK_HD_CNT] ) {
+
+        after.low = array[ top ];
+        before.high = gen;
+        after.high = before.high + 1;
+        before.low = (ulong) top;
+
+        if ( DWCAS( (DWORD*) &array[ STACK_HEAD ], &before, after ) ) {
+
+            memset( (void*) &array[ top ], 0, 2 << SZ_SHIFT );
+            return top;
+
+        }
+    }
+
+    return 0;
+}
+
+
+static long lifo_remove(
+
+    shr_q_s *q          // pointer to queue
+
+)   {
+
+    long *array = q->current->array;
+    long gen = array[ STACK_HD_CNT ];
+    long top = array[ STACK_HEAD ];
+
+    long data_slot = array[ top + VALUE_OFFSET ];
+
+    if ( data_slot == 0 ) {
+
+        return 0;   // try again
+
+    }
+
+    if ( remove_top( q, top, gen ) == 0) {
+
+        return 0;   // try again
+
+    }
+
+    // free queue node
+    free_node( q, top );
+    return data_slot;
+}
+
+
+static long fifo_remove(
+
+    shr_q_s *q,         // pointer to queue
+    long lane           // priority lane
+
+)   {
+
+    long *array = q->current->array;
+    long head_slot = lane_head( lane );
+    long tail_slot = lane_tail( lane );
+    long gen = array[ head_slot + 1 ];
+    long head = array[ head_slot ];
+
+    if ( head == array[ tail_slot ] ) {
+
+        return 0;   // try again
+
+    }
+
+    long data_slot = next_item( q, head );
+
+    if ( data_slot == 0 ) {
+
+        return 0;   // try again
+
+    }
+
+    if ( remove_front( (shr_base_s*) q, head, gen, head_slot, tail_slot ) == 0 ) {
+
+        return 0;   // try again
+
+    }
+
+    // free queue node
+    free_node( q, head );
+    return data_slot;
+}
+
+
+static long *locate_data(
+
+    shr_q_s *q,         // pointer to queue
+    long data_slot      // array index of data
+
+)   {
+
+    // insure data is within shared memory object
+    long *array = q->current->array;
+    if ( data_slot >= array[ SIZE ] ||
+         data_slot + array[ data_slot + DATA_SLOTS ] > array[ SIZE ] ) {
+
+        return NULL;
+
+    }
+
+    return array;
+}
+
+
+static bool safely_copy_data(
+
+    shr_q_s *q,         // pointer to queue
+    long data_slot,     // array index of data
+    sq_item_s *item,    // item pointer
+    void **buffer,      // address of buffer pointer, or NULL
+    size_t *buff_size   // pointer to length of buffer if buffer present
+
+)   {
+
+    long *array = locate_data( q, data_slot );
+    if ( array == NULL ) {
+
+        return false;
+
+    }
+
+    copy_to_buffer( array, data_slot, item, buffer, buff_size );
+    return true;
+}
+
+
+static void borrow_data(
+
+    long *array,        // pointer to queue array -- not NULL
+    long data_slot,     // data item index
+    sq_item_s *item     // pointer to item -- not NULL
+
+)   {
+
+    item->buffer = &array[ data_slot ];
+    item->buf_size = array[ data_slot + DATA_SLOTS ] << SZ_SHIFT;
+    item->type = array[ data_slot + TYPE ];
+    item->length = array[ data_slot + DATA_LENGTH ];
+    item->timestamp = (struct timespec*) &array[ data_slot + TM_SEC ];
+    item->value = &array[ data_slot + DATA_HDR ];
+    item->vcount = array[ data_slot + VEC_CNT ];
+    item->vector = NULL;
+}
+
+
+/*
+    returns true if item expired and is to be discarded, data slots are not
+    released and remain the responsibility of the caller, a lean queue only
+    maintains the count
+*/
+static bool post_process_deq(
+
+    shr_q_s *q,             // pointer to queue
+    struct timespec *stamp  // timestamp of item removed
+
+)   {
+
+    view_s view = { .extent = q->current };
+    long *array = view.extent->array;
+    count_add( array, -1 );
+
+    if ( is_lean( q ) ) {
+
+        return false;
+
+    }
+
+    bool need_signal = settle_occupancy( q, array );
+    bool expired = is_discard_on_expire( array ) &&
+                   item_exceeds_delay( q, stamp, array );
+
+    if ( expired ) {
+
+        need_signal |= add_event( q, SQ_EVNT_TIME );
+
+    }
+
+    if ( need_signal ) {
+
+        notify( q, SUB_MONITOR );
+
+    }
+
+    return expired;
+}
+
+
+static long remove_data_slot(
+
+    shr_q_s *q          // pointer to queue
+
+)   {
+
+    long *array = q->current->array;
+    long data_slot = 0;
+
+    while ( data_slot == 0 ) {
+
+        if ( array[ STACK_HEAD ] == 0 ) {
+
+            long lane = next_lane( q );
+            if ( lane < 0 ) {
+
+                return 0;    // queue empty
+
+            }
+
+            data_slot = fifo_remove( q, lane );
+
+        } else {
+
+            data_slot = lifo_remove( q );
+
+        }
+    }
+
+    return data_slot;
+}
+
+
+/*
+    clean_front -- remove item at front of lane if it exceeds time limit
+
+    returns true if item removed, otherwise false
+*/
+static bool clean_front(
+
+    shr_q_s *q,                 // pointer to queue
+    long lane,                  // priority lane
+    struct timespec *timelimit  // timelimit value
+
+)   {
+
+    long *array = q->current->array;
+    long head_slot = lane_head( lane );
+    long tail_slot = lane_tail( lane );
+    long gen = array[ head_slot + 1 ];
+    long head = array[ head_slot ];
+
+    if ( head == array[ tail_slot ] ) {
+
+        return false;
+
+    }
+
+    long data_slot = next_item( q, head );
+
+    if ( data_slot == 0 ) {
+
+        return false;
+
+    }
+
+    struct timespec curr_time;
+    queue_time( q, &curr_time );
+
+    if ( !item_exceeds_limit( q, data_slot, timelimit, &curr_time ) ) {
+
+        return false;
+
+    }
+
+    if ( remove_front( (shr_base_s*) q, head, gen, head_slot, tail_slot ) == 0 ) {
+
+        return false;
+
+    }
+
+    // free queue node
+    release_node( q, head );
+    release_data( q, data_slot );
+    return true;
+}
+
+
+static sq_item_s ring_deq(
+
+    shr_q_s *q,         // pointer to queue
+    void **buffer,      // address of buffer pointer, or NULL
+    size_t *buff_size   // pointer to length of buffer if buffer present
+
+)   {
+
+    sq_item_s item = { .status = SH_ERR_EMPTY };
+    long data_slot = ring_next( q );
+
+    if ( data_slot == 0 ) {
+
+        return item;    // queue empty
+
+    }
+
+    item.status = SH_OK;
+    copy_to_buffer( q->current->array, data_slot, &item, buffer, buff_size );
+    bool discard = post_process_deq( q, item.timestamp );
+    ring_release( q, data_slot );
+
+    if ( discard ) {
+
+        memset( &item, 0, sizeof(sq_item_s) );
+        item.status = SH_ERR_EXIST;
+
+    } else {
+
+        wall_time( q, item.timestamp );
+
+    }
+
+    return item;
+}
+
+
+/*
+    slab_remove -- remove slab node from top of stack or front of queue and
+    copy its data into buffer
+
+    Note:  the data of a fifo item lives in the node that becomes the new
+    queue head, which another consumer may free as soon as the head moves
+    again, so the data is copied before the head is swung and the copy is
+    only used if the swing succeeds
+
+    returns true if item removed, otherwise false if queue empty
+*/
+static bool slab_remove(
+
+    shr_q_s *q,         // pointer to queue
+    sq_item_s *item,    // item pointer
+    void **buffer,      // address of buffer pointer
+    size_t *buff_size   // pointer to length of buffer
+
+)   {
+
+    long size = ( ( q->slab_slots - NODE_SIZE ) << SZ_SHIFT ) - sizeof(long);
+
+    if ( resize_buffer( buffer, buff_size, q->current->array[ BUFFER ] ) ) {
+
+        item->status = SH_ERR_NOMEM;
+        return true;
+
+    }
+
+    while ( true ) {
+
+        long *array = q->current->array;
+
+        if ( array[ STACK_HEAD ] != 0 ) {
+
+            long gen = array[ STACK_HD_CNT ];
+            long top = array[ STACK_HEAD ];
+
+            if ( remove_top( q, top, gen ) == 0 ) {
+
+                continue;
+
+            }
+
+            // node is now exclusively owned
+            memcpy( *buffer, &array[ top + NODE_SIZE + 1 ], size );
+            release_node( q, top );
+            break;
+
+        }
+
+        long gen = array[ HEAD_CNT ];
+        long head = array[ HEAD ];
+
+        if ( head == array[ TAIL ] ) {
+
+            return false;
+
+        }
+
+        long next = array[ head ];
+
+        if ( next < HDR_END || next + q->slab_slots > array[ SIZE ] ) {
+
+            continue;
+
+        }
+
+        memcpy( *buffer, &array[ next + NODE_SIZE + 1 ], size );
+
+        if ( remove_front( (shr_base_s*) q, head, gen, HEAD, TAIL ) != 0 ) {
+
+            release_node( q, head );
+            break;
+
+        }
+    }
+
+    setup_item( item, *buffer, *buff_size, size );
+    item->status = SH_OK;
+    return true;
+}
+
+
+static sq_item_s slab_deq(
+
+    shr_q_s *q,         // pointer to queue
+    void **buffer,      // address of buffer pointer, or NULL
+    size_t *buff_size   // pointer to length of buffer if buffer present
+
+)   {
+
+    sq_item_s item = { .status = SH_ERR_EMPTY };
+
+    if ( slab_remove( q, &item, buffer, buff_size ) && item.status == SH_OK ) {
+
+        if ( post_process_deq( q, item.timestamp ) ) {
+
+            memset( &item, 0, sizeof(sq_item_s) );
+            item.status = SH_ERR_EXIST;
+
+        } else {
+
+            wall_time( q, item.timestamp );
+
+        }
+    }
+
+    return item;
+}
+
+
+static sq_item_s deq(
+
+    shr_q_s *q,         // pointer to queue
+    void **buffer,      // address of buffer pointer, or NULL
+    size_t *buff_size   // pointer to length of buffer if buffer present
+
+)   {
+
+    if ( is_ring( q ) ) {
+
+        return ring_deq( q, buffer, buff_size );
+
+    }
+
+    if ( is_slab( q ) ) {
+
+        return slab_deq( q, buffer, buff_size );
+
+    }
+
+    sq_item_s item = { .status = SH_ERR_EMPTY };
+    long data_slot = remove_data_slot( q );
+
+    if ( data_slot == 0 ) {
+
+        return item;    // queue empty
+
+    }
+
+    if ( safely_copy_data( q, data_slot, &item, buffer, buff_size ) ) {
+
+        if ( post_process_deq( q, item.timestamp ) ) {
+
+            memset( &item, 0, sizeof(sq_item_s) );
+            free_data_slots( (shr_base_s*) q, data_slot );
+            item.status = SH_ERR_EXIST;
+
+        } else {
+
+            wall_time( q, item.timestamp );
+            item.status = free_data_slots( (shr_base_s*) q, data_slot );
+
+        }
+    }
+
+    return item;
+}
+
+
+static sq_item_s deq_borrow(
+
+    shr_q_s *q          // pointer to queue
+
+)   {
+
+    sq_item_s item = { .status = SH_ERR_EMPTY };
+    long data_slot = remove_data_slot( q );
+
+    if ( data_slot == 0 ) {
+
+        return item;    // queue empty
+
+    }
+
+    long *array = locate_data( q, data_slot );
+    if ( array != NULL ) {
+
+        if ( post_process_deq( q, (struct timespec*) &array[ data_slot + TM_SEC ] ) ) {
+
+            free_data_slots( (shr_base_s*) q, data_slot );
+            item.status = SH_ERR_EXIST;
+
+        } else {
+
+            wall_time( q, (struct timespec*) &array[ data_slot + TM_SEC ] );
+            borrow_data( array, data_slot, &item );
+            item.status = SH_OK;
+            return item;
+
+        }
+    }
+
+    return item;
+}
+
+
+static sq_event_e next_event(
+
+    shr_q_s *q,          // pointer to queue
+    long slot
+
+)   {
+
+    long *array = q->current->array;
+    long next = array[ slot ];
+    return array [ next + EVENT_OFFSET ];
+}
+
+
+static void check_for_level_event(
+
+    shr_q_s *q          // pointer to queue
+
+)   {
+
+    view_s view = { .extent = q->current };
+    long *array = view.extent->array;
+
+    long level = array[ LEVEL ];
+    if ( level <= 0 ) {
+
+        return;
+
+    }
+
+    if ( event_disabled( array, SQ_EVNT_LEVEL ) )
+    {
+        return;
+    }
+
+    if ( count_approx( array ) >= level && add_event( q, SQ_EVNT_LEVEL ) ) {
+
+        notify( q, SUB_MONITOR );
+
+    }
+
+    return;
+}
+
+
+/*
+    release_ready -- removes subscriber entries of readiness socket of handle
+    and closes sockets opened by handle
+*/
+static void release_ready(
+
+    shr_q_s *q          // pointer to queue struct -- not NULL
+
+)   {
+
+    if ( q->ready_fd >= 0 ) {
+
+        (void) subscribe( q, SUB_READY, 0, q->uid_prefix );
+        (void) subscribe( q, SUB_SPACE, 0, q->uid_prefix );
+        close( q->ready_fd );
+        q->ready_fd = -1;
+
+    }
+
+    if ( q->wake_sock >= 0 ) {
+
+        close( q->wake_sock );
+        q->wake_sock = -1;
+
+    }
+}
+
+
+/*
+    sync_periodic -- flushes file of queue at the interval in the queue header
+    until cancelled
+*/
+static void *sync_periodic(
+
+    void *arg           // pointer to queue struct -- not NULL
+
+)   {
+
+    shr_q_s *q = arg;
+    long msec = q->current->array[ SYNC_INTRVL ];
+    struct timespec interval = { .tv_sec = msec / 1000,
+                                 .tv_nsec = ( msec % 1000 ) * 1000000 };
+
+    while ( true ) {
+
+        (void) nanosleep( &interval, NULL );
+        (void) fdatasync( q->fd );
+
+    }
+
+    return NULL;
+}
+
+
+/*
+    start_sync -- loads flush policy of file backed queue, starting periodic
+    flush thread of handle if needed
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_SYS      if thread could not be started
+*/
+static sh_status_e start_sync(
+
+    shr_q_s *q          // pointer to queue struct -- not NULL
+
+)   {
+
+    q->sync = q->current->array[ SYNC ];
+
+    if ( q->sync != SQ_SYNC_PERIODIC ) {
+
+        return SH_OK;
+
+    }
+
+    if ( pthread_create( &q->sync_thread, NULL, sync_periodic, q ) != 0 ) {
+
+        return SH_ERR_SYS;
+
+    }
+
+    q->sync_running = true;
+    return SH_OK;
+}
+
+
+/*
+    release_sync -- stops periodic flush thread of handle, and flushes file of
+    queue a final time if it has a flush policy
+*/
+static void release_sync(
+
+    shr_q_s *q          // pointer to queue struct -- not NULL
+
+)   {
+
+    if ( q->sync_running ) {
+
+        pthread_cancel( q->sync_thread );
+        pthread_join( q->sync_thread, NULL );
+        q->sync_running = false;
+
+    }
+
+    if ( q->sync != SQ_SYNC_NONE ) {
+
+        (void) fdatasync( q->fd );
+
+    }
+}
+
+
+/*
+    compact_periodic -- compacts queue at the interval in the queue header
+    until cancelled, holding off cancellation while memory is being released
+*/
+static void *compact_periodic(
+
+    void *arg           // pointer to queue struct -- not NULL
+
+)   {
+
+    shr_q_s *q = arg;
+    long msec = q->current->array[ COMPACT_INTRVL ];
+    struct timespec interval = { .tv_sec = msec / 1000,
+                                 .tv_nsec = ( msec % 1000 ) * 1000000 };
+    int state;
+
+    while ( true ) {
+
+        (void) nanosleep( &interval, NULL );
+        (void) pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, &state );
+        (void) shr_q_compact( q );
+        (void) pthread_setcancelstate( state, NULL );
+
+    }
+
+    return NULL;
+}
+
+
+/*
+    start_compact -- starts background compaction thread of handle if the
+    queue has a compaction interval
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_SYS      if thread could not be started
+*/
+static sh_status_e start_compact(
+
+    shr_q_s *q          // pointer to queue struct -- not NULL
+
+)   {
+
+    if ( q->current->array[ COMPACT_INTRVL ] <= 0 ) {
+
+        return SH_OK;
+
+    }
+
+    if ( pthread_create( &q->compact_thread, NULL, compact_periodic, q ) != 0 ) {
+
+        return SH_ERR_SYS;
+
+    }
+
+    q->compact_running = true;
+    return SH_OK;
+}
+
+
+/*
+    release_compact -- stops background compaction thread of handle
+*/
+static void release_compact(
+
+    shr_q_s *q          // pointer to queue struct -- not NULL
+
+)   {
+
+    if ( q->compact_running ) {
+
+        pthread_cancel( q->compact_thread );
+        pthread_join( q->compact_thread, NULL );
+        q->compact_running = false;
+
+    }
+}
+
+
+/*
+    recover_queue -- repairs file backed queue that no other process holds
+    open, which may have been left part way through changes by a crash
+
+    Note:  list tails are rebuilt by walking each list from its head, the item
+    count and gates are rebuilt from the items found, and subscribers and locks
+    of ended processes are cleared, but nodes and data held by ended processes
+    are not recovered
+
+    Caller is responsible for flushing the repaired header
+*/
+static void recover_queue(
+
+    shr_q_s *q          // pointer to queue struct -- not NULL
+
+)   {
+
+    long *array = q->current->array;
+    long limit = array[ SIZE ] - NODE_SIZE;
+    long items = 0;
+
+    for ( long lane = 0; lane < q->lanes; lane++ ) {
+
+        long node = array[ lane_head( lane ) ];
+
+        while ( array[ node ] != node ) {
+
+            long next = array[ node ];
+
+            if ( next < HDR_END || next > limit || items > limit ) {
+
+                // end list at damaged link
+                array[ node ] = node;
+                break;
+
+            }
+
+            node = next;
+            items++;
+        }
+
+        array[ lane_tail( lane ) ] = node;
+        array[ lane_tail( lane ) + 1 ] = array[ node + 1 ];
+    }
+
+    // items on adaptive LIFO stack
+    for ( long top = array[ STACK_HEAD ]; top >= HDR_END && top <= limit &&
+          items <= limit; top = array[ top ] ) {
+
+        items++;
+
+    }
+
+    for ( long i = 0; i < COUNT_STRIPES; i++ ) {
+
+        array[ CNT_STRIPE + ( i * LINE_SLOTS ) ] = 0;
+
+    }
+
+    array[ CNT_STRIPE ] = items;
+
+    if ( items > 0 ) {
+
+        (void) set_flag( array, FLAG_OCCUPIED );
+
+    } else {
+
+        (void) clear_flag( array, FLAG_OCCUPIED );
+
+    }
+
+    long gates[] = { DEQ_GATE, ENQ_GATE, EVNT_GATE };
+
+    for ( int i = 0; i < 3; i++ ) {
+
+        array[ gates[ i ] + GATE_WAITERS ] = 0;
+        array[ gates[ i ] + GATE_SELECTS ] = 0;
+
+    }
+
+    long space = array[ MAX_DEPTH ] - items;
+    array[ DEQ_GATE + GATE_VALUE ] = items;
+    array[ ENQ_GATE + GATE_VALUE ] = ( space > 0 ) ? space : 0;
+
+    for ( long kind = 0; kind < SUB_KINDS; kind++ ) {
+
+        array[ SUB_COUNT + kind ] = 0;
+
+    }
+
+    memset( &array[ SUB_TABLE ], 0, ( SUB_SLOTS * LINE_SLOTS ) << SZ_SHIFT );
+    array[ SYNC_LOCK ] = 0;
+    array[ SYNC_DONE ] = array[ SYNC_REQ ];
+
+    if ( is_broadcast( q ) ) {
+
+        array[ BCAST_LOCK ] = 0;
+
+    }
+}
+
+
+static sh_status_e initialize_q_struct(
+
+    shr_q_s **q,            // address of q struct pointer -- not NULL
+    sq_mode_e mode          // read/write mode
+
+) {
+
+    *q = calloc( 1, sizeof(shr_q_s) );
+    if ( *q == NULL ) {
+
+        return SH_ERR_NOMEM;
+
+    }
+
+    (*q)->current = calloc( 1, sizeof(extent_s) );
+    if ( (*q)->current == NULL ) {
+
+        free( *q );
+        *q = NULL;
+        return SH_ERR_NOMEM;
+
+    }
+
+    (*q)->mode = mode;
+    (*q)->ready_fd = -1;
+    (*q)->wake_sock = -1;
+
+    return SH_OK;
+}
+
+
+
+static bool is_valid_queue(
+
+    shr_q_s *q          // pointer to queue
+
+)   {
+
+    if ( memcmp( &q->current->array[ TAG ], SHRQ, sizeof(SHRQ) - 1 ) != 0 ) {
+
+        return false;
+
+    }
+
+    if ( q->current->array[ VERSION ] != QVERSION ) {
+
+        return false;
+
+    }
+
+    return true;
+}
+
+
+static void deadline_after(
+
+    struct timespec *timeout,   // relative timeout value -- not NULL
+    struct timespec *deadline   // absolute time on gate clock -- not NULL
+
+)   {
+
+    clock_gettime( CLOCK_MONOTONIC, deadline );
+    timespecadd( deadline, timeout, deadline );
+}
+
+
+/*
+    arm_ready -- re-arms readiness socket of handle for kind after its owner
+    found the queue empty or full, waking it at once if the state changed
+    before the socket was armed
+*/
+static void arm_ready(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long kind           // SUB_READY or SUB_SPACE
+
+)   {
+
+    if ( q->sub[ kind ] == 0 ) {
+
+        return;
+
+    }
+
+    long *array = q->current->array;
+    (void) observe( q, kind, observed_gen( q, kind ) );
+
+    // item counts are updated before arrivals are notified
+    bool pending = ( kind == SUB_READY ) ? ( count_items( array ) > 0 ) :
+                                           ( array[ ENQ_GATE + GATE_VALUE ] > 0 );
+
+    if ( pending ) {
+
+        wake_ready( q, q->uid_prefix );
+
+    }
+}
+
+
+static sh_status_e deq_gate_try(
+
+    shr_q_s *q          // pointer to queue
+
+)   {
+
+    if ( is_broadcast( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
+
+    if ( gate_try( &q->current->array[ DEQ_GATE ], 1, 1 ) == 0 ) {
+
+        notify( q, SUB_CALL );
+        arm_ready( q, SUB_READY );
+
+        return SH_ERR_EMPTY;
+
+    }
+
+    sync_extent( (shr_base_s*) q );
+    return SH_OK;
+}
+
+
+static sh_status_e deq_gate_blk(
+
+    shr_q_s *q          // pointer to queue
+
+)   {
+
+    if ( is_broadcast( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
+
+    (void) AFA( &q->current->array[CALL_BLOCKS], 1 );
+
+    notify( q, SUB_CALL );
+
+    (void) gate_wait( &q->current->array[ DEQ_GATE ], NULL );
+
+    (void) AFA( &q->current->array[CALL_UNBLOCKS], 1 );
+    sync_extent( (shr_base_s*) q );
+    return SH_OK;
+}
+
+
+static sh_status_e deq_gate_tm(
+
+    shr_q_s *q,                 // pointer to queue
+    struct timespec *timeout    // timeout value -- not NULL
+
+)   {
+
+    if ( is_broadcast( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
+
+    (void) AFA( &q->current->array[ CALL_BLOCKS ], 1 );
+
+    notify( q, SUB_CALL );
+
+    struct timespec ts;
+    deadline_after( timeout, &ts );
+
+    if ( !gate_wait( &q->current->array[ DEQ_GATE ], &ts ) ) {
+
+        (void) AFA( &q->current->array[ CALL_UNBLOCKS ], 1 );
+        return SH_ERR_EMPTY;
+
+    }
+
+    (void) AFA( &q->current->array[ CALL_UNBLOCKS ], 1 );
+    sync_extent( (shr_base_s*) q );
+    return SH_OK;
+}
+
+
+static sh_status_e enq_gate_try(
+
+    shr_q_s *q          // pointer to queue
+
+)   {
+
+    if ( gate_try( &q->current->array[ ENQ_GATE ], 1, 1 ) == 0 ) {
+
+        arm_ready( q, SUB_SPACE );
+        return SH_ERR_LIMIT;
+
+    }
+
+    sync_extent( (shr_base_s*) q );
+    return SH_OK;
+}
+
+
+static sh_status_e enq_gate_claim(
+
+    shr_q_s *q,         // pointer to queue
+    long count          // number of items to be added
+
+)   {
+
+    if ( gate_try( &q->current->array[ ENQ_GATE ], count, count ) == 0 ) {
+
+        arm_ready( q, SUB_SPACE );
+        return SH_ERR_LIMIT;
+
+    }
+
+    sync_extent( (shr_base_s*) q );
+    return SH_OK;
+}
+
+
+static sh_status_e enq_gate_blk(
+
+    shr_q_s *q          // pointer to queue
+
+)   {
+
+    (void) gate_wait( &q->current->array[ ENQ_GATE ], NULL );
+    sync_extent( (shr_base_s*) q );
+    return SH_OK;
+}
+
+
+static sh_status_e enq_gate_tm(
+
+    shr_q_s *q,                 // pointer to queue
+    struct timespec *timeout    // timeout value -- not NULL
+
+)   {
+
+    struct timespec ts;
+    deadline_after( timeout, &ts );
+
+    if ( !gate_wait( &q->current->array[ ENQ_GATE ], &ts ) ) {
+
+        return SH_ERR_LIMIT;
+
+    }
+
+    sync_extent( (shr_base_s*) q );
+    return SH_OK;
+}
+
+
+static sh_status_e deq_release_gate(
+
+    shr_q_s *q          // pointer to queue
+
+)   {
+
+    gate_post( &q->current->array[ DEQ_GATE ], 1 );
+    return SH_OK;
+}
+
+
+static sh_status_e enq_release_gate(
+
+    shr_q_s *q          // pointer to queue
+
+)   {
+
+    gate_post( &q->current->array[ ENQ_GATE ], 1 );
+    notify( q, SUB_SPACE );
+    return SH_OK;
+}
+
+
+static sh_status_e deq_release_gates(
+
+    shr_q_s *q,         // pointer to queue
+    long count          // number of items to release
+
+)   {
+
+    if ( count > 0 ) {
+
+        gate_post( &q->current->array[ DEQ_GATE ], count );
+
+    }
+
+    return SH_OK;
+}
+
+
+static sh_status_e enq_release_gates(
+
+    shr_q_s *q,         // pointer to queue
+    long count          // number of items to release
+
+)   {
+
+    if ( count > 0 ) {
+
+        gate_post( &q->current->array[ ENQ_GATE ], count );
+        notify( q, SUB_SPACE );
+
+    }
+
+    return SH_OK;
+}
+
+
+/*
+    lock_broadcast -- acquire lock serializing reclaim of items read by every
+    consumer group with groups joining, spinning only if wait is true
+
+    Note:  lock holds process id of holder, so lock left by an ended process
+    is taken over
+
+    returns true if lock acquired, otherwise, false
+*/
+static bool lock_broadcast(
+
+    shr_q_s *q,         // pointer to queue
+    bool wait           // true to wait for lock
+
+)   {
+
+    long *array = q->current->array;
+
+    while ( true ) {
+
+        long holder = array[ BCAST_LOCK ];
+
+        if ( holder != 0 && ( kill( holder, 0 ) == 0 || errno != ESRCH ) ) {
+
+            if ( !wait ) {
+
+                return false;
+
+            }
+
+            sched_yield();
+            continue;
+
+        }
+
+        if ( CAS( &array[ BCAST_LOCK ], &holder, getpid() ) ) {
+
+            return true;
+
+        }
+    }
+}
+
+
+/*
+    reclaim_broadcast -- free nodes and items at front of broadcast queue that
+    every active consumer group has read, the item of the node that becomes
+    the front of the list is freed along with the node removed, since it has
+    also been read by every group
+
+    Note:  if another caller holds the lock, it reclaims instead
+*/
+static void reclaim_broadcast(
+
+    shr_q_s *q          // pointer to queue
+
+)   {
+
+    if ( !lock_broadcast( q, false ) ) {
+
+        return;
+
+    }
+
+    long *array = q->current->array;
+
+    while ( true ) {
+
+        // list position of front node is number of nodes removed from list
+        long head = array[ HEAD ];
+        long gen = array[ HEAD_CNT ];
+        long min = LONG_MAX;
+
+        for ( long i = 0; i < BCAST_GROUPS; i++ ) {
+
+            long entry = GROUP_TABLE + ( i * LINE_SLOTS );
+
+            if ( array[ entry + GROUP_ACTIVE ] && array[ entry + GROUP_SEQ ] < min ) {
+
+                min = array[ entry + GROUP_SEQ ];
+
+            }
+        }
+
+        if ( min == LONG_MAX || min <= gen - TAIL ) {
+
+            break;
+
+        }
+
+        long next = array[ head ];
+        long data_slot = array[ next + VALUE_OFFSET ];
+
+        if ( remove_front( (shr_base_s*) q, head, gen, HEAD, TAIL ) == 0 ) {
+
+            break;
+
+        }
+
+        free_node( q, head );
+        free_data_slots( (shr_base_s*) q, data_slot );
+        count_add( array, -1 );
+        (void) gate_try( &array[ DEQ_GATE ], 1, 1 );
+        enq_release_gate( q );
+    }
+
+    STORE_REL( &array[ BCAST_LOCK ], 0 );
+}
+
+
+/*
+    group_deq -- copy item that follows last item read by consumer group and
+    advance cursor of group past it
+
+    Note:  the item is copied before the cursor is advanced, so a copy is only
+    returned if the cursor did not move while the item was copied, which
+    insures the item was not reclaimed while being copied
+*/
+static sq_item_s group_deq(
+
+    shr_q_s *q,         // pointer to queue
+    long entry,         // slot of consumer group entry
+    void **buffer,      // address of buffer pointer, or NULL
+    size_t *buff_size   // pointer to length of buffer if buffer present
+
+)   {
+
+    while ( true ) {
+
+        sq_item_s item = { .status = SH_ERR_EMPTY };
+        sync_extent( (shr_base_s*) q );
+        long *array = q->current->array;
+        DWORD before = { .low = array[ entry + GROUP_CURSOR ],
+                         .high = array[ entry + GROUP_SEQ ] };
+
+        long next = array[ before.low ];
+
+        if ( array[ entry + GROUP_SEQ ] != before.high ||
+             array[ entry + GROUP_CURSOR ] != before.low ) {
+
+            continue;   // cursor moved
+
+        }
+
+        if ( next == before.low ) {
+
+            return item;    // last node of list already read
+
+        }
+
+        long data_slot = 0;
+
+        if ( next >= HDR_END ) {
+
+            data_slot = array[ next + VALUE_OFFSET ];
+
+        }
+
+        if ( data_slot >= HDR_END ) {
+
+            long slots = array[ data_slot + DATA_SLOTS ];
+            long vcnt = array[ data_slot + VEC_CNT ];
+
+            if ( slots < DATA_HDR || data_slot + slots > array[ SIZE ] ||
+                 vcnt < 1 || vcnt > slots ) {
+
+                data_slot = 0;
+
+            }
+        }
+
+        if ( data_slot < HDR_END ||
+             !safely_copy_data( q, data_slot, &item, buffer, buff_size ) ) {
+
+            if ( array[ entry + GROUP_SEQ ] != before.high ) {
+
+                continue;   // cursor moved
+
+            }
+
+            item.status = SH_ERR_STATE;
+            return item;
+        }
+
+        if ( item.status == SH_ERR_NOMEM ) {
+
+            return item;
+
+        }
+
+        DWORD after = { .low = next, .high = before.high + 1 };
+
+        if ( DWCAS( (DWORD*) &array[ entry + GROUP_CURSOR ], &before, after ) ) {
+
+            wall_time( q, item.timestamp );
+            item.status = SH_OK;
+            return item;
+
+        }
+    }
+}
+
+
+static sq_item_s remove_borrowed(
+
+    shr_q_s *q,                 // pointer to queue
+    struct timespec *timeout,   // timeout for timed wait, or NULL
+    bool block                  // block if queue empty
+
+)   {
+
+    if ( is_ring( q ) || is_slab( q ) ) {
+
+        return (sq_item_s) { .status = SH_ERR_NOSUPPORT };
+
+    }
+
+    sq_item_s item = { 0 };
+
+    while ( true ) {
+
+        if ( timeout ) {
+
+            item.status = deq_gate_tm( q, timeout );
+
+        } else if ( block ) {
+
+            item.status = deq_gate_blk( q );
+
+        } else {
+
+            item.status = deq_gate_try( q );
+
+        }
+
+        if ( item.status ) {
+
+            break;
+
+        }
+
+        item = deq_borrow( q );
+        if ( item.status != SH_ERR_EXIST ) {
+
+            if ( item.status ) {
+
+                deq_release_gate( q );
+
+            } else {
+
+                item.status = enq_release_gate( q );
+                if ( item.status == SH_OK ) {
+
+                    return item;
+
+                }
+            }
+
+            break;
+
+        }
+
+        enq_release_gate( q );
+
+    }
+
+    return item;
+}
+
+
+static sh_status_e remove_batch(
+
+    shr_q_s *q,                 // pointer to queue
+    sq_item_s *items,           // array of items to fill
+    int max,                    // maximum number of items to remove
+    int *count,                 // pointer to number of items removed
+    struct timespec *timeout,   // timeout for timed wait, or NULL
+    bool block                  // block if queue empty
+
+)   {
+
+    sh_status_e status = SH_OK;
+    int removed = 0;
+
+    while ( removed == 0 ) {
+
+        // claim as many available items as possible with one gate operation
+        long claimed = gate_try( &q->current->array[ DEQ_GATE ], 1, max );
+
+        if ( claimed == 0 ) {
+
+            if ( timeout ) {
+
+                status = deq_gate_tm( q, timeout );
+
+            } else if ( block ) {
+
+                status = deq_gate_blk( q );
+
+            } else {
+
+                status = deq_gate_try( q );
+
+            }
+
+            if ( status ) {
+
+                break;
+
+            }
+
+            claimed = 1;
+            if ( max > 1 ) {
+
+                claimed += gate_try( &q->current->array[ DEQ_GATE ], 1, max - 1 );
+
+            }
+        }
+
+        sync_extent( (shr_base_s*) q );
+        long discarded = 0;
+
+        for ( long i = 0; i < claimed; i++ ) {
+
+            void *buffer = items[ removed ].buffer;
+            size_t buff_size = items[ removed ].buf_size;
+            sq_item_s item = deq( q, &buffer, &buff_size );
+
+            if ( item.status == SH_ERR_EXIST ) {
+
+                // buffer may have been resized by deq
+                items[ removed ].buffer = buffer;
+                items[ removed ].buf_size = buff_size;
+                discarded++;
+                continue;
+
+            }
+
+            if ( item.status ) {
+
+                items[ removed ].buffer = buffer;
+                items[ removed ].buf_size = buff_size;
+                deq_release_gates( q, claimed - i );
+                status = item.status;
+                break;
+
+            }
+
+            items[ removed++ ] = item;
+        }
+
+        sh_status_e rc = enq_release_gates( q, removed + discarded );
+        if ( rc ) {
+
+            status = rc;
+
+        }
+
+        if ( status ) {
+
+            break;
+
+        }
+    }
+
+    *count = removed;
+    if ( removed > 0 ) {
+
+        return SH_OK;
+
+    }
+
+    return status;
+}
+
+
+/*
+    snap_flush -- write buffered snapshot data to stream
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_SYS      if write to stream fails, or other status from errno
+*/
+static sh_status_e snap_flush(
+
+    snap_io_s *io       // pointer to snapshot stream -- not NULL
+
+)   {
+
+    size_t done = 0;
+
+    while ( done < io->pos ) {
+
+        ssize_t rc = write( io->fd, io->buf + done, io->pos - done );
+
+        if ( rc < 0 ) {
+
+            if ( errno == EINTR ) {
+
+                continue;
+
+            }
+
+            return convert_to_status( errno );
+
+        }
+
+        done += rc;
+    }
+
+    io->pos = 0;
+    return SH_OK;
+}
+
+
+/*
+    snap_room -- make room in buffer for a record, flushing buffered records
+    and growing buffer for a record larger than buffer
+*/
+static sh_status_e snap_room(
+
+    snap_io_s *io,      // pointer to snapshot stream -- not NULL
+    size_t bytes        // length of record
+
+)   {
+
+    if ( io->pos + bytes <= io->size ) {
+
+        return SH_OK;
+
+    }
+
+    sh_status_e status = snap_flush( io );
+
+    if ( status == SH_OK && bytes > io->size ) {
+
+        char *buf = realloc( io->buf, bytes );
+
+        if ( buf == NULL ) {
+
+            return SH_ERR_NOMEM;
+
+        }
+
+        io->buf = buf;
+        io->size = bytes;
+    }
+
+    return status;
+}
+
+
+/*
+    snap_read -- read bytes from snapshot stream, refilling buffer with large
+    reads as it empties
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_STATE    if stream ends first
+    SH_ERR_SYS      if read from stream fails, or other status from errno
+*/
+static sh_status_e snap_read(
+
+    snap_io_s *io,      // pointer to snapshot stream -- not NULL
+    void *dest,         // pointer to destination -- not NULL
+    size_t bytes        // number of bytes to read
+
+)   {
+
+    char *next = dest;
+
+    while ( bytes > 0 ) {
+
+        if ( io->pos == io->len ) {
+
+            ssize_t rc = read( io->fd, io->buf, io->size );
+
+            if ( rc < 0 ) {
+
+                if ( errno == EINTR ) {
+
+                    continue;
+
+                }
+
+                return convert_to_status( errno );
+
+            }
+
+            if ( rc == 0 ) {
+
+                return SH_ERR_STATE;
+
+            }
+
+            io->pos = 0;
+            io->len = rc;
+        }
+
+        size_t part = io->len - io->pos;
+
+        if ( part > bytes ) {
+
+            part = bytes;
+
+        }
+
+        memcpy( next, io->buf + io->pos, part );
+        io->pos += part;
+        next += part;
+        bytes -= part;
+    }
+
+    return SH_OK;
+}
+
+
+/*
+    used_slots -- data header and data slots in use by item, allocations are
+    rounded up so can hold more
+*/
+static inline long used_slots(
+
+    long *array,        // active q array
+    long data_slot      // data slot of item
+
+)   {
+
+    long length = array[ data_slot + DATA_LENGTH ];
+
+    if ( array[ data_slot + TYPE ] == SH_VECTOR_T ) {
+
+        return DATA_HDR + ( length >> SZ_SHIFT );
+
+    }
+
+    return calc_data_slots( length );
+}
+
+
+/*
+    snap_item -- copy item into snapshot buffer following buffered records,
+    the record is only kept once the caller advances buffer position past it
+
+    returns sh_status_e:
+
+    SH_OK           on success, with bytes set to length of record
+    SH_RETRY        if item data was not readable, it may have been removed
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+    SH_ERR_SYS      if write to stream fails
+*/
+static sh_status_e snap_item(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    snap_io_s *io,      // pointer to snapshot stream -- not NULL
+    long lane,          // priority lane of item
+    long data_slot,     // data slot of item
+    size_t *bytes       // pointer to record length -- not NULL
+
+)   {
+
+    long *array = ( data_slot >= HDR_END ) ? locate_data( q, data_slot ) : NULL;
+
+    if ( array == NULL ) {
+
+        return SH_RETRY;
+
+    }
+
+    long slots = used_slots( array, data_slot );
+
+    if ( slots < DATA_HDR || slots > array[ data_slot + DATA_SLOTS ] ) {
+
+        return SH_RETRY;
+
+    }
+
+    *bytes = ( slots + 1 ) << SZ_SHIFT;
+    sh_status_e status = snap_room( io, *bytes );
+
+    if ( status ) {
+
+        return status;
+
+    }
+
+    long *record = (long*) ( io->buf + io->pos );
+    record[ 0 ] = lane;
+    memcpy( &record[ 1 ], &array[ data_slot ], slots << SZ_SHIFT );
+    record[ 1 + DATA_SLOTS ] = slots;
+    wall_time( q, (struct timespec*) &record[ 1 + TM_SEC ] );
+
+    return SH_OK;
+}
+
+
+/*
+    snap_lane -- write items of lane to snapshot in list order
+
+    Note:  the head counter of a lane advances by one for each node removed,
+    so a node is still on the lane while the counter is below the counter
+    value of the head the walk started from plus the distance of the node from
+    that head, and the data of an item is read through its predecessor node,
+    so a walk that finds the node it is on removed by a concurrent remove
+    starts over from the new head, every item before which was also removed.
+    Items added after the walk starts are not included.
+*/
+static sh_status_e snap_lane(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    snap_io_s *io,      // pointer to snapshot stream -- not NULL
+    long lane,          // priority lane
+    long *count         // pointer to count of items written -- not NULL
+
+)   {
+
+    long *array = q->current->array;
+    long head_slot = lane_head( lane );
+    long last = array[ lane_tail( lane ) ];
+    long gen = 0;
+    long node = 0;
+    long distance = 0;
+
+    while ( true ) {
+
+        if ( node == 0 ) {
+
+            // start walk from consistent head and counter
+            do {
+
+                gen = LOAD_ACQ( &array[ head_slot + 1 ] );
+                node = array[ head_slot ];
+
+            } while ( gen != LOAD_ACQ( &array[ head_slot + 1 ] ) );
+
+            distance = 0;
+        }
+
+        if ( node == last ) {
+
+            break;
+
+        }
+
+        long next = LOAD_ACQ( &array[ node ] );
+        sh_status_e status = SH_RETRY;
+        size_t bytes = 0;
+
+        if ( next != node && next >= HDR_END ) {
+
+            status = snap_item( q, io, lane, array[ next + VALUE_OFFSET ], &bytes );
+
+            if ( status != SH_OK && status != SH_RETRY ) {
+
+                return status;
+
+            }
+        }
+
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+
+        if ( q->current->array[ head_slot + 1 ] - gen > distance ) {
+
+            node = 0;   // node removed, start over
+            continue;
+
+        }
+
+        if ( next == node ) {
+
+            break;  // end of lane
+
+        }
+
+        if ( status == SH_RETRY ) {
+
+            return SH_ERR_STATE;
+
+        }
+
+        io->pos += bytes;
+        (*count)++;
+        node = next;
+        distance++;
+    }
+
+    return SH_OK;
+}
+
+
+/*
+    snap_stack -- write items held on adaptive LIFO stack to snapshot, stopping
+    at the first item a concurrent add or remove may have changed
+*/
+static sh_status_e snap_stack(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    snap_io_s *io,      // pointer to snapshot stream -- not NULL
+    long *count         // pointer to count of items written -- not NULL
+
+)   {
+
+    long gen = LOAD_ACQ( &q->current->array[ STACK_HD_CNT ] );
+    long node = q->current->array[ STACK_HEAD ];
+
+    while ( node >= HDR_END ) {
+
+        long *array = q->current->array;
+        long next = array[ node ];
+        size_t bytes = 0;
+        sh_status_e status = snap_item( q, io, 0, array[ node + VALUE_OFFSET ],
+                                        &bytes );
+
+        if ( status != SH_OK && status != SH_RETRY ) {
+
+            return status;
+
+        }
+
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+
+        if ( status == SH_RETRY || q->current->array[ STACK_HD_CNT ] != gen ) {
+
+            break;
+
+        }
+
+        io->pos += bytes;
+        (*count)++;
+        node = next;
+    }
+
+    return SH_OK;
+}
+
+
+/*
+    valid_record -- tests that vector count, data length, and every vector
+    length and offset of restored item lie within its record, using the same
+    layout walk as initialize_item_vector
+
+    returns true if item can be read safely, otherwise false
+*/
+static bool valid_record(
+
+    long *array,        // pointer to queue array -- not NULL
+    long data_slot,     // data item index
+    long slots          // data header and data slots of item
+
+)   {
+
+    long space = slots - DATA_HDR;
+    long vcnt = array[ data_slot + VEC_CNT ];
+    long length = array[ data_slot + DATA_LENGTH ];
+
+    if ( vcnt < 1 || vcnt > space || length < 0 || length > ( space << SZ_SHIFT ) ) {
+
+        return false;
+
+    }
+
+    if ( vcnt == 1 ) {
+
+        return true;
+
+    }
+
+    long offset = 0;
+
+    for ( long i = 0; i < vcnt; i++ ) {
+
+        if ( space - offset < 3 ) {
+
+            return false;
+
+        }
+
+        long len = array[ data_slot + DATA_HDR + offset + 1 ];
+
+        if ( len < 0 || len > ( ( space - offset - 2 ) << SZ_SHIFT ) ) {
+
+            return false;
+
+        }
+
+        offset += 2 + ( ( len <= sizeof(long) ) ? 1 : ( len + REM ) >> SZ_SHIFT );
+
+    }
+
+    return ( offset <= space );
+}
+
+
+/*
+    restore_item -- allocate node and data for item and read item from snapshot
+    into data
+
+    returns sh_status_e:
+
+    SH_OK           on success, with node set to queue node of item
+    SH_ERR_ARG      if vector count, length, or offset lies outside the record
+    SH_ERR_STATE    if item does not fit queue or stream ends first
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+    SH_ERR_SYS      if read from stream fails
+*/
+static sh_status_e restore_item(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    snap_io_s *io,      // pointer to snapshot stream -- not NULL
+    long slots,         // data header and data slots of item
+    long *node          // pointer to node of item -- not NULL
+
+)   {
+
+    long data_slot;
+
+    if ( is_slab( q ) ) {
+
+        if ( slots < DATA_HDR || slots > q->slab_slots - NODE_SIZE ) {
+
+            return SH_ERR_STATE;
+
+        }
+
+        view_s view = alloc_pooled_slots( (shr_base_s*) q, q->slab_slots,
+                                          SLAB_HEAD, SLAB_HD_CNT, SLAB_TAIL );
+
+        if ( view.slot == 0 ) {
+
+            return SH_ERR_NOMEM;
+
+        }
+
+        *node = view.slot;
+        data_slot = view.slot + NODE_SIZE;
+        view.extent->array[ data_slot + DATA_SLOTS ] = q->slab_slots - NODE_SIZE;
+
+    } else {
+
+        if ( slots < DATA_HDR || slots > ( LONG_MAX >> ( SZ_SHIFT + 1 ) ) ) {
+
+            return SH_ERR_STATE;
+
+        }
+
+        view_s view = alloc_data_slots( (shr_base_s*) q, slots );
+
+        if ( view.slot == 0 ) {
+
+            return SH_ERR_NOMEM;
+
+        }
+
+        data_slot = view.slot;
+        view = alloc_node( q );
+
+        if ( view.slot == 0 ) {
+
+            free_data_slots( (shr_base_s*) q, data_slot );
+            return SH_ERR_NOMEM;
+
+        }
+
+        *node = view.slot;
+    }
+
+    long *array = q->current->array;
+    array[ *node + VALUE_OFFSET ] = data_slot;
+    sh_status_e status = snap_read( io, &array[ data_slot + TM_SEC ],
+                                    ( slots - 1 ) << SZ_SHIFT );
+
+    if ( status == SH_OK && !valid_record( array, data_slot, slots ) ) {
+
+        status = SH_ERR_ARG;
+
+    }
+
+    if ( status ) {
+
+        release_data( q, data_slot );
+        release_node( q, *node );
+        return status;
+
+    }
+
+    queue_stamp( q, (struct timespec*) &array[ data_slot + TM_SEC ] );
+    update_buffer_size( array, slots, array[ data_slot + VEC_CNT ] * sizeof(sq_vec_s) );
+
+    return SH_OK;
+}
+
+
+/*
+    restore_chunk -- link chain of restored items onto end of lane, adjusting
+    gates and count once for the whole chain
+*/
+static sh_status_e restore_chunk(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    long *nodes,        // array of queue nodes -- not NULL
+    long count,         // number of nodes in array
+    long lane           // priority lane
+
+)   {
+
+    if ( count == 0 ) {
+
+        return SH_OK;
+
+    }
+
+    sh_status_e status = enq_gate_claim( q, count );
+
+    if ( status ) {
+
+        release_batch( q, nodes, count );
+        return status;
+
+    }
+
+    long *array = q->current->array;
+    long data_slot = array[ nodes[ count - 1 ] + VALUE_OFFSET ];
+    DWORD last_time = { .low = array[ data_slot + TM_SEC ],
+                        .high = array[ data_slot + TM_NSEC ] };
+
+    add_chain_end( (shr_base_s*) q, nodes, count, lane_tail( lane ) );
+    post_process_enq( q, count, last_time );
+
+    return deq_release_gates( q, count );
+}
+
+
+/*
+    restore_items -- read items from snapshot and add them to queue a chunk at
+    a time, until trailer ends the snapshot
+*/
+static sh_status_e restore_items(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    snap_io_s *io,      // pointer to snapshot stream -- not NULL
+    long *nodes         // array of SNAP_CHUNK queue nodes -- not NULL
+
+)   {
+
+    long lane = 0;
+    long count = 0;
+    long total = 0;
+
+    while ( true ) {
+
+        long record[ 2 ];   // lane and data slots of item
+        sh_status_e status = snap_read( io, record, sizeof(record) );
+
+        if ( status ) {
+
+            release_batch( q, nodes, count );
+            return status;
+
+        }
+
+        if ( record[ 0 ] != SNAP_END &&
+             ( record[ 0 ] < 0 || record[ 0 ] >= q->lanes ) ) {
+
+            release_batch( q, nodes, count );
+            return SH_ERR_STATE;
+
+        }
+
+        if ( record[ 0 ] != lane || count == SNAP_CHUNK ) {
+
+            status = restore_chunk( q, nodes, count, lane );
+
+            if ( status ) {
+
+                return status;
+
+            }
+
+            total += count;
+            count = 0;
+            lane = record[ 0 ];
+        }
+
+        if ( lane == SNAP_END ) {
+
+            return ( record[ 1 ] == total ) ? SH_OK : SH_ERR_STATE;
+
+        }
+
+        status = restore_item( q, io, record[ 1 ], &nodes[ count ] );
+
+        if ( status ) {
+
+            release_batch( q, nodes, count );
+            return status;
+
+        }
+
+        count++;
+    }
+}
+
+
+/*
+================================================================================
+
+    public function interface
+
+================================================================================
+*/
+
+
+/*
+    shr_q_create -- create shared memory queue using name
+
+    Creates shared queue using name to mmap POSIX shared memory object.  A
+    name with a '/' after its first character is instead the path of a regular
+    file, so the queue can be kept on a persistent file system, or on a
+    hugetlbfs mount to be backed by huge pages.  The first
+    process to open a file backed queue that no other process holds open
+    rebuilds the list tails, item count, and gates from the items on the
+    queue, and clears the subscribers, in case a process ended without
+    closing it.
+
+    Each process maps the queue once over a range of address space reserved
+    for it, so growth of the queue by any process is seen by the others
+    without remapping, and the queue never moves while it is open.
+
+    The max depth argument specifies the maximum number of items allowed on
+    queue.  When max depth is reached a depth event is generated and no more
+    items can be added to queue.  A value of 0 defaults to max possible value.
+
+    The mode specifies the ability to add items to or remove items from the
+    queue.  The default of 0 indicates that queue instance is unable to make
+    changes to the shared queue.
+
+    The returned queue will be opened for updates unless the mode specifies it
+    as immutable.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_ARG      if pointer to queue struct is NULL, max_depth is less than
+                    zero, or if no queue name
+    SH_ERR_ACCESS   on permissions error for queue name
+    SH_ERR_EXIST    if queue already exists
+    SH_ERR_NOMEM    if not enough memory to allocate
+    SH_ERR_PATH     if error in queue name
+    SH_ERR_SYS      if system call returns an error
+*/
+extern sh_status_e shr_q_create(
+
+    shr_q_s **q,            // address of q struct pointer -- not NULL
+    char const * const name,// name of q as a null terminated string -- not NULL
+    unsigned int max_depth, // max depth allowed at which add of item is blocked
+    sq_mode_e mode          // read/write mode
+
+)   {
+
+    return shr_q_create_ex( q, name, max_depth, mode, NULL );
+}
+
+
+/*
+    shr_q_create_ex -- create shared memory queue with create time attributes
+
+    Creates shared queue in the same manner as shr_q_create, but with optional
+    attributes that fix the structure of the queue for its lifetime.  A NULL
+    attribute pointer is the same as calling shr_q_create.
+
+    attribute flags:
+
+    SQ_SPSC         items are held in a contiguous ring buffer of ring_size
+                    bytes (rounded up to a power of two, default 1MB) instead
+                    of linked nodes, for use with a single adding thread and a
+                    single removing thread.  An item larger than the ring is
+                    rejected.  Adaptive LIFO, reserve, borrow, and batch add
+                    are not supported.
+
+    SQ_LEAN         adds and removes only maintain the item count.  Items are
+                    not timestamped, no events are generated, the last add
+                    time is not tracked, and no arrival signal is sent.
+                    Registering a monitor or listener, level, time limit,
+                    target delay, discard, adaptive LIFO, subscribe, clean,
+                    and last empty return SH_ERR_NOSUPPORT, item timestamps
+                    are zero, and the queue never exceeds its idle time.
+
+    SQ_WEIGHTED     removes from a queue with more than one lane usually take
+                    the highest non-empty lane, but lane k is tried first on
+                    every 2^(lanes - k)th remove, so busy higher lanes do not
+                    starve lower ones.
+
+    SQ_BROADCAST    each item is added once and read by every consumer group
+                    joined with shr_q_join, using shr_q_remove_group, which
+                    keeps a separate position for each of up to 8 groups.  An
+                    item is held on the queue, counting toward max_depth, until
+                    every joined group has read it, or while no group is
+                    joined.  Other removes, clean, discard, and adaptive LIFO
+                    return SH_ERR_NOSUPPORT, and SQ_BROADCAST may not be
+                    combined with SQ_SPSC, item_size, or lanes.
+
+    SQ_HUGE         the queue starts at and grows in steps of 2MB, with its
+                    mappings advised to use transparent huge pages, which
+                    takes effect for shared memory objects when the system
+                    allows huge pages for shared memory (see shmem_enabled
+                    under /sys/kernel/mm/transparent_hugepage).  A queue
+                    named by the path of a file on a hugetlbfs mount always
+                    starts at and grows in steps of the huge page size of the
+                    mount, such as 2MB or 1GB, whether or not SQ_HUGE is set.
+
+    other attributes:
+
+    item_size       when greater than 0, every item is limited to item_size
+                    bytes and is held in a fixed size node recycled through
+                    its own free list, avoiding a separate data allocation for
+                    each add.  Adds of larger items fail with SH_ERR_ARG.
+                    Reserve and borrow are not supported, and item_size may
+                    not be combined with SQ_SPSC.
+
+    clock           clock read for item, last add, and empty timestamps.
+                    SQ_CLOCK_REALTIME is the default.  Coarse clocks are
+                    cheaper to read at the cost of resolution, and
+                    SQ_CLOCK_TSC reads the calibrated time stamp counter,
+                    falling back to SQ_CLOCK_MONOTONIC where no counter is
+                    available.  Timestamps returned to callers are always
+                    converted to wall clock time.  A file backed queue,
+                    which may outlive a restart of the system, requires
+                    SQ_CLOCK_REALTIME or SQ_CLOCK_REALTIME_COARSE.
+
+    lanes           number of priority lanes, from 2 to 8, each with its own
+                    item list sharing the queue's memory, gates, and count.
+                    Items are added to a lane with shr_q_add_prio, and removes
+                    take the item at the front of the highest non-empty lane.
+                    Other adds use lane 0, the lowest priority.  0 or 1 is a
+                    single lane.  Adaptive LIFO is not supported, and lanes
+                    may not be combined with SQ_SPSC or item_size.
+
+    sync            flush policy of a file backed queue.  SQ_SYNC_NONE leaves
+                    write back to the system.  With SQ_SYNC_PERIODIC, each
+                    handle flushes the file from a background thread every
+                    sync_msec milliseconds (default 1000), and on close.  With
+                    SQ_SYNC_COMMIT, add calls return only after a flush that
+                    includes the items added, and concurrent adds, including
+                    each batch add, share a single flush.  Removes are made
+                    durable by later flushes.  A policy other than SQ_SYNC_NONE
+                    requires a file backed queue, and SQ_SPSC may not be file
+                    backed.
+
+    initial_size    bytes of memory allocated for the queue at create, rounded
+                    up to a multiple of the page size, or of the huge page size
+                    for a queue backed by huge pages.  Each process reserves
+                    64GB (64MB on 32 bit systems) of address space for the
+                    queue, or twice the initial size if larger, and maps the
+                    queue again if it outgrows half of that.  0 for a single
+                    page.
+
+    prealloc        number of items whose queue nodes, or fixed size nodes
+                    with item_size, are carved from queue memory at create and
+                    placed on the free node list, so a startup burst of adds
+                    does not grow the queue.  May not be combined
+                    with SQ_SPSC.
+
+    prealloc_len    when greater than 0 and prealloc is set, item length in
+                    bytes for which prealloc data allocations are also carved
+                    at create and placed on the free memory list for their
+                    size.  Items of other lengths allocate data as usual.
+
+    compact_msec    when greater than 0, each handle runs shr_q_compact from a
+                    background thread every compact_msec milliseconds.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_ARG      if pointer to queue struct is NULL, max_depth is less than
+                    zero, if no queue name, or if attributes invalid
+    SH_ERR_ACCESS   on permissions error for queue name
+    SH_ERR_EXIST    if queue already exists
+    SH_ERR_NOMEM    if not enough memory to allocate
+    SH_ERR_PATH     if error in queue name
+    SH_ERR_SYS      if system call returns an error
+*/
+extern sh_status_e shr_q_create_ex(
+
+    shr_q_s **q,            // address of q struct pointer -- not NULL
+    char const * const name,// name of q as a null terminated string -- not NULL
+    unsigned int max_depth, // max depth allowed at which add of item is blocked
+    sq_mode_e mode,         // read/write mode
+    sq_attr_s *attr         // pointer to create time attributes, or NULL
+
+)   {
+
+    if ( q == NULL || name == NULL || max_depth > SEM_VALUE_MAX ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( attr != NULL && ( ( attr->flags & ~( SQ_SPSC | SQ_LEAN | SQ_WEIGHTED |
+                                              SQ_BROADCAST | SQ_HUGE ) ) ||
+         ( ( attr->flags & SQ_SPSC ) && attr->item_size > 0 ) ||
+         attr->clock < SQ_CLOCK_REALTIME || attr->clock > SQ_CLOCK_TSC ||
+         attr->lanes < 0 || attr->lanes > MAX_LANES ||
+         ( attr->lanes > 1 && ( ( attr->flags & SQ_SPSC ) || attr->item_size > 0 ) ) ||
+         ( ( attr->flags & SQ_BROADCAST ) && ( ( attr->flags & SQ_SPSC ) ||
+           attr->item_size > 0 || attr->lanes > 1 ) ) ||
+         attr->sync < SQ_SYNC_NONE || attr->sync > SQ_SYNC_COMMIT ||
+         attr->sync_msec < 0 || attr->compact_msec < 0 ||
+         ( attr->sync != SQ_SYNC_NONE && !is_file_path( name ) ) ||
+         ( ( attr->flags & SQ_SPSC ) && is_file_path( name ) ) ||
+         ( attr->clock > SQ_CLOCK_REALTIME_COARSE && is_file_path( name ) ) ||
+         attr->prealloc < 0 || ( attr->prealloc > 0 && ( attr->flags & SQ_SPSC ) ) ) ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    sh_status_e status = perform_name_validations( name, NULL );
+    if ( status == SH_ERR_STATE ) {
+
+        return SH_ERR_EXIST;
+
+    }
+
+    if ( status != SH_ERR_EXIST ) {
+
+        return status;
+
+    }
+
+    status = create_base_object( (shr_base_s**) q, sizeof(shr_q_s), name, SHRQ,
+                                 sizeof(SHRQ) - 1, QVERSION,
+                                 attr != NULL && ( attr->flags & SQ_HUGE ),
+                                 ( attr == NULL ) ? 0 : attr->initial_size );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    (*q)->ready_fd = -1;
+    (*q)->wake_sock = -1;
+    status = format_as_queue( *q, max_depth, mode, attr );
+    if ( status ) {
+
+        // unlink object so the name can be used again
+        (void) shr_q_destroy( q );
+        return status;
+
+    }
+
+    if ( is_file_path( name ) ) {
+
+        (void) hold_object( (shr_base_s*) *q );
+        (*q)->current->array[ HOLDERS ] = 1;
+        (*q)->holding = true;
+        share_object( (shr_base_s*) *q );
+
+    }
+
+    status = start_sync( *q );
+    if ( status == SH_OK ) {
+
+        status = start_compact( *q );
+
+    }
+
+    if ( status ) {
+
+        shr_q_destroy( q );
+
+    }
+
+    return status;
+}
+
+
+/*
+    shr_q_open -- open shared memory queue for modification using name
+
+    Opens shared queue using name to mmap shared memory.  Queue must already
+    exist before it is opened.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_ARG      if pointer to queue struct or name is not NULL
+	SH_ERR_NOMEM	failed memory allocation
+    SH_ERR_ACCESS   on permissions error for queue name
+    SH_ERR_EXIST    if queue does not already exist
+    SH_ERR_PATH     if error in queue name
+    SH_ERR_STATE    if incompatible implementation
+    SH_ERR_SYS      if system call returns an error
+*/
+extern sh_status_e shr_q_open(
+
+    shr_q_s **q,            // address of q struct pointer -- not NULL
+    char const * const name,// name of q as a null terminated string -- not NULL
+    sq_mode_e mode          // read/write mode
+
+)   {
+
+    if ( q == NULL || name == NULL ) {
+
+        return SH_ERR_ARG;
+    }
+
+
+    size_t size = 0;
+    sh_status_e status = perform_name_validations( name, &size );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    status = initialize_q_struct( q, mode );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    status = map_shared_memory( (shr_base_s**) q, name );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    if ( is_valid_queue( *q ) ) {
+
+        long *array = (*q)->current->array;
+        (*q)->attr_flags = array[ ATTR_FLAGS ];
+        (*q)->lanes = array[ LANES ];
+        (*q)->uid_prefix = AFA( &array[ ID_CNTR ], 1 );
+        (*q)->uid_next = (*q)->uid_prefix << ( LONG_BIT / 2 );
+        load_clock( *q );
+
+        if ( array[ ITEM_SIZE ] > 0 ) {
+
+            (*q)->slab_slots = calc_slab_slots( array[ ITEM_SIZE ] );
+
+        }
+
+        if ( is_file_path( name ) ) {
+
+            if ( hold_object( (shr_base_s*) *q ) ) {
+
+                // holders remaining with no other holder did not close queue
+                if ( array[ HOLDERS ] != 0 ) {
+
+                    recover_queue( *q );
+
+                }
+
+                array[ HOLDERS ] = 1;
+                (void) fdatasync( (*q)->fd );
+
+            } else {
+
+                (void) AFA( &array[ HOLDERS ], 1 );
+
+            }
+
+            (*q)->holding = true;
+            share_object( (shr_base_s*) *q );
+        }
+
+        status = start_sync( *q );
+        if ( status == SH_OK ) {
+
+            status = start_compact( *q );
+
+        }
+
+        if ( status ) {
+
+            shr_q_close( q );
+
+        }
+
+        return status;
+
+    }
+
+    shr_q_close( q );
+    return SH_ERR_STATE;
+}
+
+
+/*
+    shr_q_close -- close shared memory queue
+
+    Closes shared queue and releases associated memory.  Queue nodes cached by
+    the queue instance are returned to the shared free node list.  The pointer
+    to the queue instance will be NULL on return.
+
+    returns sh_status_e:
+
+    SH_OK       on success
+    SH_ERR_ARG  if pointer to queue struct is NULL
+*/
+extern sh_status_e shr_q_close(
+
+    shr_q_s **q         // address of q struct pointer -- not NULL
+
+)   {
+
+    if ( q == NULL || *q == NULL ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    release_compact( *q );
+    // return cached nodes for use by other processes
+    mag_flush( *q, (*q)->mag_count );
+    release_ready( *q );
+    release_sync( *q );
+
+    if ( (*q)->holding ) {
+
+        // queue needs no repair once every holder has closed it
+        (void) AFS( &(*q)->current->array[ HOLDERS ], 1 );
+
+    }
+
+    close_base( (shr_base_s*) *q );
+
+    free( *q );
+    *q = NULL;
+
+    return SH_OK;
+}
+
+
+/*
+    shr_q_destroy -- unlink and release shared memory queue
+
+    Unlink shared queue and releases associated memory and resources.  The
+    pointer to the queue instance will be NULL on return. Shared queue will not
+    be available or usable to other processes.
+
+    returns sh_status_e:
 
     SH_OK       on success
     SH_ERR_ARG  if pointer to queue struct is NULL
     SH_ERR_SYS  if an error occurs releasing associated resources
 */
-extern sh_status_e shr_q_destroy(
+extern sh_status_e shr_q_destroy(
+
+    shr_q_s **q         // address of q struct pointer -- not NULL
+
+)   {
+
+    if ( q == NULL || *q == NULL ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    release_compact( *q );
+    release_ready( *q );
+    release_sync( *q );
+
+    sh_status_e status = release_mapped_memory( (shr_base_s**) q );
+
+    free( *q );
+    *q = NULL;
+
+    return status;
+}
+
+
+/*
+    shr_q_monitor -- registers calling process for notification using signals
+                     when events occur on shared queue
+
+    Any non-zero signal value registers calling process for notification using
+    the specified signal when an queue event occurs.  A signal value of zero
+    unregisters the process if it is currently registered.  Up to eight
+    processes can be registered across monitors, listeners, and callers.
+    If shr_q_coalesce is on, after a signal is sent the process is not
+    signalled again until it has called shr_q_event with the same queue struct.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_ARG      if pointer to queue struct is NULL, or if signal not greater
+                    than or equal to zero, or signal not in valid range
+    SH_ERR_STATE    if subscriber table is full
+    SH_ERR_NOSUPPORT    if registering and q is a lean queue
+*/
+extern sh_status_e shr_q_monitor(
+
+    shr_q_s *q,         // pointer to queue struct
+    int signal          // signal to use for event notification
+
+)   {
+
+    if ( q == NULL || signal < 0 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( signal > 0 && is_lean( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
+
+    sh_status_e status = subscribe( q, SUB_MONITOR, signal, 0 );
+
+    return status;
+}
+
+
+/*
+    shr_q_listen -- registers calling process for notification when items
+                    arrive on shared queue
+
+    Any non-zero value registers calling process for notification  using the
+    specified signal when an item arrives on queue.  A value of zero unregisters
+    the process if it is currently registered.  Up to eight processes can be
+    registered across monitors, listeners, and callers.  If shr_q_coalesce is
+    on, after a signal is sent the process is not signalled again until it has
+    called shr_q_count with the same queue struct.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_ARG      if pointer to queue struct is NULL, or if signal not greater
+                    than or equal to zero, or signal not in valid range
+    SH_ERR_STATE    if subscriber table is full
+    SH_ERR_NOSUPPORT    if registering and q is a lean queue
+*/
+extern sh_status_e shr_q_listen(
+
+    shr_q_s *q,         // pointer to queue struct
+    int signal          // signal to use for item arrival notification
+
+)   {
+
+    if ( q == NULL || signal < 0 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( signal > 0 && is_lean( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
+
+    sh_status_e status = subscribe( q, SUB_LISTEN, signal, 0 );
+
+    return status;
+}
+
+
+/*
+    shr_q_call -- registers calling process for notification when queue removes
+                  will block because queue is empty
+
+    Any non-zero value registers calling process for notification  using the
+    specified signal when a call blocks on remove from queue.  A value of zero
+    unregisters the process if it is currently registered.  Up to eight
+    processes can be registered across monitors, listeners, and callers.
+    If shr_q_coalesce is on, after a signal is sent the process is not
+    signalled again until it has called shr_q_call_count with the same queue
+    struct.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_ARG      if pointer to queue struct is NULL, or if signal not greater
+                    than or equal to zero, or signal not in valid range
+    SH_ERR_STATE    if subscriber table is full
+*/
+extern sh_status_e shr_q_call(
+
+    shr_q_s *q,         // pointer to queue struct
+    int signal          // signal to use for queue empty notification
+
+)   {
+
+    if ( q == NULL || signal < 0 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    sh_status_e status = subscribe( q, SUB_CALL, signal, 0 );
+
+    return status;
+}
+
+
+/*
+    shr_q_readiness_fd -- returns file descriptor that becomes readable when
+    queue has items to remove or room to add items
+
+    SQ_READY_NONEMPTY makes the descriptor readable when an item is added to
+    an empty queue, and SQ_READY_NONFULL when a remove makes room on a queue
+    that was at its depth limit.  The descriptor is a datagram socket owned
+    by q and closed when q is closed, so it can be added to poll, select, or
+    epoll.  Once readable, datagrams are to be read and discarded, and items
+    removed until SH_ERR_EMPTY is returned, or added until SH_ERR_LIMIT is
+    returned, which re-arms the descriptor.  A later call adds events to the
+    same descriptor.
+
+    returns file descriptor, or -1 if q is NULL, events are invalid or not
+    allowed by the mode of q, q is a lean queue, the subscriber table is
+    full, or the socket can not be created
+*/
+extern int shr_q_readiness_fd(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    int events          // events from sq_ready_e -- not 0
+
+)   {
+
+    if ( q == NULL || events == 0 ||
+         ( events & ~( SQ_READY_NONEMPTY | SQ_READY_NONFULL ) ) ||
+         ( ( events & SQ_READY_NONEMPTY ) && !( q->mode & SQ_READ_ONLY ) ) ||
+         ( ( events & SQ_READY_NONFULL ) && !( q->mode & SQ_WRITE_ONLY ) ) ||
+         is_lean( q ) ) {
+
+        return -1;
+
+    }
+
+    if ( q->ready_fd < 0 ) {
+
+        int fd = socket( AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+        if ( fd < 0 ) {
+
+            return -1;
+
+        }
+
+        struct sockaddr_un sa;
+        socklen_t len = ready_address( q, q->uid_prefix, &sa );
+
+        if ( bind( fd, (struct sockaddr*) &sa, len ) < 0 ) {
+
+            close( fd );
+            return -1;
+
+        }
+
+        q->ready_fd = fd;
+
+    }
+
+    if ( ( ( events & SQ_READY_NONEMPTY ) &&
+           subscribe( q, SUB_READY, -1, q->uid_prefix ) ) ||
+         ( ( events & SQ_READY_NONFULL ) &&
+           subscribe( q, SUB_SPACE, -1, q->uid_prefix ) ) ) {
+
+        return -1;
+
+    }
+
+    // readable at once if queue already has items or room
+    arm_ready( q, SUB_READY );
+    arm_ready( q, SUB_SPACE );
+
+    return q->ready_fd;
+}
+
+
+/*
+    shr_q_add -- add item to queue
+
+    Non-blocking add of an item to shared queue.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_LIMIT    if queue size is at maximum depth, or ring of an SPSC
+                    queue does not have room for item
+    SH_ERR_ARG      if q is NULL, value is NULL, or length is <= 0, or item
+                    is larger than the ring of an SPSC queue
+    SH_ERR_STATE    if q is immutable or read only or q corrupted
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+*/
+extern sh_status_e shr_q_add(
+
+    shr_q_s *q,         // pointer to queue -- not NULL
+    void *value,        // pointer to item -- not NULL
+    size_t length       // length of item -- greater than 0
+
+)   {
+
+    if ( q == NULL || value == NULL || length <= 0 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+
+        return SH_ERR_STATE;
+
+    }
+
+    sh_status_e status = enq_gate_try( q );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    status = enq( q, value, length, SH_STRM_T, 0 );
+
+    if ( status ) {
+
+        enq_release_gate( q );
+        return status;
+
+    }
+
+    status = deq_release_gate( q );
+    if ( status ) {
+
+        return status;
+    }
+
+
+    check_for_level_event( q );
+
+    return status;
+}
+
+
+/*
+    shr_q_add_prio -- add item to priority lane of queue
+
+    Non-blocking add of an item to a priority lane of a shared queue created
+    with lanes.  Lane 0 is the lowest priority and is the lane used by the
+    other add calls.  Removes take items from the highest non-empty lane.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_LIMIT    if queue size is at maximum depth
+    SH_ERR_ARG      if q is NULL, value is NULL, length is <= 0, or prio is
+                    not a lane of the queue
+    SH_ERR_STATE    if q is immutable or read only or q corrupted
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+*/
+extern sh_status_e shr_q_add_prio(
+
+    shr_q_s *q,         // pointer to queue -- not NULL
+    void *value,        // pointer to item -- not NULL
+    size_t length,      // length of item -- greater than 0
+    int prio            // priority lane of item -- 0 to lanes - 1
+
+)   {
+
+    if ( q == NULL || value == NULL || length <= 0 || prio < 0 ||
+         prio >= q->lanes ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+
+        return SH_ERR_STATE;
+
+    }
+
+    sh_status_e status = enq_gate_try( q );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    status = enq( q, value, length, SH_STRM_T, prio );
+
+    if ( status ) {
+
+        enq_release_gate( q );
+        return status;
+
+    }
+
+    status = deq_release_gate( q );
+    if ( status ) {
+
+        return status;
+    }
+
+
+    check_for_level_event( q );
+
+    return status;
+}
+
+
+/*
+    shr_q_add_wait -- attempt to add item to queue
+
+    Attempt add of an item to shared queue, and block if at max depth limit
+    until depth limit allows, or for an SPSC queue, until the ring has room.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_ARG      if q is NULL, value is NULL, or length is <= 0, or item
+                    is larger than the ring of an SPSC queue
+    SH_ERR_STATE    if q is immutable or read only or q corrupted
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+*/
+extern sh_status_e shr_q_add_wait(
+
+    shr_q_s *q,         // pointer to queue -- not NULL
+    void *value,        // pointer to item -- not NULL
+    size_t length       // length of item -- greater than 0
+
+)   {
+
+    if ( q == NULL || value == NULL || length <= 0 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+
+        return SH_ERR_STATE;
+
+    }
+
+    sh_status_e status = enq_gate_blk( q );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    sq_vec_s item = { .type = SH_STRM_T, .len = length, .base = value };
+    status = enq_wait( q, &item, 1, NULL );
+
+    if ( status != SH_OK ) {
+
+        enq_release_gate( q );
+        return status;
+
+    }
+
+    status = deq_release_gate( q );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    check_for_level_event( q );
+
+    return status;
+}
+
+
+/*
+    shr_q_add_timedwait -- attempt to add item to queue
+
+    Attempt add of an item to shared queue, and block if at max depth limit
+    until depth limit allows, or for an SPSC queue, until the ring has room,
+    or timeout value reached.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_LIMIT    if queue size is at maximum depth, or ring of an SPSC
+                    queue is full
+    SH_ERR_ARG      if q is NULL, value is NULL, length is <= 0, timeout is
+                    NULL, or item is larger than the ring of an SPSC queue
+    SH_ERR_STATE    if q is immutable or read only or q corrupted
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+*/
+extern sh_status_e shr_q_add_timedwait(
+
+    shr_q_s *q,                 // pointer to queue -- not NULL
+    void *value,                // pointer to item -- not NULL
+    size_t length,              // length of item -- greater than 0
+    struct timespec *timeout    // timeout value -- not NULL
+
+)   {
+
+    if ( q == NULL || value == NULL || length <= 0 || timeout == NULL ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+
+        return SH_ERR_STATE;
+
+    }
+
+    struct timespec ts;
+    deadline_after( timeout, &ts );
+
+    sh_status_e status = enq_gate_tm( q, timeout );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    sq_vec_s item = { .type = SH_STRM_T, .len = length, .base = value };
+    status = enq_wait( q, &item, 1, &ts );
+    if ( status ) {
+
+        enq_release_gate( q );
+        return status;
+
+    }
+
+    status = deq_release_gate( q );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    check_for_level_event( q );
+
+    return status;
+}
+
+
+/*
+    shr_q_addv -- add vector of items to queue
+
+    Non-blocking add of a vector of items to shared queue.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_LIMIT    if queue size is at maximum depth
+    SH_ERR_ARG      if q is NULL, vector is NULL, or vcnt is < 1
+    SH_ERR_STATE    if q is immutable or read only
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+*/
+extern sh_status_e shr_q_addv(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_vec_s *vector,   // pointer to vector of items -- not NULL
+    int vcnt            // count of vector array -- must be >= 1
+
+)   {
+
+    if ( q == NULL || vector == NULL || vcnt < 1 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+
+        return SH_ERR_STATE;
+
+    }
+
+    sh_status_e status = enq_gate_try( q );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    if ( vcnt == 1 ) {
+
+        status = enq( q, vector[ 0 ].base, vector[ 0 ].len, vector[ 0 ].type, 0 );
+
+    } else {
+
+        status = enqv( q, vector, vcnt );
+
+    }
+
+    if ( status ) {
+
+        enq_release_gate( q );
+        return status;
+
+    }
+
+    status = deq_release_gate( q );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    check_for_level_event( q );
+
+    return status;
+}
+
+
+/*
+    shr_q_addv_wait -- attempt to add vector of items to queue
+
+    Attempt to add a vector of items to shared queue, and block if at max depth
+    limit until depth limit allows, or for an SPSC queue, until the ring has
+    room.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_ARG      if q is NULL, vector is NULL, or vcnt is < 1, or items
+                    are larger than the ring of an SPSC queue
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+*/
+extern sh_status_e shr_q_addv_wait(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_vec_s *vector,   // pointer to vector of items -- not NULL
+    int vcnt            // count of vector array -- must be >= 1
+
+)   {
+
+    if ( q == NULL || vector == NULL || vcnt < 1 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+
+        return SH_ERR_STATE;
+
+    }
+
+    sh_status_e status = enq_gate_blk( q );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    status = enq_wait( q, vector, vcnt, NULL );
+
+    if ( status ) {
+
+        enq_release_gate( q );
+        return status;
+
+    }
+
+    status = deq_release_gate( q );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    check_for_level_event( q );
+
+    return status;
+}
+
+
+/*
+    shr_q_addv_timedwait -- attempt to add vector of items to queue for
+                            specified period
+
+    Attempt to add a vector of items to shared queue, and block if at max depth
+    limit until depth limit allows, or for an SPSC queue, until the ring has
+    room, or timeout value reached.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_LIMIT    if queue size is at maximum depth, or ring of an SPSC
+                    queue is full
+    SH_ERR_ARG      if q is NULL, vector is NULL, vcnt is < 1, timeout is
+                    NULL, or items are larger than the ring of an SPSC queue
+    SH_ERR_STATE    if q is immutable or read only or q corrupted
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+*/
+extern sh_status_e shr_q_addv_timedwait(
+
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    sq_vec_s *vector,           // pointer to vector of items -- not NULL
+    int vcnt,                   // count of vector array -- must be >= 1
+    struct timespec *timeout    // timeout value -- not NULL
+
+)   {
+
+    if ( q == NULL || vector == NULL || vcnt < 1 || timeout == NULL ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+
+        return SH_ERR_STATE;
+
+    }
+
+    struct timespec ts;
+    deadline_after( timeout, &ts );
+
+    sh_status_e status = enq_gate_tm( q, timeout );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    status = enq_wait( q, vector, vcnt, &ts );
+
+    if ( status != SH_OK ) {
+
+        enq_release_gate( q );
+        return status;
+
+    }
+
+    status = deq_release_gate( q );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    check_for_level_event( q );
+
+    return status;
+}
+
+
+/*
+    shr_q_add_batch -- add multiple separate items to queue in a single call
+
+    Non-blocking add of count independent items described by the items array,
+    where each element supplies the type, length, and pointer to the data of an
+    item.  The items are linked together privately and appended to the queue
+    as a unit, so they are added in array order and no other item is
+    interleaved between them.  Either all of the items are added, or none are.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_LIMIT    if adding count items would exceed maximum depth of queue
+    SH_ERR_ARG      if q is NULL, items is NULL, count <= 0, or an item has a
+                    NULL data pointer or length <= 0
+    SH_ERR_STATE    if q is immutable or read only or q corrupted
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+    SH_ERR_NOSUPPORT    if q is a ring buffer queue
+*/
+extern sh_status_e shr_q_add_batch(
+
+    shr_q_s *q,         // pointer to queue -- not NULL
+    sq_vec_s *items,    // array of items -- not NULL
+    int count           // number of items in array -- greater than 0
+
+)   {
+
+    if ( q == NULL || items == NULL || count <= 0 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    for ( int i = 0; i < count; i++ ) {
+
+        if ( items[ i ].base == NULL || items[ i ].len <= 0 ) {
+
+            return SH_ERR_ARG;
+
+        }
+    }
+
+    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+
+        return SH_ERR_STATE;
+
+    }
+
+    if ( is_ring( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
+
+    long batch[ BATCH_NODES ];
+    long *nodes = batch;
+
+    if ( count > BATCH_NODES ) {
+
+        nodes = malloc( count * sizeof(long) );
+        if ( nodes == NULL ) {
+
+            return SH_ERR_NOMEM;
+
+        }
+    }
+
+    // claim room for all items or none
+    sh_status_e status = enq_gate_claim( q, count );
+
+    if ( status == SH_OK ) {
+
+        status = enq_batch( q, items, nodes, count );
+
+        if ( status ) {
+
+            enq_release_gates( q, count );
+
+        } else {
+
+            status = deq_release_gates( q, count );
+
+        }
+    }
+
+    if ( status == SH_OK ) {
+
+        check_for_level_event( q );
+
+    }
+
+    if ( nodes != batch ) {
+
+        free( nodes );
+
+    }
+
+    return status;
+}
+
+
+/*
+    shr_q_reserve -- reserve space for an item directly in shared memory
+
+    Non-blocking reservation of space for an item of the specified length.  On
+    success, value will point at the reserved space in the mapped shared memory
+    and handle will identify the reservation.  The caller can write the item in
+    place and then must either call shr_q_commit to add the item to the queue,
+    or shr_q_abort to release the space.  The reservation counts against the
+    maximum depth of the queue until it is committed or aborted.
+
+    Note:  value is only valid until the reservation is committed or aborted,
+    and the reservation is marked in the item header so that commit and abort
+    can reject a handle that is not an outstanding reservation
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_LIMIT    if queue size is at maximum depth
+    SH_ERR_ARG      if q is NULL, value or handle is NULL, or length is <= 0
+    SH_ERR_STATE    if q is immutable or read only or q corrupted
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+    SH_ERR_NOSUPPORT    if q is a ring buffer or fixed item size queue
+*/
+extern sh_status_e shr_q_reserve(
+
+    shr_q_s *q,         // pointer to queue -- not NULL
+    size_t length,      // length of item -- greater than 0
+    void **value,       // address of pointer to reserved space -- not NULL
+    long *handle        // pointer to reservation handle -- not NULL
+
+)   {
+
+    if ( q == NULL || value == NULL || handle == NULL || length <= 0 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+
+        return SH_ERR_STATE;
+
+    }
+
+    if ( is_ring( q ) || is_slab( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
+
+    sh_status_e status = enq_gate_try( q );
+    if ( status ) {
+
+        return status;
+
+    }
+
+    view_s view = alloc_value( q, length, SH_STRM_T );
+    if ( view.slot < HDR_END ) {
+
+        enq_release_gate( q );
+        return SH_ERR_NOMEM;
+
+    }
+
+    STORE_REL( &view.extent->array[ view.slot + TM_NSEC ], RESV_MARK );
+    *value = &view.extent->array[ view.slot + DATA_HDR ];
+    *handle = view.slot;
+    return SH_OK;
+}
+
+
+/*
+    claim_reservation -- atomically clears reservation mark of handle so only
+    one commit or abort can succeed
+
+    returns true if handle was an outstanding reservation, otherwise false
+*/
+static bool claim_reservation(
 
-    shr_q_s **q         // address of q struct pointer -- not NULL
+    shr_q_s *q,         // pointer to queue -- not NULL
+    long handle,        // reservation handle from shr_q_reserve
+    long nsec           // value to replace mark
 
 )   {
 
-    if ( q == NULL || *q == NULL ) {
+    sync_extent( (shr_base_s*) q );
+    long *array = q->current->array;
+
+    if ( handle < HDR_END || handle > array[ SIZE ] - DATA_HDR ) {
+
+        return false;
+
+    }
+
+    long mark = RESV_MARK;
+    return CAS( &array[ handle + TM_NSEC ], &mark, nsec );
+}
+
+
+/*
+    shr_q_commit -- add previously reserved item to queue
+
+    Adds the item written in place in the space returned by shr_q_reserve to
+    the queue.  The timestamp of the item is the time of the commit.  If the
+    commit fails for any reason other than an invalid handle, the reservation
+    is released as if aborted.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_ARG      if q is NULL, or handle is not an outstanding reservation
+    SH_ERR_STATE    if q is immutable or read only or q corrupted
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+*/
+extern sh_status_e shr_q_commit(
+
+    shr_q_s *q,         // pointer to queue -- not NULL
+    long handle         // reservation handle from shr_q_reserve
+
+)   {
+
+    if ( q == NULL ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+
+        return SH_ERR_STATE;
+
+    }
+
+    struct timespec curr_time;
+    item_time( q, &curr_time );
+
+    if ( !claim_reservation( q, handle, curr_time.tv_nsec ) ) {
 
         return SH_ERR_ARG;
 
     }
 
-    release_prev_extents( (shr_base_s*) *q );
+    q->current->array[ handle + TM_SEC ] = curr_time.tv_sec;
 
-    sh_status_e status = release_semaphores( q );
+    sh_status_e status = enq_data( q, handle, 0 );
     if ( status ) {
 
-        free( *q );
-        *q = NULL;
+        enq_release_gate( q );
         return status;
 
     }
 
-    status = release_mapped_memory( (shr_base_s**) q );
+    status = deq_release_gate( q );
+    if ( status ) {
 
-    free( *q );
-    *q = NULL;
+        return status;
+
+    }
+
+    check_for_level_event( q );
 
     return status;
 }
 
 
 /*
-    shr_q_monitor -- registers calling process for notification using signals
-                     when events occur on shared queue
-
-    Any non-zero signal value registers calling process for notification using
-    the specified signal when an queue event occurs.  A signal value of zero
-    unregisters the process if it is currently registered.  Only a single
-    process can be registered for event notifications.
+    shr_q_abort -- release previously reserved space without adding an item
 
     returns sh_status_e:
 
     SH_OK           on success
-    SH_ERR_ARG      if pointer to queue struct is NULL, or if signal not greater
-                    than or equal to zero, or signal not in valid range
-    SH_ERR_STATE    if unable to add pid
+    SH_ERR_ARG      if q is NULL, or handle is not an outstanding reservation
+    SH_ERR_STATE    if q is immutable or read only or q corrupted
 */
-extern sh_status_e shr_q_monitor(
+extern sh_status_e shr_q_abort(
 
-    shr_q_s *q,         // pointer to queue struct
-    int signal          // signal to use for event notification
+    shr_q_s *q,         // pointer to queue -- not NULL
+    long handle         // reservation handle from shr_q_reserve
 
 )   {
 
-    if ( q == NULL || signal < 0 ) {
+    if ( q == NULL ) {
 
         return SH_ERR_ARG;
 
     }
 
-    guard_q_memory( q );
-
-    long pid = getpid();
-    long prev = q->current->array[ NOTIFY_PID ];
-
-    if ( signal == 0 ) {
+    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
 
-        pid = 0;
+        return SH_ERR_STATE;
 
     }
 
+    if ( !claim_reservation( q, handle, 0 ) ) {
 
-    if ( CAS( &q->current->array[ NOTIFY_PID ], &prev, pid ) ) {
-
-        q->current->array[ NOTIFY_SIGNAL ] = signal;
-        unguard_q_memory( q );
-        return SH_OK;
+        return SH_ERR_ARG;
 
     }
 
-    unguard_q_memory( q );
-    return SH_ERR_STATE;
+    free_data_slots( (shr_base_s*) q, handle );
+    sh_status_e status = enq_release_gate( q );
+
+    return status;
 }
 
 
 /*
-    shr_q_listen -- registers calling process for notification when items
-                    arrive on shared queue
+    shr_q_remove -- remove item from queue
 
-    Any non-zero value registers calling process for notification  using the
-    specified signal when an item arrives on queue.  A value of zero unregisters
-    the process if it is currently registered.  Only a single process can be
-    registered for event notifications.
+    Non-blocking remove of an item from shared queue.  If buffer is provided, it
+    will be validated as being large enough using the specified size, and will
+    contain the data upon return.  If buffer is not large enough, the memory
+    will be released using free and allocated with malloc to be the correct size
+    to hold the queued item data.  Upon resizing of buffer, the length will be
+    large enough to contain the returned data.  If buffer is not provided, a
+    buffer will be allocated that is at least large enough to contain the item
+    being removed and the length of buffer will be updated.
 
-    returns sh_status_e:
+    A struct of type sq_item_s is returned in all cases, with the status of the
+    call, a pointer to the data value being returned in the buffer, the length
+    of the data being returned, and a pointer to timestamp in the buffer of when
+    the item was added to the queue.
+
+    returned sh_status_e:
 
     SH_OK           on success
-    SH_ERR_ARG      if pointer to queue struct is NULL, or if signal not greater
-                    than or equal to zero, or signal not in valid range
-    SH_ERR_STATE    if unable to add pid, or unregistering and pid does not match
+    SH_ERR_EMPTY    if q is empty
+    SH_ERR_ARG      if q is NULL, or buffer pointer not NULL and length <= 0
+    SH_ERR_STATE    if q is immutable or write only
+    SH_ERR_NOMEM    if not enough memory to satisfy request
 */
-extern sh_status_e shr_q_listen(
+extern sq_item_s shr_q_remove(
 
-    shr_q_s *q,         // pointer to queue struct
-    int signal          // signal to use for item arrival notification
+    shr_q_s *q,         // pointer to queue structure -- not NULL
+    void **buffer,      // address of buffer pointer -- not NULL
+    size_t *buff_size   // pointer to size of buffer -- not NULL
 
 )   {
 
-    if ( q == NULL || signal < 0 ) {
+    if ( q == NULL ||
+         buffer == NULL ||
+         buff_size == NULL ||
+         ( *buffer != NULL && *buff_size <= 0 ) ) {
 
-        return SH_ERR_ARG;
+        return (sq_item_s) { .status = SH_ERR_ARG };
 
     }
 
-    guard_q_memory( q );
+    if ( !( q->mode & SQ_READ_ONLY ) ) {
+
+        return (sq_item_s) { .status = SH_ERR_STATE };
 
-    long pid = getpid();
-    long prev = q->current->array[ LISTEN_PID ];
+    }
 
-    if ( signal == 0 ) {
+    sq_item_s item = { 0 };
 
-        pid = 0;
+    while ( true ) {
 
-    }
+        item.status = deq_gate_try( q );
+        if ( item.status ) {
 
-    if ( CAS( &q->current->array[ LISTEN_PID ], &prev, pid ) ) {
+            break;
 
-        q->current->array[ LISTEN_SIGNAL ] = signal;
-        unguard_q_memory( q );
-        return SH_OK;
+        }
+
+        item = deq( q, buffer, buff_size );
+        if ( item.status != SH_ERR_EXIST ) {
+
+            if ( item.status ) {
+
+                deq_release_gate( q );
+
+            } else {
+
+                item.status = enq_release_gate( q );
 
+            }
+
+            break;
+
+        }
+
+        enq_release_gate( q );
+    
     }
 
-    unguard_q_memory( q );
-    return SH_ERR_STATE;
+    return item;
 }
 
 
 /*
-    shr_q_call -- registers calling process for notification when queue removes
-                  will block because queue is empty
+    shr_q_remove_wait -- attempt to remove item from queue, block if empty
 
-    Any non-zero value registers calling process for notification  using the
-    specified signal when a call blocks on remove from queue.  A value of zero
-    unregisters the process if it is currently registered.  Only a single
-    process can be registered for event notifications.
+    Remove an item from shared queue and block if queue is empty.  If
+    buffer is provided, it will be validated as being large enough using
+    the specified size, and will contain the data upon return.  If buffer is not
+    large enough, the memory will be released using free and allocated with
+    malloc to be the correct size to hold the queued item data.  Upon resizing
+    of buffer, the length will large enough to contain the returned data.  If
+    buffer is not provided, a buffer will be allocated that is large enough to
+    contain the data being removed and the length of buffer will be updated.
 
-    returns sh_status_e:
+    A struct of type sq_item_s is returned in all cases, with the status of the
+    call, a pointer to the data value being returned in the buffer, the length
+    of the data being returned, and a pointer to timestamp in the buffer of when
+    the item was added to the queue.
+
+    returned sh_status_e:
 
     SH_OK           on success
-    SH_ERR_ARG      if pointer to queue struct is NULL, or if signal not greater
-                    than or equal to zero, or signal not in valid range
-    SH_ERR_STATE    if unable to add pid, or unregistering and pid does not match
+    SH_ERR_EMPTY    if q is empty
+    SH_ERR_ARG      if q is NULL, or buffer pointer not NULL and length <= 0
+    SH_ERR_STATE    if q is immutable or write only
+    SH_ERR_NOMEM    if not enough memory to satisfy request
 */
-extern sh_status_e shr_q_call(
+extern sq_item_s shr_q_remove_wait(
 
-    shr_q_s *q,         // pointer to queue struct
-    int signal          // signal to use for queue empty notification
+    shr_q_s *q,             // pointer to queue struct -- not NULL
+    void **buffer,          // address of buffer pointer -- not NULL
 
+    size_t *buff_size       // pointer to size of buffer -- not NULL
 )   {
 
-    if ( q == NULL || signal < 0 ) {
+    if ( q == NULL ||
+         buffer == NULL ||
+         buff_size == NULL ||
+         ( *buffer != NULL && *buff_size <= 0 ) ) {
 
-        return SH_ERR_ARG;
+        return (sq_item_s) { .status = SH_ERR_ARG };
 
     }
 
-    guard_q_memory( q );
+    if ( !( q->mode & SQ_READ_ONLY ) ) {
 
-    long pid = getpid();
-    long prev = q->current->array[ CALL_PID ];
+        return (sq_item_s) { .status = SH_ERR_STATE };
 
-    if ( signal == 0 ) {
+    }
+
+    sq_item_s item = { 0 };
 
-        pid = 0;
+    while ( true ) {
 
-    }
+        item.status = deq_gate_blk( q );
+        if ( item.status ) {
 
+            break;
 
-    if ( CAS( &q->current->array[ CALL_PID ], &prev, pid ) ) {
+        }
 
-        q->current->array[ CALL_SIGNAL ] = signal;
-        unguard_q_memory( q );
-        return SH_OK;
+        item = deq( q, buffer, buff_size );
+        if ( item.status != SH_ERR_EXIST ) {
+
+            if ( item.status ) {
+
+                deq_release_gate( q );
+
+            } else {
+
+                item.status = enq_release_gate( q );
+
+            }
+
+            break;
+
+        }
 
+        enq_release_gate( q );
+    
     }
 
-    unguard_q_memory( q );
-    return SH_ERR_STATE;
+    return item;
 }
 
 
 /*
-    shr_q_add -- add item to queue
+    shr_q_remove_timedwait -- attempt to remove item from queue for specified
+    amount of time
+
+    Remove an item from shared queue that blocks if queue is empty, but only
+    for time period specfied by timeout value.  If buffer is provided, it will
+    be validated as being large enough using the specified size, and will
+    contain the data upon return.  If buffer is not large enough, the memory
+    will be released using free and allocated with malloc to be the correct size
+    to hold the queued item data.  Upon resizing of buffer, the length will
+    large enough to contain the returned data.  If buffer is not provided, a
+    buffer will be allocated that is large enough to contain the data being
+    removed and the length of buffer will be updated.
 
-    Non-blocking add of an item to shared queue.
+    A struct of type sq_item_s is returned in all cases, with the status of the
+    call, a pointer to the data value being returned in the buffer, the length
+    of the data being returned, and a pointer to timestamp in the buffer of when
+    the item was added to the queue.
 
     returns sh_status_e:
 
     SH_OK           on success
-    SH_ERR_LIMIT    if queue size is at maximum depth
-    SH_ERR_ARG      if q is NULL, value is NULL, or length is <= 0
-    SH_ERR_STATE    if q is immutable or read only or q corrupted
+    SH_ERR_EMPTY    if q is empty
+    SH_ERR_ARG      if q is NULL, or buffer pointer not NULL and length <= 0
+    SH_ERR_STATE    if q is immutable or write only
     SH_ERR_NOMEM    if not enough memory to satisfy request
 */
-extern sh_status_e shr_q_add(
+extern sq_item_s shr_q_remove_timedwait(
 
-    shr_q_s *q,         // pointer to queue -- not NULL
-    void *value,        // pointer to item -- not NULL
-    size_t length       // length of item -- greater than 0
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    void **buffer,              // address of buffer pointer -- not NULL
+    size_t *buff_size,          // pointer to size of buffer -- not NULL
+    struct timespec *timeout    // timeout value -- not NULL
 
 )   {
 
-    if ( q == NULL || value == NULL || length <= 0 ) {
+    if ( q == NULL ||
+         buffer == NULL ||
+         buff_size == NULL ||
+         ( *buffer != NULL && *buff_size <= 0 ) ||
+         timeout == NULL ) {
 
-        return SH_ERR_ARG;
+        return (sq_item_s) { .status = SH_ERR_ARG };
 
     }
 
-    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+    if ( !( q->mode & SQ_READ_ONLY ) ) {
 
-        return SH_ERR_STATE;
+        return (sq_item_s) { .status = SH_ERR_STATE };
 
     }
 
-    guard_q_memory( q );
+    sq_item_s item = { 0 };
 
-    sh_status_e status = enq_gate_try( q );
-    if ( status ) {
+    while ( true ) {
 
-        unguard_q_memory( q );
-        return status;
+        item.status = deq_gate_tm( q, timeout );
+        if ( item.status ) {
 
-    }
+            break;
 
-    status = enq( q, value, length, SH_STRM_T );
+        }
 
-    if ( status ) {
+        item = deq( q, buffer, buff_size );
+        if ( item.status != SH_ERR_EXIST ) {
 
-        enq_release_gate( q );
-        unguard_q_memory( q );
-        return status;
+            if ( item.status ) {
 
-    }
+                deq_release_gate( q );
 
-    status = deq_release_gate( q );
-    if ( status ) {
+            } else {
 
-        unguard_q_memory( q );
-        return status;
-    }
+                item.status = enq_release_gate( q );
 
+            }
 
-    check_for_level_event( q );
+            break;
 
-    unguard_q_memory( q );
-    return status;
+        }
+
+        enq_release_gate( q );
+
+    }
+
+    return item;
 }
 
 
 /*
-    shr_q_add_wait -- attempt to add item to queue
+    shr_q_join -- join consumer group of broadcast queue
 
-    Attempt add of an item to shared queue, and block if at max depth limit
-    until depth limit allows.
+    Every consumer group of a broadcast queue reads every item added to the
+    queue, and items are held on the queue until every joined group has read
+    them.  A group that joins starts from the oldest item still held.  Joining
+    a group that is already joined, such as from a second process sharing the
+    reads of the group, leaves its position unchanged.
 
     returns sh_status_e:
 
     SH_OK           on success
-    SH_ERR_ARG      if q is NULL, value is NULL, or length is <= 0
-    SH_ERR_STATE    if q is immutable or read only or q corrupted
-    SH_ERR_NOMEM    if not enough memory to satisfy request
+    SH_ERR_ARG      if q is NULL or group is not 0 to 7
+    SH_ERR_STATE    if q is write only
+    SH_ERR_NOSUPPORT    if q is not a broadcast queue
 */
-extern sh_status_e shr_q_add_wait(
+extern sh_status_e shr_q_join(
 
-    shr_q_s *q,         // pointer to queue -- not NULL
-    void *value,        // pointer to item -- not NULL
-    size_t length       // length of item -- greater than 0
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    int group                   // consumer group -- 0 to 7
 
 )   {
 
-    if ( q == NULL || value == NULL || length <= 0 ) {
+    if ( q == NULL || group < 0 || group >= BCAST_GROUPS ) {
 
         return SH_ERR_ARG;
 
     }
 
-    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+    if ( !is_broadcast( q ) ) {
 
-        return SH_ERR_STATE;
+        return SH_ERR_NOSUPPORT;
 
     }
 
-    guard_q_memory( q );
-
-    sh_status_e status = enq_gate_blk( q );
-    if ( status ) {
+    if ( !( q->mode & SQ_READ_ONLY ) ) {
 
-        unguard_q_memory( q );
-        return status;
+        return SH_ERR_STATE;
 
     }
 
-    status = enq( q, value, length, SH_STRM_T );
-
-    if ( status != SH_OK ) {
-
-        enq_release_gate( q );
-        unguard_q_memory( q );
-        return status;
+    (void) lock_broadcast( q, true );
 
-    }
+    long *array = q->current->array;
+    long entry = GROUP_TABLE + ( group * LINE_SLOTS );
 
-    status = deq_release_gate( q );
-    if ( status ) {
+    if ( !array[ entry + GROUP_ACTIVE ] ) {
 
-        unguard_q_memory( q );
-        return status;
+        // item of front node of list has been read by every group
+        array[ entry + GROUP_CURSOR ] = array[ HEAD ];
+        array[ entry + GROUP_SEQ ] = array[ HEAD_CNT ] - TAIL;
+        array[ entry + GROUP_ACTIVE ] = 1;
 
     }
 
-    check_for_level_event( q );
+    STORE_REL( &array[ BCAST_LOCK ], 0 );
 
-    unguard_q_memory( q );
-    return status;
+    return SH_OK;
 }
 
 
 /*
-    shr_q_add_timedwait -- attempt to add item to queue
+    shr_q_leave -- leave consumer group of broadcast queue
 
-    Attempt add of an item to shared queue, and block if at max depth limit
-    until depth limit allows or timeout value reached.
+    Items are no longer held on the queue for the group.  Any process reading
+    for the group must join it again before reading.
 
     returns sh_status_e:
 
     SH_OK           on success
-    SH_ERR_LIMIT    if queue size is at maximum depth
-    SH_ERR_ARG      if q is NULL, value is NULL, length is <= 0, or timeout
-                    is NULL
-    SH_ERR_STATE    if q is immutable or read only or q corrupted
-    SH_ERR_NOMEM    if not enough memory to satisfy request
+    SH_ERR_ARG      if q is NULL or group is not 0 to 7
+    SH_ERR_STATE    if q is write only
+    SH_ERR_NOSUPPORT    if q is not a broadcast queue
 */
-extern sh_status_e shr_q_add_timedwait(
+extern sh_status_e shr_q_leave(
 
-    shr_q_s *q,                 // pointer to queue -- not NULL
-    void *value,                // pointer to item -- not NULL
-    size_t length,              // length of item -- greater than 0
-    struct timespec *timeout    // timeout value -- not NULL
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    int group                   // consumer group -- 0 to 7
 
 )   {
 
-    if ( q == NULL || value == NULL || length <= 0 || timeout == NULL ) {
+    if ( q == NULL || group < 0 || group >= BCAST_GROUPS ) {
 
         return SH_ERR_ARG;
 
     }
 
-    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
-
-        return SH_ERR_STATE;
-
-    }
-
-    guard_q_memory( q );
-
-    sh_status_e status = enq_gate_tm( q, timeout );
-    if ( status ) {
-
-        unguard_q_memory( q );
-        return status;
-
-    }
-
-    status = enq( q, value, length, SH_STRM_T );
-    if ( status ) {
+    if ( !is_broadcast( q ) ) {
 
-        enq_release_gate( q );
-        unguard_q_memory( q );
-        return status;
+        return SH_ERR_NOSUPPORT;
 
     }
 
-    status = deq_release_gate( q );
-    if ( status ) {
+    if ( !( q->mode & SQ_READ_ONLY ) ) {
 
-        unguard_q_memory( q );
-        return status;
+        return SH_ERR_STATE;
 
     }
 
-    check_for_level_event( q );
+    STORE_REL( &q->current->array[ GROUP_TABLE + ( group * LINE_SLOTS ) + GROUP_ACTIVE ], 0 );
+    reclaim_broadcast( q );
 
-    unguard_q_memory( q );
-    return status;
+    return SH_OK;
 }
 
 
 /*
-    shr_q_addv -- add vector of items to queue
+    shr_q_remove_group -- remove next item for consumer group of broadcast
+    queue
 
-    Non-blocking add of a vector of items to shared queue.
+    Non-blocking read of the item that follows the last item read by the
+    group.  Each item is returned once to each group, shared among the
+    processes reading for the group, and the memory of the item is reclaimed
+    once every joined group has read it.  The buffer is managed as it is for
+    shr_q_remove.
 
-    returns sh_status_e:
+    A struct of type sq_item_s is returned in all cases, with the status of the
+    call, a pointer to the data value being returned in the buffer, the length
+    of the data, the timestamp of when the item was added, and the buffer and
+    size of buffer to use in subsequent calls.
+
+    returns sq_item_s with status of:
 
     SH_OK           on success
-    SH_ERR_LIMIT    if queue size is at maximum depth
-    SH_ERR_ARG      if q is NULL, vector is NULL, or vcnt is < 1
-    SH_ERR_STATE    if q is immutable or read only
+    SH_ERR_EMPTY    if group has read every item on queue
+    SH_ERR_ARG      if q, buffer, or buff_size is NULL, or group is not 0 to 7
+    SH_ERR_STATE    if q is write only, group is not joined, or q corrupted
     SH_ERR_NOMEM    if not enough memory to satisfy request
+    SH_ERR_NOSUPPORT    if q is not a broadcast queue
 */
-extern sh_status_e shr_q_addv(
+extern sq_item_s shr_q_remove_group(
 
-    shr_q_s *q,         // pointer to queue struct -- not NULL
-    sq_vec_s *vector,   // pointer to vector of items -- not NULL
-    int vcnt            // count of vector array -- must be >= 1
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    int group,                  // consumer group -- 0 to 7
+    void **buffer,              // address of buffer pointer -- not NULL
+    size_t *buff_size           // pointer to size of buffer -- not NULL
 
 )   {
 
-    if ( q == NULL || vector == NULL || vcnt < 1 ) {
+    sq_item_s item = {0};
 
-        return SH_ERR_ARG;
+    if ( q == NULL || buffer == NULL || buff_size == NULL || group < 0 ||
+         group >= BCAST_GROUPS ) {
+
+        item.status = SH_ERR_ARG;
+        return item;
 
     }
 
-    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+    if ( !is_broadcast( q ) ) {
 
-        return SH_ERR_STATE;
+        item.status = SH_ERR_NOSUPPORT;
+        return item;
 
     }
 
-    guard_q_memory( q );
-
-    sh_status_e status = enq_gate_try( q );
-    if ( status ) {
+    if ( !( q->mode & SQ_READ_ONLY ) ) {
 
-        unguard_q_memory( q );
-        return status;
+        item.status = SH_ERR_STATE;
+        return item;
 
     }
 
-    if ( vcnt == 1 ) {
-
-        status = enq( q, vector[ 0 ].base, vector[ 0 ].len, vector[ 0 ].type );
+    long entry = GROUP_TABLE + ( group * LINE_SLOTS );
 
-    } else {
+    if ( !q->current->array[ entry + GROUP_ACTIVE ] ) {
 
-        status = enqv( q, vector, vcnt );
+        item.status = SH_ERR_STATE;
+        return item;
 
     }
 
-    if ( status ) {
-
-        enq_release_gate( q );
-        unguard_q_memory( q );
-        return status;
-
-    }
+    item = group_deq( q, entry, buffer, buff_size );
 
-    status = deq_release_gate( q );
-    if ( status ) {
+    if ( item.status == SH_OK ) {
 
-        unguard_q_memory( q );
-        return status;
+        reclaim_broadcast( q );
 
     }
 
-    check_for_level_event( q );
-
-    unguard_q_memory( q );
-    return status;
+    return item;
 }
 
 
 /*
-    shr_q_addv_wait -- attempt to add vector of items to queue
+    shr_q_lag -- returns count of items on broadcast queue not yet read by
+    consumer group, or -1 if it fails
 
-    Attempt to add a vector of items to shared queue, and block if at max depth
-    limit until depth limit allows.
-
-    returns sh_status_e:
+    Note:  count is exact when the queue is not being changed
 
-    SH_OK           on success
-    SH_ERR_ARG      if q is NULL, vector is NULL, or vcnt is < 1
-    SH_ERR_NOMEM    if not enough memory to satisfy request
 */
-extern sh_status_e shr_q_addv_wait(
+extern long shr_q_lag(
 
-    shr_q_s *q,         // pointer to queue struct -- not NULL
-    sq_vec_s *vector,   // pointer to vector of items -- not NULL
-    int vcnt            // count of vector array -- must be >= 1
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    int group                   // consumer group -- 0 to 7
 
 )   {
 
-    if ( q == NULL || vector == NULL || vcnt < 1 ) {
+    if ( q == NULL || group < 0 || group >= BCAST_GROUPS || !is_broadcast( q ) ) {
 
-        return SH_ERR_ARG;
+        return -1;
 
     }
 
-    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+    long *array = q->current->array;
+    long entry = GROUP_TABLE + ( group * LINE_SLOTS );
 
-        return SH_ERR_STATE;
+    if ( !array[ entry + GROUP_ACTIVE ] ) {
+
+        return -1;
 
     }
 
-    guard_q_memory( q );
+    // position of last item is position of front node plus items held
+    long seq = array[ entry + GROUP_SEQ ];
+    long lag = array[ HEAD_CNT ] - TAIL + count_items( array ) - seq;
 
-    sh_status_e status = enq_gate_blk( q );
-    if ( status ) {
+    return ( lag > 0 ) ? lag : 0;
+}
 
-        unguard_q_memory( q );
-        return status;
 
-    }
+/*
+    shr_q_select -- wait until any of several queues has an item
 
-    if ( vcnt == 1 ) {
+    Blocks until at least one of the queues has an item available to remove,
+    or until the timeout, if not NULL, expires.  The index of the lowest
+    numbered queue found with an item is returned in ready_index.  The item is
+    not removed, so a remove call that follows may still find the queue empty
+    if another process or thread removed the item first.  A single thread can
+    wait on up to 128 queues in place of a blocked thread for each queue.
 
-        status = enq( q, vector[ 0 ].base, vector[ 0 ].len, vector[ 0 ].type );
+    returns sh_status_e:
 
-    } else {
+    SH_OK           on success, ready_index set
+    SH_ERR_ARG      if qs, a queue pointer, or ready_index is NULL, or count
+                    is not from 1 to 128
+    SH_ERR_STATE    if a queue is write only
+    SH_ERR_EMPTY    if timeout expired with no items on any queue
+    SH_ERR_NOSUPPORT    if a queue is a broadcast queue
+*/
+extern sh_status_e shr_q_select(
 
-        status = enqv( q, vector, vcnt) ;
+    shr_q_s **qs,               // array of queue pointers -- not NULL
+    int count,                  // number of queues -- 1 to 128
+    struct timespec *timeout,   // timeout value, or NULL to wait indefinitely
+    int *ready_index            // index of queue with item -- not NULL
 
-    }
+)   {
 
-    if ( status ) {
+    if ( qs == NULL || ready_index == NULL || count < 1 || count > SELECT_MAX ) {
 
-        enq_release_gate( q );
-        unguard_q_memory( q );
-        return status;
+        return SH_ERR_ARG;
 
     }
 
-    status = deq_release_gate( q );
-    if ( status ) {
-
-        unguard_q_memory( q );
-        return status;
+    for ( int i = 0; i < count; i++ ) {
 
-    }
+        if ( qs[ i ] == NULL ) {
 
-    check_for_level_event( q );
+            return SH_ERR_ARG;
 
-    unguard_q_memory( q );
-    return status;
-}
+        }
 
+        if ( !( qs[ i ]->mode & SQ_READ_ONLY ) ) {
 
-/*
-    shr_q_addv_timedwait -- attempt to add vector of items to queue for
-                            specified period
+            return SH_ERR_STATE;
 
-    Attempt to add a vector of items to shared queue, and block if at max depth
-    limit until depth limit allows or timeout value reached.
+        }
 
-    returns sh_status_e:
+        if ( is_broadcast( qs[ i ] ) ) {
 
-    SH_OK           on success
-    SH_ERR_LIMIT    if queue size is at maximum depth
-    SH_ERR_ARG      if q is NULL, vector is NULL, vcnt is < 1, or timeout
-                    is NULL
-    SH_ERR_STATE    if q is immutable or read only or q corrupted
-    SH_ERR_NOMEM    if not enough memory to satisfy request
-*/
-extern sh_status_e shr_q_addv_timedwait(
+            return SH_ERR_NOSUPPORT;
 
-    shr_q_s *q,                 // pointer to queue struct -- not NULL
-    sq_vec_s *vector,           // pointer to vector of items -- not NULL
-    int vcnt,                   // count of vector array -- must be >= 1
-    struct timespec *timeout    // timeout value -- not NULL
+        }
+    }
 
-)   {
+    atomictype *gates[ SELECT_MAX ];
 
-    if ( q == NULL || vector == NULL || vcnt < 1 || timeout == NULL ) {
+    for ( int i = 0; i < count; i++ ) {
 
-        return SH_ERR_ARG;
+        gates[ i ] = &qs[ i ]->current->array[ DEQ_GATE ];
 
     }
 
-    if ( !( q->mode & SQ_WRITE_ONLY ) ) {
+    struct timespec ts;
+    if ( timeout != NULL ) {
 
-        return SH_ERR_STATE;
+        deadline_after( timeout, &ts );
 
     }
 
-    guard_q_memory( q );
+    int index = gate_select( gates, count, ( timeout == NULL ) ? NULL : &ts );
 
-    sh_status_e status = enq_gate_tm( q, timeout );
-    if ( status ) {
+    if ( index < 0 ) {
+
+        return SH_ERR_EMPTY;
+
+    }
+
+    *ready_index = index;
+    return SH_OK;
+}
 
-        unguard_q_memory( q );
-        return status;
 
-    }
+/*
+    shr_q_remove_batch -- remove up to max items from queue in a single call
 
-    if ( vcnt == 1 ) {
+    Non-blocking remove of as many items as are available from shared queue, up
+    to the specified maximum.  The items array is filled in order starting with
+    the first element, and the number of items removed is returned in count.
+    The buffer and buf_size of each element of the array are used in the same
+    way as the buffer and size arguments of shr_q_remove, so the array can be
+    reused across calls without reallocating buffers.  The array should be
+    zeroed before first use.
 
-        status = enq( q, vector[ 0 ].base, vector[ 0 ].len, vector[ 0 ].type );
+    returned sh_status_e:
 
-    } else {
+    SH_OK           on success, with at least one item removed
+    SH_ERR_EMPTY    if q is empty
+    SH_ERR_ARG      if q, items, or count is NULL, or max <= 0
+    SH_ERR_STATE    if q is immutable or write only
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+*/
+extern sh_status_e shr_q_remove_batch(
 
-        status = enqv( q, vector, vcnt );
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_item_s *items,   // array of items -- not NULL
+    int max,            // number of items in array -- greater than 0
+    int *count          // pointer to number of items removed -- not NULL
 
-    }
+)   {
 
-    if ( status != SH_OK ) {
+    if ( q == NULL || items == NULL || max <= 0 || count == NULL ) {
 
-        enq_release_gate( q );
-        unguard_q_memory( q );
-        return status;
+        return SH_ERR_ARG;
 
     }
 
-    status = deq_release_gate( q );
-    if ( status ) {
+    *count = 0;
 
-        unguard_q_memory( q );
-        return status;
+    if ( !( q->mode & SQ_READ_ONLY ) ) {
 
-    }
+        return SH_ERR_STATE;
 
-    check_for_level_event( q );
+    }
 
-    unguard_q_memory( q );
-    return status;
+    return remove_batch( q, items, max, count, NULL, false );
 }
 
 
 /*
-    shr_q_remove -- remove item from queue
-
-    Non-blocking remove of an item from shared queue.  If buffer is provided, it
-    will be validated as being large enough using the specified size, and will
-    contain the data upon return.  If buffer is not large enough, the memory
-    will be released using free and allocated with malloc to be the correct size
-    to hold the queued item data.  Upon resizing of buffer, the length will be
-    large enough to contain the returned data.  If buffer is not provided, a
-    buffer will be allocated that is at least large enough to contain the item
-    being removed and the length of buffer will be updated.
+    shr_q_remove_batch_wait -- remove up to max items from queue in a single
+    call, block if empty
 
-    A struct of type sq_item_s is returned in all cases, with the status of the
-    call, a pointer to the data value being returned in the buffer, the length
-    of the data being returned, and a pointer to timestamp in the buffer of when
-    the item was added to the queue.
+    Same as shr_q_remove_batch except that the call blocks until at least one
+    item is available.
 
     returned sh_status_e:
 
-    SH_OK           on success
-    SH_ERR_EMPTY    if q is empty
-    SH_ERR_ARG      if q is NULL, or buffer pointer not NULL and length <= 0
+    SH_OK           on success, with at least one item removed
+    SH_ERR_ARG      if q, items, or count is NULL, or max <= 0
     SH_ERR_STATE    if q is immutable or write only
     SH_ERR_NOMEM    if not enough memory to satisfy request
 */
-extern sq_item_s shr_q_remove(
+extern sh_status_e shr_q_remove_batch_wait(
 
-    shr_q_s *q,         // pointer to queue structure -- not NULL
-    void **buffer,      // address of buffer pointer -- not NULL
-    size_t *buff_size   // pointer to size of buffer -- not NULL
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_item_s *items,   // array of items -- not NULL
+    int max,            // number of items in array -- greater than 0
+    int *count          // pointer to number of items removed -- not NULL
 
 )   {
 
-    if ( q == NULL ||
-         buffer == NULL ||
-         buff_size == NULL ||
-         ( *buffer != NULL && *buff_size <= 0 ) ) {
+    if ( q == NULL || items == NULL || max <= 0 || count == NULL ) {
 
-        return (sq_item_s) { .status = SH_ERR_ARG };
+        return SH_ERR_ARG;
 
     }
 
+    *count = 0;
+
     if ( !( q->mode & SQ_READ_ONLY ) ) {
 
-        return (sq_item_s) { .status = SH_ERR_STATE };
+        return SH_ERR_STATE;
 
     }
 
-    sq_item_s item = { 0 };
+    return remove_batch( q, items, max, count, NULL, true );
+}
 
-    guard_q_memory( q );
 
-    while ( true ) {
+/*
+    shr_q_remove_batch_timedwait -- remove up to max items from queue in a
+    single call, block if empty for specified amount of time
 
-        item.status = deq_gate_try( q );
-        if ( item.status ) {
+    Same as shr_q_remove_batch except that the call blocks until at least one
+    item is available, but only for time period specified by timeout value.
 
-            break;
+    returned sh_status_e:
 
-        }
+    SH_OK           on success, with at least one item removed
+    SH_ERR_EMPTY    if q is empty
+    SH_ERR_ARG      if q, items, count, or timeout is NULL, or max <= 0
+    SH_ERR_STATE    if q is immutable or write only
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+*/
+extern sh_status_e shr_q_remove_batch_timedwait(
 
-        item = deq( q, buffer, buff_size );
-        if ( item.status != SH_ERR_EXIST ) {
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    sq_item_s *items,           // array of items -- not NULL
+    int max,                    // number of items in array -- greater than 0
+    int *count,                 // pointer to number of items removed -- not NULL
+    struct timespec *timeout    // timeout value -- not NULL
 
-            if ( item.status ) {
+)   {
 
-                deq_release_gate( q );
+    if ( q == NULL ||
+         items == NULL ||
+         max <= 0 ||
+         count == NULL ||
+         timeout == NULL ) {
 
-            } else {
+        return SH_ERR_ARG;
 
-                item.status = enq_release_gate( q );
+    }
 
-            }
+    *count = 0;
 
-            break;
+    if ( !( q->mode & SQ_READ_ONLY ) ) {
 
-        }
+        return SH_ERR_STATE;
 
-        enq_release_gate( q );
-    
     }
 
-    unguard_q_memory( q );
-    return item;
+    return remove_batch( q, items, max, count, timeout, true );
 }
 
 
 /*
-    shr_q_remove_wait -- attempt to remove item from queue, block if empty
-
-    Remove an item from shared queue and block if queue is empty.  If
-    buffer is provided, it will be validated as being large enough using
-    the specified size, and will contain the data upon return.  If buffer is not
-    large enough, the memory will be released using free and allocated with
-    malloc to be the correct size to hold the queued item data.  Upon resizing
-    of buffer, the length will large enough to contain the returned data.  If
-    buffer is not provided, a buffer will be allocated that is large enough to
-    contain the data being removed and the length of buffer will be updated.
+    shr_q_remove_borrow -- remove item from queue without copying the data
 
-    A struct of type sq_item_s is returned in all cases, with the status of the
-    call, a pointer to the data value being returned in the buffer, the length
-    of the data being returned, and a pointer to timestamp in the buffer of when
-    the item was added to the queue.
+    Non-blocking remove of an item from shared queue that leaves the item data
+    in place in the shared memory.  The value and timestamp of the returned
+    item point directly into the mapped queue memory, and buffer identifies the
+    borrowed memory.  The vector array is not populated for a borrowed item, if
+    the item was added as a vector then value points at the packed vector
+    entries.  The memory remains valid until the item is handed back to the
+    queue using shr_q_release, which must be called for every successfully
+    borrowed item.
 
     returned sh_status_e:
 
     SH_OK           on success
     SH_ERR_EMPTY    if q is empty
-    SH_ERR_ARG      if q is NULL, or buffer pointer not NULL and length <= 0
+    SH_ERR_ARG      if q is NULL
     SH_ERR_STATE    if q is immutable or write only
-    SH_ERR_NOMEM    if not enough memory to satisfy request
+    SH_ERR_NOSUPPORT    if q is a ring buffer or fixed item size queue
 */
-extern sq_item_s shr_q_remove_wait(
+extern sq_item_s shr_q_remove_borrow(
 
-    shr_q_s *q,             // pointer to queue struct -- not NULL
-    void **buffer,          // address of buffer pointer -- not NULL
+    shr_q_s *q          // pointer to queue struct -- not NULL
 
-    size_t *buff_size       // pointer to size of buffer -- not NULL
 )   {
 
-    if ( q == NULL ||
-         buffer == NULL ||
-         buff_size == NULL ||
-         ( *buffer != NULL && *buff_size <= 0 ) ) {
+    if ( q == NULL ) {
 
         return (sq_item_s) { .status = SH_ERR_ARG };
 
@@ -2643,86 +7231,68 @@ extern sq_item_s shr_q_remove_wait(
 
     }
 
-    sq_item_s item = { 0 };
-
-    guard_q_memory( q );
+    return remove_borrowed( q, NULL, false );
+}
 
-    while ( true ) {
 
-        item.status = deq_gate_blk( q );
-        if ( item.status ) {
+/*
+    shr_q_remove_borrow_wait -- remove item from queue without copying the
+    data, block if empty
 
-            break;
+    Same as shr_q_remove_borrow except that the call blocks if queue is empty.
 
-        }
+    returned sh_status_e:
 
-        item = deq( q, buffer, buff_size );
-        if ( item.status != SH_ERR_EXIST ) {
+    SH_OK           on success
+    SH_ERR_ARG      if q is NULL
+    SH_ERR_STATE    if q is immutable or write only
+    SH_ERR_NOSUPPORT    if q is a ring buffer or fixed item size queue
+*/
+extern sq_item_s shr_q_remove_borrow_wait(
 
-            if ( item.status ) {
+    shr_q_s *q          // pointer to queue struct -- not NULL
 
-                deq_release_gate( q );
+)   {
 
-            } else {
+    if ( q == NULL ) {
 
-                item.status = enq_release_gate( q );
+        return (sq_item_s) { .status = SH_ERR_ARG };
 
-            }
+    }
 
-            break;
+    if ( !( q->mode & SQ_READ_ONLY ) ) {
 
-        }
+        return (sq_item_s) { .status = SH_ERR_STATE };
 
-        enq_release_gate( q );
-    
     }
 
-    unguard_q_memory( q );
-    return item;
+    return remove_borrowed( q, NULL, true );
 }
 
 
 /*
-    shr_q_remove_timedwait -- attempt to remove item from queue for specified
-    amount of time
-
-    Remove an item from shared queue that blocks if queue is empty, but only
-    for time period specfied by timeout value.  If buffer is provided, it will
-    be validated as being large enough using the specified size, and will
-    contain the data upon return.  If buffer is not large enough, the memory
-    will be released using free and allocated with malloc to be the correct size
-    to hold the queued item data.  Upon resizing of buffer, the length will
-    large enough to contain the returned data.  If buffer is not provided, a
-    buffer will be allocated that is large enough to contain the data being
-    removed and the length of buffer will be updated.
+    shr_q_remove_borrow_timedwait -- remove item from queue without copying the
+    data, block if empty for specified amount of time
 
-    A struct of type sq_item_s is returned in all cases, with the status of the
-    call, a pointer to the data value being returned in the buffer, the length
-    of the data being returned, and a pointer to timestamp in the buffer of when
-    the item was added to the queue.
+    Same as shr_q_remove_borrow except that the call blocks if queue is empty,
+    but only for time period specified by timeout value.
 
-    returns sh_status_e:
+    returned sh_status_e:
 
     SH_OK           on success
     SH_ERR_EMPTY    if q is empty
-    SH_ERR_ARG      if q is NULL, or buffer pointer not NULL and length <= 0
+    SH_ERR_ARG      if q is NULL or timeout is NULL
     SH_ERR_STATE    if q is immutable or write only
-    SH_ERR_NOMEM    if not enough memory to satisfy request
+    SH_ERR_NOSUPPORT    if q is a ring buffer or fixed item size queue
 */
-extern sq_item_s shr_q_remove_timedwait(
+extern sq_item_s shr_q_remove_borrow_timedwait(
 
     shr_q_s *q,                 // pointer to queue struct -- not NULL
-    void **buffer,              // address of buffer pointer -- not NULL
-    size_t *buff_size,          // pointer to size of buffer -- not NULL
     struct timespec *timeout    // timeout value -- not NULL
 
 )   {
 
-    if ( q == NULL ||
-         buffer == NULL ||
-         buff_size == NULL ||
-         ( *buffer != NULL && *buff_size <= 0 ) ||
-         timeout == NULL ) {
+    if ( q == NULL || timeout == NULL ) {
 
         return (sq_item_s) { .status = SH_ERR_ARG };
 
@@ -2734,42 +7304,58 @@ extern sq_item_s shr_q_remove_timedwait(
 
     }
 
-    sq_item_s item = { 0 };
+    return remove_borrowed( q, timeout, true );
+}
 
-    guard_q_memory( q );
 
-    while ( true ) {
+/*
+    shr_q_release -- release item borrowed from queue
 
-        item.status = deq_gate_tm( q, timeout );
-        if ( item.status ) {
+    Frees the shared memory holding the data of an item returned by one of the
+    shr_q_remove_borrow calls.  On success, the item is cleared and its
+    pointers are no longer valid.
 
-            break;
+    returned sh_status_e:
 
-        }
+    SH_OK           on success
+    SH_ERR_ARG      if q is NULL, item is NULL, or item is not borrowed from q
+*/
+extern sh_status_e shr_q_release(
 
-        item = deq( q, buffer, buff_size );
-        if ( item.status != SH_ERR_EXIST ) {
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    sq_item_s *item     // pointer to borrowed item -- not NULL
 
-            if ( item.status ) {
+)   {
 
-                deq_release_gate( q );
+    if ( q == NULL || item == NULL || item->buffer == NULL ) {
 
-            } else {
+        return SH_ERR_ARG;
 
-                item.status = enq_release_gate( q );
+    }
 
-            }
+    // borrowed memory must lie within a mapping of shared memory object
+    long *data = item->buffer;
+    extent_s *extent = q->current;
 
-            break;
+    while ( extent != NULL && ( data < extent->array + HDR_END ||
+            data >= extent->array + ( extent->size >> SZ_SHIFT ) ) ) {
 
-        }
+        extent = extent->prev;
 
-        enq_release_gate( q );
+    }
+
+    long *array = ( extent != NULL ) ? extent->array : NULL;
+
+    if ( array == NULL || data >= array + array[ SIZE ] ) {
+
+        return SH_ERR_ARG;
 
     }
 
-    unguard_q_memory( q );
-    return item;
+    sh_status_e status = free_data_slots( (shr_base_s*) q, data - array );
+    memset( item, 0, sizeof(sq_item_s) );
+
+    return status;
 }
 
 
@@ -2777,6 +7363,10 @@ extern sq_item_s shr_q_remove_timedwait(
     shr_q_event -- returns active event or SQ_EVNT_NONE when either empty or
     error condition
 
+    Note:  re-arms event signal of a monitor registered with q, events that
+    arrive while it is still signalled are only seen by calling until
+    SQ_EVNT_NONE is returned
+
 */
 extern sq_event_e shr_q_event(
 
@@ -2790,19 +7380,24 @@ extern sq_event_e shr_q_event(
 
     }
 
-    guard_q_memory( q );
-
     extent_s *extent = q->current;
     long *array = extent->array;
     sq_event_e event = SQ_EVNT_NONE;
+    long obs = observed_gen( q, SUB_MONITOR );
 
-    if ( sem_trywait( (sem_t*) &array[ EVNT_SEM ] ) < 0 ) {
+    while ( gate_try( &array[ EVNT_GATE ], 1, 1 ) == 0 ) {
 
-        unguard_q_memory( q );
-        return event;
+        if ( observe( q, SUB_MONITOR, obs ) ) {
+
+            return event;
+
+        }
 
+        obs = observed_gen( q, SUB_MONITOR );
     }
 
+    sync_extent( (shr_base_s*) q );
+    array = q->current->array;
     long gen = array[ EVENT_HD_CNT ];
     long head = array[ EVENT_HEAD ];
 
@@ -2813,7 +7408,7 @@ extern sq_event_e shr_q_event(
         if ( remove_front( (shr_base_s*) q, head, gen, EVENT_HEAD, EVENT_TAIL ) != 0 ) {
 
             // free queue node
-            add_end( (shr_base_s*) q, head, FREE_TAIL );
+            free_node( q, head );
             break;
 
         }
@@ -2823,9 +7418,8 @@ extern sq_event_e shr_q_event(
         event = SQ_EVNT_NONE;
     }
 
-    release_prev_extents( (shr_base_s*) q );
+    (void) observe( q, SUB_MONITOR, obs );
 
-    unguard_q_memory( q );
     return event;
 }
 
@@ -2847,27 +7441,21 @@ extern sq_event_e shr_q_event_timedwait(
 
     }
 
-    guard_q_memory( q );
-
     extent_s *extent = q->current;
     long *array = extent->array;
     sq_event_e event = SQ_EVNT_NONE;
 
     struct timespec ts;
-    clock_gettime( CLOCK_REALTIME, &ts );
-    timespecadd( &ts, timeout, &ts );
-
-    while ( sem_timedwait( (sem_t*) &q->current->array[ EVNT_SEM ], &ts ) < 0 ) {
-
-        if ( errno == ETIMEDOUT || errno == EINVAL ) {
+    deadline_after( timeout, &ts );
 
-            unguard_q_memory( q );
-            return event;
+    if ( !gate_wait( &array[ EVNT_GATE ], &ts ) ) {
 
-        }
+        return event;
 
     }
 
+    sync_extent( (shr_base_s*) q );
+    array = q->current->array;
 
     long gen = array[ EVENT_HD_CNT ];
     long head = array[ EVENT_HEAD ];
@@ -2880,7 +7468,7 @@ extern sq_event_e shr_q_event_timedwait(
              != 0 ) {
 
             // free queue node
-            add_end( (shr_base_s*) q, head, FREE_TAIL );
+            free_node( q, head );
             break;
 
         }
@@ -2890,9 +7478,6 @@ extern sq_event_e shr_q_event_timedwait(
         event = SQ_EVNT_NONE;
     }
 
-    release_prev_extents( (shr_base_s*) q );
-
-    unguard_q_memory( q );
     return event;
 }
 
@@ -2926,57 +7511,90 @@ extern bool shr_q_exceeds_idle_time(
 
 )   {
 
-    if ( q == NULL ) {
+    if ( q == NULL || is_lean( q ) ) {
 
         return false;
 
     }
 
-    guard_q_memory( q );
-
     extent_s *extent = q->current;
     long *array = extent->array;
     struct timespec curr_time;
-    (void) clock_gettime( CLOCK_REALTIME, &curr_time );
+    queue_time( q, &curr_time );
 
     if ( curr_time.tv_sec - array[ TS_SEC ] > lim_secs ) {
 
-        unguard_q_memory( q );
         return true;
 
     }
 
     if ( curr_time.tv_sec - array[ TS_SEC ] < lim_secs ) {
 
-        unguard_q_memory( q );
         return false;
 
     }
 
     if ( curr_time.tv_nsec - array[ TS_NSEC ] > lim_nsecs ) {
 
-        unguard_q_memory( q );
         return true;
 
     }
 
     if ( curr_time.tv_nsec - array[ TS_NSEC ] < lim_nsecs ) {
 
-        unguard_q_memory( q );
         return false;
 
     }
 
-    unguard_q_memory( q );
     return true;
 }
 
 
 /*
-    shr_q_count -- returns count of items on queue, or -1 if it fails
+    shr_q_count -- returns count of items on queue, or -1 if it fails
+
+    Note:  count is the sum of the count stripes, so it is exact when the queue
+    is not being changed, otherwise it can include adds and removes that are
+    still in progress, also re-arms arrival signal of a listener registered
+    with q
+
+*/
+extern long shr_q_count(
+
+    shr_q_s *q                  // pointer to queue struct -- not NULL
+
+)   {
+
+    if ( q == NULL ) {
+
+        return -1;
+
+    }
+
+    long result = -1;
+    long gen;
+
+    do {
+
+        gen = observed_gen( q, SUB_LISTEN );
+        result = count_items( q->current->array );
+
+    } while ( !observe( q, SUB_LISTEN, gen ) );
+
+    return result;
+}
+
+
+/*
+    shr_q_count_approx -- returns approximate count of items on queue, or -1 if
+    it fails
+
+    Note:  count is read from a single shared word and does not reflect adds
+    and removes that are in progress, which makes it cheaper than shr_q_count
+    when polled frequently
 
 */
-extern long shr_q_count(
+extern long shr_q_count_approx(
 
     shr_q_s *q                  // pointer to queue struct -- not NULL
 
@@ -2988,12 +7606,8 @@ extern long shr_q_count(
 
     }
 
-    guard_q_memory( q );
+    long result = count_approx( q->current->array );
 
-    long result = -1;
-    result = q->current->array[ COUNT ];
-
-    unguard_q_memory( q );
     return result;
 }
 
@@ -3014,12 +7628,9 @@ extern size_t shr_q_buffer(
 
     }
 
-    guard_q_memory( q );
-
     long result = -1;
     result = q->current->array[ BUFFER ];
 
-    unguard_q_memory( q );
     return result;
 }
 
@@ -3032,6 +7643,7 @@ extern size_t shr_q_buffer(
 
     SH_OK           on success
     SH_ERR_ARG      if q is NULL, or level not greater than 0
+    SH_ERR_NOSUPPORT    if q is a lean queue
 
 */
 extern sh_status_e shr_q_level(
@@ -3047,7 +7659,11 @@ extern sh_status_e shr_q_level(
 
     }
 
-    guard_q_memory( q );
+    if ( is_lean( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
 
     extent_s *extent = q->current;
     long *array = extent->array;
@@ -3055,7 +7671,6 @@ extern sh_status_e shr_q_level(
 
     CAS( &array[ LEVEL ], &prev, level );
 
-    unguard_q_memory( q );
     return SH_OK;
 }
 
@@ -3068,6 +7683,7 @@ extern sh_status_e shr_q_level(
 
     SH_OK           on success
     SH_ERR_ARG      if q is NULL
+    SH_ERR_NOSUPPORT    if q is a lean queue
 
 */
 extern sh_status_e shr_q_timelimit(
@@ -3084,7 +7700,11 @@ extern sh_status_e shr_q_timelimit(
 
     }
 
-    guard_q_memory( q );
+    if ( is_lean( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
 
     long *array = q->current->array;
     struct timespec prev;
@@ -3099,7 +7719,6 @@ extern sh_status_e shr_q_timelimit(
 
     } while ( !DWCAS( (DWORD*) &array[ LIMIT_SEC ], (DWORD*) &prev, next ) );
 
-    unguard_q_memory( q );
     return SH_OK;
 }
 
@@ -3114,6 +7733,7 @@ extern sh_status_e shr_q_timelimit(
     SH_ERR_ARG      if q or timespec is NULL
     SH_ERR_STATE    if q is immutable or write only, or not a valid queue
     SH_ERR_NOMEM    if not enough memory to satisfy request
+    SH_ERR_NOSUPPORT    if q is a lean or broadcast queue
 
 */
 extern sh_status_e shr_q_clean(
@@ -3129,6 +7749,12 @@ extern sh_status_e shr_q_clean(
 
     }
 
+    if ( is_lean( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
+
     if ( !( q->mode & SQ_READ_ONLY ) ) {
 
         return SH_ERR_STATE;
@@ -3137,8 +7763,7 @@ extern sh_status_e shr_q_clean(
 
     sh_status_e status;
     struct timespec curr_time;
-
-    guard_q_memory( q );
+    long lane = 0;
 
     while( true ) {
 
@@ -3152,69 +7777,60 @@ extern sh_status_e shr_q_clean(
 
             }
 
-            unguard_q_memory( q );
             return status;
         }
 
         long *array = q->current->array;
-        long gen = array[ HEAD_CNT ];
-        long head = array[ HEAD ];
 
-        if ( head == array[ TAIL ] ) {
+        if ( is_ring( q ) ) {
 
-            break;
+            long data_slot = ring_next( q );
+            queue_time( q, &curr_time );
 
-        }
+            if ( data_slot == 0 ||
+                 !item_exceeds_limit( q, data_slot, timelimit, &curr_time ) ) {
 
-        view_s view = insure_in_range( (shr_base_s*) q, head );
-        array = view.extent->array;
-        long data_slot = next_item( q, head );
+                break;
 
-        if ( data_slot == 0 ) {
+            }
 
-            break;
+            count_add( array, -1 );
+            ring_release( q, data_slot );
 
-        }
+            status = enq_release_gate( q );
+            if ( status ) {
 
-        // insure data is accessible
-        view = insure_in_range( (shr_base_s*) q, data_slot );
-        if ( view.slot == 0 ) {
+                return status;
 
-            break;
+            }
 
+            continue;
         }
 
-        clock_gettime( CLOCK_REALTIME, &curr_time );
+        // move on to next lane once front of current lane has not expired
+        while ( lane < q->lanes && !clean_front( q, lane, timelimit ) ) {
 
-        if ( !item_exceeds_limit( q, data_slot, timelimit, &curr_time ) ) {
-
-            break;
+            lane++;
 
         }
 
-        if ( remove_front( (shr_base_s*) q, head, gen, HEAD, TAIL ) == 0 ) {
+        if ( lane == q->lanes ) {
 
             break;
 
         }
 
-        (void) AFS( &array[COUNT], 1 );
-
-        // free queue node
-        add_end( (shr_base_s*) q, head, FREE_TAIL );
-        free_data_slots( (shr_base_s*) q, data_slot );
+        count_add( q->current->array, -1 );
 
         status = enq_release_gate( q );
         if ( status ) {
 
-            unguard_q_memory( q );
             return status;
 
         }
     }
 
     status = deq_release_gate( q );
-    unguard_q_memory( q );
     return status;
 }
 
@@ -3229,6 +7845,7 @@ shr_q_last_empty  -- returns timestamp of last time queue became non-empty
     SH_OK           on success
     SH_ERR_ARG      if q or timestamp is NULL
     SH_ERR_EMPTY    if q is currently empty, timestamp not updated
+    SH_ERR_NOSUPPORT    if q is a lean queue
 
 */
 extern sh_status_e shr_q_last_empty(
@@ -3244,17 +7861,20 @@ extern sh_status_e shr_q_last_empty(
 
     }
 
-    guard_q_memory( q );
+    if ( is_lean( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
 
-    if ( q->current->array[COUNT] == 0 ) {
+    if ( count_approx( q->current->array ) == 0 ) {
 
-        unguard_q_memory( q );
         return SH_ERR_EMPTY;
 
     }
 
     *timestamp = *(struct timespec *) &q->current->array[ EMPTY_SEC ];
-    unguard_q_memory( q );
+    wall_time( q, timestamp );
     return SH_OK;
 }
 
@@ -3268,6 +7888,7 @@ extern sh_status_e shr_q_last_empty(
 
     SH_OK           on success
     SH_ERR_ARG      if q is NULL
+    SH_ERR_NOSUPPORT    if discarding and q is a lean or broadcast queue
 
 */
 extern sh_status_e shr_q_discard(
@@ -3283,7 +7904,11 @@ extern sh_status_e shr_q_discard(
 
     }
 
-    guard_q_memory( q );
+    if ( flag && ( is_lean( q ) || is_broadcast( q ) ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
 
     if (flag) {
 
@@ -3295,7 +7920,6 @@ extern sh_status_e shr_q_discard(
 
     }
 
-    unguard_q_memory( q );
     return SH_OK;
 }
 
@@ -3317,11 +7941,8 @@ extern bool shr_q_will_discard(
 
     }
 
-    guard_q_memory( q );
-
     bool result = is_discard_on_expire( q->current->array );
 
-    unguard_q_memory( q );
     return result;
 }
 
@@ -3337,6 +7958,8 @@ extern bool shr_q_will_discard(
 
     SH_OK           on success
     SH_ERR_ARG      if q is NULL
+    SH_ERR_NOSUPPORT    if q is a ring buffer, lean, priority lane, or
+                        broadcast queue
 
 */
 extern sh_status_e shr_q_limit_lifo(
@@ -3352,7 +7975,12 @@ extern sh_status_e shr_q_limit_lifo(
 
     }
 
-    guard_q_memory( q );
+    if ( flag && ( is_ring( q ) || is_lean( q ) || q->lanes > 1 ||
+                   is_broadcast( q ) ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
 
     if ( flag ) {
 
@@ -3364,7 +7992,6 @@ extern sh_status_e shr_q_limit_lifo(
 
     }
 
-    unguard_q_memory( q );
     return SH_OK;
 }
 
@@ -3386,11 +8013,80 @@ extern bool shr_q_will_lifo(
 
     }
 
-    guard_q_memory( q );
-
     bool result = is_adaptive_lifo( q->current->array );
 
-    unguard_q_memory( q );
+    return result;
+}
+
+
+/*
+    shr_q_coalesce -- coalesce signals to monitors, listeners, and callers
+
+    When on, a subscribed process that has been signalled is not signalled
+    again until it has observed the queue with the same queue struct, using
+    shr_q_event for monitors, shr_q_count for listeners, or shr_q_call_count
+    for callers, so a burst of notifications costs it a single signal.  When
+    off, the default, every notification is signalled.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_ARG      if q is NULL
+    SH_ERR_NOSUPPORT    if q is a lean queue
+
+*/
+extern sh_status_e shr_q_coalesce(
+
+    shr_q_s *q,                 // pointer to queue struct -- not NULL
+    bool flag                   // true will turn on signal coalescing
+
+)   {
+
+    if ( q == NULL ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( flag && is_lean( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
+
+    if ( flag ) {
+
+        set_flag( q->current->array, FLAG_COALESCE );
+
+    } else {
+
+        clear_flag( q->current->array, FLAG_COALESCE );
+
+    }
+
+    return SH_OK;
+}
+
+
+/*
+    shr_q_will_coalesce -- tests to see if queue will coalesce signals
+
+    returns true if queue will coalesce signals, otherwise false
+*/
+extern bool shr_q_will_coalesce(
+
+    shr_q_s *q                  // pointer to queue struct -- not NULL
+
+)   {
+
+    if ( q == NULL ) {
+
+        return false;
+
+    }
+
+    bool result = ( q->current->array[ FLAGS ] & FLAG_COALESCE ) != 0;
+
     return result;
 }
 
@@ -3405,6 +8101,7 @@ extern bool shr_q_will_lifo(
 
     SH_OK           on success
     SH_ERR_ARG      if q is NULL
+    SH_ERR_NOSUPPORT    if q is a lean queue
 
 */
 extern sh_status_e shr_q_subscribe(
@@ -3420,8 +8117,13 @@ extern sh_status_e shr_q_subscribe(
 
     }
 
+    if ( is_lean( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
+
     long flag = get_event_flag( event );
-    guard_q_memory( q );
 
     if ( flag ) {
 
@@ -3429,7 +8131,6 @@ extern sh_status_e shr_q_subscribe(
 
     }
 
-    unguard_q_memory( q );
     return SH_OK;
 }
 
@@ -3460,14 +8161,12 @@ extern sh_status_e shr_q_unsubscribe(
     }
 
     long flag = get_event_flag( event );
-    guard_q_memory( q );
 
     if ( flag ) {
 
         clear_flag( q->current->array, flag );
     }
 
-    unguard_q_memory( q );
     return SH_OK;
 }
 
@@ -3490,11 +8189,8 @@ extern bool shr_q_is_subscribed(
 
     }
 
-    guard_q_memory( q );
-
     bool result = !event_disabled( q->current->array, event );
 
-    unguard_q_memory( q );
     return result;
 }
 
@@ -3521,19 +8217,8 @@ extern sh_status_e shr_q_prod(
 
     }
 
-    guard_q_memory( q );
-
-    while ( sem_post( (sem_t*) &q->current->array[ DEQ_SEM ] ) < 0 ) {
-
-        if ( errno == EINVAL ) {
-
-            unguard_q_memory( q );
-            return SH_ERR_STATE;
-
-        }
-    }
+    gate_post( &q->current->array[ DEQ_GATE ], 1 );
 
-    unguard_q_memory( q );
     return SH_OK;
 }
 
@@ -3541,6 +8226,8 @@ extern sh_status_e shr_q_prod(
 /*
     shr_q_call_count -- returns count of blocked remove calls, or -1 if it fails
 
+    Note:  also re-arms call signal of a caller registered with q
+
 */
 extern long shr_q_call_count(
 
@@ -3554,12 +8241,17 @@ extern long shr_q_call_count(
 
     }
 
-    guard_q_memory( q );
+    long result;
+    long gen;
+
+    do {
+
+        gen = observed_gen( q, SUB_CALL );
+        long unblocks = q->current->array[ CALL_UNBLOCKS ];
+        result = q->current->array[ CALL_BLOCKS]  - unblocks;
 
-    long unblocks = q->current->array[ CALL_UNBLOCKS ];
-    long result = q->current->array[ CALL_BLOCKS]  - unblocks;
+    } while ( !observe( q, SUB_CALL, gen ) );
 
-    unguard_q_memory( q );
     return result;
 }
 
@@ -3573,6 +8265,7 @@ extern long shr_q_call_count(
 
     SH_OK           on success
     SH_ERR_ARG      if q is NULL
+    SH_ERR_NOSUPPORT    if q is a lean queue
 
 */
 extern sh_status_e shr_q_target_delay(
@@ -3589,7 +8282,11 @@ extern sh_status_e shr_q_target_delay(
 
     }
 
-    guard_q_memory( q );
+    if ( is_lean( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
 
     long *array = q->current->array;
     struct timespec prev;
@@ -3604,11 +8301,237 @@ extern sh_status_e shr_q_target_delay(
 
     } while ( !DWCAS( (DWORD*) &array[ TARGET_SEC ], (DWORD*) &prev, next ) );
 
-    unguard_q_memory( q );
     return shr_q_discard( q, true );
 }
 
 
+/*
+    shr_q_compact -- release memory of queue that is not in use
+
+    Returns the backing memory of freed item data allocations that span whole
+    pages, or whole huge pages for a queue backed by huge pages, to the
+    system while the queue stays online.  The allocations stay on the free
+    memory lists and are reused by later adds, faulting their pages back in.
+    The size of the queue and the addresses of its items do not change.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_ARG      if q is NULL
+*/
+extern sh_status_e shr_q_compact(
+
+    shr_q_s *q          // pointer to queue struct -- not NULL
+
+)   {
+
+    if ( q == NULL ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    (void) release_free_data( (shr_base_s*) q );
+
+    return SH_OK;
+}
+
+
+/*
+    shr_q_snapshot -- write items on queue to file descriptor
+
+    Writes the create time attributes of the queue followed by every item on
+    the queue, in the order items are removed from each lane, to fd in large
+    sequential writes.  Each item keeps its type, timestamp, unique id, and
+    vector layout, and is written as its lane, data header, and data.  The
+    snapshot does not remove items, and can be read by shr_q_restore to load
+    the items into a new queue, such as one on another host.
+
+    Items added after the snapshot starts are not included.  Items removed
+    while the snapshot is taken may or may not be included.  Items held on the
+    adaptive LIFO stack follow the items of the lanes.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_ARG      if q is NULL or fd is less than 0
+    SH_ERR_STATE    if q corrupted
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+    SH_ERR_SYS      if write to fd fails, or other status from errno
+    SH_ERR_NOSUPPORT    if q is a ring buffer or broadcast queue
+*/
+extern sh_status_e shr_q_snapshot(
+
+    shr_q_s *q,         // pointer to queue struct -- not NULL
+    int fd              // file descriptor open for writing
+
+)   {
+
+    if ( q == NULL || fd < 0 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    if ( is_ring( q ) || is_broadcast( q ) ) {
+
+        return SH_ERR_NOSUPPORT;
+
+    }
+
+    snap_io_s io = { .fd = fd, .size = SNAP_BUFFER };
+    io.buf = malloc( io.size );
+
+    if ( io.buf == NULL ) {
+
+        return SH_ERR_NOMEM;
+
+    }
+
+    sync_extent( (shr_base_s*) q );
+    long *array = q->current->array;
+    long *hdr = (long*) io.buf;
+    memset( hdr, 0, SNAP_HDR << SZ_SHIFT );
+    memcpy( &hdr[ SNAP_TAG ], SHRQ, sizeof(SHRQ) - 1 );
+    hdr[ SNAP_VERSION ] = SNAP_FORMAT;
+    hdr[ SNAP_DEPTH ] = array[ MAX_DEPTH ];
+    hdr[ SNAP_FLAGS ] = array[ ATTR_FLAGS ];
+    hdr[ SNAP_ITEM_SIZE ] = array[ ITEM_SIZE ];
+    hdr[ SNAP_LANES ] = q->lanes;
+    hdr[ SNAP_CLOCK ] = array[ CLOCK ];
+    io.pos = SNAP_HDR << SZ_SHIFT;
+
+    long count = 0;
+    sh_status_e status = SH_OK;
+
+    for ( long lane = q->lanes - 1; lane >= 0 && status == SH_OK; lane-- ) {
+
+        status = snap_lane( q, &io, lane, &count );
+
+    }
+
+    if ( status == SH_OK ) {
+
+        status = snap_stack( q, &io, &count );
+
+    }
+
+    if ( status == SH_OK ) {
+
+        status = snap_room( &io, 2 << SZ_SHIFT );
+
+    }
+
+    if ( status == SH_OK ) {
+
+        long *trailer = (long*) ( io.buf + io.pos );
+        trailer[ 0 ] = SNAP_END;
+        trailer[ 1 ] = count;
+        io.pos += 2 << SZ_SHIFT;
+        status = snap_flush( &io );
+
+    }
+
+    free( io.buf );
+    return status;
+}
+
+
+/*
+    shr_q_restore -- create queue using name from snapshot read from file
+    descriptor
+
+    Creates a queue with the max depth and create time attributes recorded in
+    a snapshot written by shr_q_snapshot, and adds the items of the snapshot to
+    it in their original order, lane, type, timestamp, and unique id.  The
+    snapshot is read with large sequential reads, and items are allocated and
+    linked onto the queue a chunk at a time, so the gates and count are only
+    adjusted once per chunk.  If the restore fails, the created queue is
+    destroyed.
+
+    returns sh_status_e:
+
+    SH_OK           on success
+    SH_ERR_ARG      if name is NULL or fd is less than 0, or the snapshot
+                    attributes or an item record are not valid
+    SH_ERR_ACCESS   on permissions error for queue name
+    SH_ERR_EXIST    if queue already exists
+    SH_ERR_LIMIT    if snapshot holds more items than max depth of queue
+    SH_ERR_STATE    if fd is not a complete snapshot
+    SH_ERR_NOMEM    if not enough memory to satisfy request
+    SH_ERR_PATH     if error in queue name
+    SH_ERR_SYS      if read from fd fails, or other status from errno
+*/
+extern sh_status_e shr_q_restore(
+
+    char const * const name,// name of q as a null terminated string -- not NULL
+    int fd                  // file descriptor open for reading
+
+)   {
+
+    if ( name == NULL || fd < 0 ) {
+
+        return SH_ERR_ARG;
+
+    }
+
+    snap_io_s io = { .fd = fd, .size = SNAP_BUFFER };
+    io.buf = malloc( io.size );
+    long *nodes = malloc( SNAP_CHUNK * sizeof(long) );
+
+    if ( io.buf == NULL || nodes == NULL ) {
+
+        free( io.buf );
+        free( nodes );
+        return SH_ERR_NOMEM;
+
+    }
+
+    long hdr[ SNAP_HDR ];
+    sh_status_e status = snap_read( &io, hdr, sizeof(hdr) );
+
+    if ( status == SH_OK &&
+         ( memcmp( &hdr[ SNAP_TAG ], SHRQ, sizeof(SHRQ) - 1 ) != 0 ||
+           hdr[ SNAP_VERSION ] != SNAP_FORMAT ||
+           hdr[ SNAP_DEPTH ] <= 0 || hdr[ SNAP_DEPTH ] > SEM_VALUE_MAX ) ) {
+
+        status = SH_ERR_STATE;
+
+    }
+
+    shr_q_s *q = NULL;
+
+    if ( status == SH_OK ) {
+
+        sq_attr_s attr = { .flags = hdr[ SNAP_FLAGS ],
+                           .item_size = hdr[ SNAP_ITEM_SIZE ],
+                           .clock = hdr[ SNAP_CLOCK ],
+                           .lanes = hdr[ SNAP_LANES ] };
+        status = shr_q_create_ex( &q, name, hdr[ SNAP_DEPTH ], SQ_READWRITE, &attr );
+
+    }
+
+    if ( status == SH_OK ) {
+
+        status = restore_items( q, &io, nodes );
+
+        if ( status ) {
+
+            (void) shr_q_destroy( &q );
+
+        } else {
+
+            status = shr_q_close( &q );
+
+        }
+    }
+
+    free( io.buf );
+    free( nodes );
+    return status;
+}
+
+
 /*
     shr_q_is_valid -- returns true if name is a valid queue
 
@@ -3628,7 +8551,7 @@ extern bool shr_q_is_valid(
 
     }
 
-    int fd = shm_open( name, O_RDONLY, FILE_MODE );
+    int fd = open_object( name, O_RDONLY );
     if ( fd < 0 ) {
 
         return false;
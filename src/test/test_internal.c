@@ -67,21 +67,21 @@ static void test_creation(void)
     assert(validate_existence("test", NULL) == SH_ERR_EXIST);
     assert(validate_existence("test", &size) == SH_ERR_EXIST);
     assert(size == 0);
-    assert(create_base_object(&base, 0, "basetest", "test", 4, 1) == SH_ERR_ARG);
-    assert(create_base_object(&base, sizeof(shr_base_s), NULL, "test", 4, 1) == SH_ERR_ARG);
-    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", NULL, 4, 1) == SH_ERR_ARG);
-    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 0, 1) == SH_ERR_ARG);
-    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1) == SH_OK);
+    assert(create_base_object(&base, 0, "basetest", "test", 4, 1, false, 0) == SH_ERR_ARG);
+    assert(create_base_object(&base, sizeof(shr_base_s), NULL, "test", 4, 1, false, 0) == SH_ERR_ARG);
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", NULL, 4, 1, false, 0) == SH_ERR_ARG);
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 0, 1, false, 0) == SH_ERR_ARG);
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1, false, 0) == SH_OK);
     assert(base != NULL);
     assert(validate_existence("basetest", &size) == SH_OK);
     assert(size == PAGE_SIZE);
     assert(base->current != NULL);
-    assert(base->prev == base->current);
     assert(base->current->array != NULL);
     assert(memcmp(base->current->array, "test", 4) == 0);
     assert(memcmp(base->name, "basetest", 8) == 0);
-    assert(base->current->size == PAGE_SIZE);
-    assert(base->current->slots == PAGE_SIZE >> SZ_SHIFT);
+    assert(base->current->size == RESERVE_SIZE);
+    assert(base->current->slots == RESERVE_SIZE >> SZ_SHIFT);
+    assert(base->current->array[SIZE] == PAGE_SIZE >> SZ_SHIFT);
     shm_unlink("basetest");
 }
 
@@ -92,13 +92,19 @@ void test_expansion(void)
     size_t size = 1;
 
     shm_unlink("basetest");
-    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1) == SH_OK);
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1, false, 0) == SH_OK);
     assert(validate_existence("basetest", &size) == SH_OK);
     assert(size == PAGE_SIZE);
+    long *array = base->current->array;
     view_s view = expand(base, base->current, 1000);
     assert(view.status == SH_OK);
     assert(validate_existence("basetest", &size) == SH_OK);
     assert(size > PAGE_SIZE);
+    assert(base->current->array == array);
+    assert(array[SIZE] == size >> SZ_SHIFT);
+    array[array[SIZE] - 1] = 1;
+    view = expand(base, base->current, RESERVE_SIZE >> SZ_SHIFT);
+    assert(view.status == SH_ERR_NOMEM);
     shm_unlink("basetest");
 
 }
@@ -108,7 +114,7 @@ void test_flags(void)
 {
     shr_base_s *base = NULL;
     shm_unlink("basetest");
-    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1) == SH_OK);
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1, false, 0) == SH_OK);
     assert(base->current->array[FLAGS] == 0);
     assert(set_flag(base->current->array, 1));
     assert(base->current->array[FLAGS] == 1);
@@ -124,7 +130,7 @@ static void test_alloc_idx_slots(void)
 {
     shr_base_s *base = NULL;
     shm_unlink("basetest");
-    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1) == SH_OK);
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1, false, 0) == SH_OK);
     init_data_allocator(base, BASE);
     view_s view = alloc_idx_slots(base);
     assert(view.slot > 0);
@@ -140,13 +146,64 @@ static void test_alloc_idx_slots(void)
     shm_unlink("basetest");
 }
 
+static void test_remove_front_chain(void)
+{
+    shr_base_s *base = NULL;
+    long nodes[8];
+    long removed[8];
+    shm_unlink("basetest");
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1, false, 0) == SH_OK);
+    init_data_allocator(base, BASE);
+    for (int i = 0; i < 8; i++) {
+        view_s view = alloc_idx_slots(base);
+        assert(view.slot > 0);
+        nodes[i] = view.slot;
+    }
+    add_chain_end(base, nodes, 8, FREE_TAIL);
+    long dummy = base->current->array[FREE_HEAD];
+    // dummy plus first four appended nodes are removed
+    assert(remove_front_chain(base, removed, 5, FREE_HEAD, FREE_TAIL) == 5);
+    assert(removed[0] == dummy);
+    assert(removed[1] == nodes[0]);
+    assert(removed[4] == nodes[3]);
+    assert(base->current->array[FREE_HEAD] == nodes[4]);
+    // last node always remains on list
+    assert(remove_front_chain(base, removed, 8, FREE_HEAD, FREE_TAIL) == 3);
+    assert(base->current->array[FREE_HEAD] == nodes[7]);
+    assert(remove_front_chain(base, removed, 8, FREE_HEAD, FREE_TAIL) == 0);
+    shm_unlink("basetest");
+}
+
+static void test_list_generations(void)
+{
+    shr_base_s *base = NULL;
+    shm_unlink("basetest");
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1, false, 0) == SH_OK);
+    init_data_allocator(base, BASE);
+    long id = base->current->array[ID_CNTR];
+    long gen = base->current->array[FREE_TL_CNT];
+    assert(gen % GEN_STRIDE == FREE_TAIL);
+    view_s view = alloc_idx_slots(base);
+    assert(view.slot > 0);
+    add_end(base, view.slot, FREE_TAIL);
+#ifdef __x86_64__
+    // generation follows list sequence and shared counter is untouched
+    assert(base->current->array[FREE_TL_CNT] == gen + GEN_STRIDE);
+    assert(base->current->array[ID_CNTR] == id);
+#else
+    // 32-bit generations come from the full width shared counter
+    assert(base->current->array[ID_CNTR] == id + 1);
+#endif
+    shm_unlink("basetest");
+}
+
 static void test_free_data_array4(long *array)
 {
     sh_status_e status;
     long slot[4];
     shr_base_s *base = NULL;
     shm_unlink("basetest");
-    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1) == SH_OK);
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1, false, 0) == SH_OK);
     init_data_allocator(base, BASE);
     view_s view = alloc_data_slots(base, array[0]);
     slot[0] = view.slot;
@@ -201,7 +258,7 @@ static void test_first_fit_allocation(void)
     view_s view;
     shr_base_s *base = NULL;
     shm_unlink("basetest");
-    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1) == SH_OK);
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1, false, 0) == SH_OK);
     init_data_allocator(base, BASE);
     view = alloc_data_slots(base, 64);
     biggest_slot = view.slot;
@@ -218,7 +275,7 @@ static void test_first_fit_allocation(void)
     view = alloc_data_slots(base, 20);
     assert(view.slot == biggest_slot);
     shm_unlink("basetest");
-    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1) == SH_OK);
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1, false, 0) == SH_OK);
     init_data_allocator(base, BASE);
     view = alloc_data_slots(base, 64);
     biggest_slot = view.slot;
@@ -241,9 +298,79 @@ static void test_first_fit_allocation(void)
     assert(view.slot == biggest_slot);
     assert(view.extent->array[view.slot] == 64);
     view = alloc_data_slots(base, 20);
-    assert(view.extent->array[view.slot] == 32);
+    assert(view.extent->array[view.slot] == 20);
     view = alloc_data_slots(base, 20);
-    assert(view.extent->array[view.slot] == 32);
+    assert(view.extent->array[view.slot] == 20);
+    shm_unlink("basetest");
+}
+
+static void test_data_size_classes(void)
+{
+    long sizes[][2] = {{1, 4}, {4, 4}, {5, 5}, {7, 7}, {9, 10}, {17, 20},
+                       {25, 28}, {29, 32}, {33, 40}, {100, 112}, {1000, 1024},
+                       {1025, 1280}};
+    shr_base_s *base = NULL;
+    shm_unlink("basetest");
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1, false, 0) == SH_OK);
+    init_data_allocator(base, BASE);
+    for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        view_s view = alloc_data_slots(base, sizes[i][0]);
+        assert(view.slot > 0);
+        assert(view.extent->array[view.slot] == sizes[i][1]);
+        assert(free_data_slots(base, view.slot) == SH_OK);
+        view_s again = alloc_data_slots(base, sizes[i][1]);
+        assert(again.slot == view.slot);
+        assert(free_data_slots(base, again.slot) == SH_OK);
+    }
+    assert(carve_data_slots(base, 17, 2) == SH_OK);
+    view_s view = alloc_data_slots(base, 18);
+    assert(view.slot > 0);
+    assert(view.extent->array[view.slot] == 20);
+    shm_unlink("basetest");
+}
+
+static void test_release_free_data(void)
+{
+    shr_base_s *base = NULL;
+    long slots = 8 * (PAGE_SIZE >> SZ_SHIFT);
+    shm_unlink("basetest");
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1, false, 0) == SH_OK);
+    init_data_allocator(base, BASE);
+    view_s view = alloc_data_slots(base, slots);
+    assert(view.slot > 0);
+    long slot = view.slot;
+    memset(&view.extent->array[slot + 2], 0xff, (slots - 2) << SZ_SHIFT);
+    assert(free_data_slots(base, slot) == SH_OK);
+    // released allocation is held apart until it is backed again for reuse
+    assert(release_free_data(base) > 0);
+    assert(release_free_data(base) == 0);
+    view = alloc_data_slots(base, slots);
+    assert(view.slot == slot);
+    assert(view.extent->array[slot] == slots);
+    assert(view.extent->array[slot + slots - 1] == 0);
+    shm_unlink("basetest");
+}
+
+static void test_remap_extent(void)
+{
+    shr_base_s *base = NULL;
+    shm_unlink("basetest");
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1, false, 0) == SH_OK);
+    init_data_allocator(base, BASE);
+    view_s view = alloc_data_slots(base, 8);
+    assert(view.slot > 0);
+    extent_s *before = base->current;
+    before->array[view.slot + 2] = 42;
+    // earlier mapping is kept and shares contents with the larger mapping
+    remap_extent(base, before->size);
+    assert(base->current != before);
+    assert(base->current->prev == before);
+    assert(base->current->size > before->size);
+    assert(base->current->array[view.slot + 2] == 42);
+    base->current->array[view.slot + 3] = 43;
+    assert(before->array[view.slot + 3] == 43);
+    assert(free_data_slots(base, view.slot) == SH_OK);
+    assert(alloc_data_slots(base, 8).slot == view.slot);
     shm_unlink("basetest");
 }
 
@@ -255,7 +382,7 @@ static void test_large_data_allocation(void)
     long slot = 0;
     shr_base_s *base = NULL;
     shm_unlink("basetest");
-    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1) == SH_OK);
+    assert(create_base_object(&base, sizeof(shr_base_s), "basetest", "test", 4, 1, false, 0) == SH_OK);
     init_data_allocator(base, BASE);
     view_s view = alloc_data_slots(base, 4096 >> SZ_SHIFT);
     big_slot = view.slot;
@@ -292,8 +419,13 @@ int main(void)
     test_expansion();
     test_flags();
     test_alloc_idx_slots();
+    test_remove_front_chain();
+    test_list_generations();
     test_free_data_slots();
     test_first_fit_allocation();
+    test_data_size_classes();
+    test_release_free_data();
+    test_remap_extent();
     test_large_data_allocation();
 
     return 0;
@@ -26,12 +26,15 @@ THE SOFTWARE.
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "shared_int.h"
@@ -1249,6 +1252,1366 @@ void test_adaptive_lifo()
     free(item.buffer);
 }
 
+static void test_reserve_commit(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s item = {0};
+    void *value = NULL;
+    long handle = 0;
+    long handle2 = 0;
+
+    assert(shr_q_reserve(q, 5, &value, &handle) == SH_ERR_ARG);
+    shm_unlink("testq");
+    status = shr_q_create(&q, "testq", 2, SQ_READWRITE);
+    assert(status == SH_OK);
+    assert(shr_q_reserve(q, 0, &value, &handle) == SH_ERR_ARG);
+    assert(shr_q_reserve(q, 5, NULL, &handle) == SH_ERR_ARG);
+    assert(shr_q_reserve(q, 5, &value, NULL) == SH_ERR_ARG);
+    assert(shr_q_commit(q, 0) == SH_ERR_ARG);
+    assert(shr_q_abort(q, 0) == SH_ERR_ARG);
+    assert(shr_q_reserve(q, 5, &value, &handle) == SH_OK);
+    assert(value != NULL);
+    assert(handle > 0);
+    memcpy(value, "test1", 5);
+    assert(shr_q_count(q) == 0);
+    assert(shr_q_commit(q, handle) == SH_OK);
+    assert(shr_q_count(q) == 1);
+    // handle is no longer a reservation once committed
+    assert(shr_q_commit(q, handle) == SH_ERR_ARG);
+    assert(shr_q_abort(q, handle) == SH_ERR_ARG);
+    assert(shr_q_count(q) == 1);
+    assert(shr_q_reserve(q, 5, &value, &handle) == SH_OK);
+    assert(shr_q_reserve(q, 5, &value, &handle2) == SH_ERR_LIMIT);
+    assert(shr_q_abort(q, handle + 1) == SH_ERR_ARG);
+    assert(shr_q_abort(q, LONG_MAX) == SH_ERR_ARG);
+    assert(shr_q_commit(q, handle + 1) == SH_ERR_ARG);
+    assert(shr_q_abort(q, handle) == SH_OK);
+    assert(shr_q_abort(q, handle) == SH_ERR_ARG);
+    assert(shr_q_commit(q, handle) == SH_ERR_ARG);
+    assert(shr_q_count(q) == 1);
+    assert(shr_q_reserve(q, 5, &value, &handle) == SH_OK);
+    memcpy(value, "test2", 5);
+    assert(shr_q_commit(q, handle) == SH_OK);
+    assert(shr_q_count(q) == 2);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(item.length == 5);
+    assert(item.type == SH_STRM_T);
+    assert(memcmp(item.value, "test1", item.length) == 0);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(item.length == 5);
+    assert(memcmp(item.value, "test2", item.length) == 0);
+    assert(shr_q_count(q) == 0);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static void test_borrow_release(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s item = {0};
+    struct timespec ts = { 0, 1000 };
+
+    item = shr_q_remove_borrow(q);
+    assert(item.status == SH_ERR_ARG);
+    assert(shr_q_release(q, &item) == SH_ERR_ARG);
+    shm_unlink("testq");
+    status = shr_q_create(&q, "testq", 2, SQ_READWRITE);
+    assert(status == SH_OK);
+    assert(shr_q_release(q, NULL) == SH_ERR_ARG);
+    assert(shr_q_release(q, &item) == SH_ERR_ARG);
+    item = shr_q_remove_borrow(q);
+    assert(item.status == SH_ERR_EMPTY);
+    item = shr_q_remove_borrow_timedwait(q, &ts);
+    assert(item.status == SH_ERR_EMPTY);
+    assert(shr_q_add(q, "test1", 5) == SH_OK);
+    assert(shr_q_add(q, "test2", 5) == SH_OK);
+    item = shr_q_remove_borrow(q);
+    assert(item.status == SH_OK);
+    assert(item.length == 5);
+    assert(item.type == SH_STRM_T);
+    assert(item.timestamp != NULL);
+    assert(item.timestamp->tv_sec > 0);
+    assert(memcmp(item.value, "test1", item.length) == 0);
+    assert(shr_q_count(q) == 1);
+    assert(shr_q_add(q, "test3", 5) == SH_OK);
+    assert(shr_q_release(q, &item) == SH_OK);
+    assert(item.buffer == NULL);
+    item = shr_q_remove_borrow_wait(q);
+    assert(item.status == SH_OK);
+    assert(memcmp(item.value, "test2", item.length) == 0);
+    assert(shr_q_release(q, &item) == SH_OK);
+    item = shr_q_remove_borrow(q);
+    assert(item.status == SH_OK);
+    assert(memcmp(item.value, "test3", item.length) == 0);
+    assert(shr_q_release(q, &item) == SH_OK);
+    assert(shr_q_count(q) == 0);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+}
+
+static void test_remove_batch(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s items[4] = {{0}};
+    int count = -1;
+    struct timespec ts = { 0, 1000 };
+
+    assert(shr_q_remove_batch(q, items, 4, &count) == SH_ERR_ARG);
+    shm_unlink("testq");
+    status = shr_q_create(&q, "testq", 0, SQ_READWRITE);
+    assert(status == SH_OK);
+    assert(shr_q_remove_batch(q, NULL, 4, &count) == SH_ERR_ARG);
+    assert(shr_q_remove_batch(q, items, 0, &count) == SH_ERR_ARG);
+    assert(shr_q_remove_batch(q, items, 4, NULL) == SH_ERR_ARG);
+    assert(shr_q_remove_batch_timedwait(q, items, 4, &count, NULL) == SH_ERR_ARG);
+    assert(shr_q_remove_batch(q, items, 4, &count) == SH_ERR_EMPTY);
+    assert(count == 0);
+    assert(shr_q_remove_batch_timedwait(q, items, 4, &count, &ts) == SH_ERR_EMPTY);
+    assert(count == 0);
+    assert(shr_q_add(q, "test1", 5) == SH_OK);
+    assert(shr_q_add(q, "test2", 5) == SH_OK);
+    assert(shr_q_add(q, "test3", 5) == SH_OK);
+    assert(shr_q_remove_batch(q, items, 2, &count) == SH_OK);
+    assert(count == 2);
+    assert(items[0].status == SH_OK);
+    assert(items[0].length == 5);
+    assert(memcmp(items[0].value, "test1", items[0].length) == 0);
+    assert(items[1].status == SH_OK);
+    assert(memcmp(items[1].value, "test2", items[1].length) == 0);
+    assert(shr_q_count(q) == 1);
+    assert(shr_q_remove_batch_wait(q, items, 4, &count) == SH_OK);
+    assert(count == 1);
+    assert(memcmp(items[0].value, "test3", items[0].length) == 0);
+    assert(shr_q_count(q) == 0);
+    assert(shr_q_add(q, "test4", 5) == SH_OK);
+    assert(shr_q_remove_batch_timedwait(q, items, 4, &count, &ts) == SH_OK);
+    assert(count == 1);
+    assert(memcmp(items[0].value, "test4", items[0].length) == 0);
+    assert(shr_q_remove_batch(q, items, 4, &count) == SH_ERR_EMPTY);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    for (int i = 0; i < 4; i++) {
+        free(items[i].buffer);
+    }
+}
+
+static void test_remove_batch_expired(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s items[2] = {{0}};
+    int count = -1;
+    char big[256];
+    struct timespec sleep = {0, 100000000};
+
+    shm_unlink("testq");
+    status = shr_q_create(&q, "testq", 0, SQ_READWRITE);
+    assert(status == SH_OK);
+    assert(shr_q_timelimit(q, 0, 50000000) == SH_OK);
+    assert(shr_q_discard(q, true) == SH_OK);
+    memset(big, 'x', sizeof(big));
+    assert(shr_q_add(q, big, sizeof(big)) == SH_OK);
+    while (nanosleep(&sleep, &sleep) < 0) {
+        if (errno != EINTR) {
+            break;
+        }
+    }
+    assert(shr_q_add(q, "test1", 5) == SH_OK);
+    items[0].buffer = malloc(8);
+    assert(items[0].buffer != NULL);
+    items[0].buf_size = 8;
+    assert(shr_q_remove_batch(q, items, 2, &count) == SH_OK);
+    assert(count == 1);
+    assert(items[0].status == SH_OK);
+    assert(items[0].length == 5);
+    assert(memcmp(items[0].value, "test1", items[0].length) == 0);
+    assert(items[0].buf_size >= sizeof(big));
+    assert(shr_q_count(q) == 0);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    for (int i = 0; i < 2; i++) {
+        free(items[i].buffer);
+    }
+}
+
+
+static void test_add_batch(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s item = {0};
+    sq_vec_s items[4] = {
+        { .type = SH_STRM_T, .len = 5, .base = "test1" },
+        { .type = SH_ASCII_T, .len = 5, .base = "test2" },
+        { .type = SH_STRM_T, .len = 5, .base = "test3" },
+        { .type = SH_STRM_T, .len = 5, .base = "test4" }
+    };
+    sq_vec_s bad[2] = {
+        { .type = SH_STRM_T, .len = 5, .base = "test1" },
+        { .type = SH_STRM_T, .len = 0, .base = "test2" }
+    };
+
+    assert(shr_q_add_batch(q, items, 4) == SH_ERR_ARG);
+    shm_unlink("testq");
+    status = shr_q_create(&q, "testq", 3, SQ_READWRITE);
+    assert(status == SH_OK);
+    assert(shr_q_add_batch(q, NULL, 4) == SH_ERR_ARG);
+    assert(shr_q_add_batch(q, items, 0) == SH_ERR_ARG);
+    assert(shr_q_add_batch(q, bad, 2) == SH_ERR_ARG);
+    assert(shr_q_add_batch(q, items, 4) == SH_ERR_LIMIT);
+    assert(shr_q_count(q) == 0);
+    assert(shr_q_add_batch(q, items, 3) == SH_OK);
+    assert(shr_q_count(q) == 3);
+    assert(shr_q_add(q, "test5", 5) == SH_ERR_LIMIT);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(memcmp(item.value, "test1", item.length) == 0);
+    assert(shr_q_add_batch(q, &items[3], 1) == SH_OK);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(item.type == SH_ASCII_T);
+    assert(memcmp(item.value, "test2", item.length) == 0);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(memcmp(item.value, "test3", item.length) == 0);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(memcmp(item.value, "test4", item.length) == 0);
+    assert(shr_q_count(q) == 0);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+
+    long values[100];
+    sq_vec_s many[100];
+    for (long i = 0; i < 100; i++) {
+        values[i] = i;
+        many[i] = (sq_vec_s) { .type = SH_INTEGER_T, .len = sizeof(long),
+                               .base = &values[i] };
+    }
+    status = shr_q_create(&q, "testq", 0, SQ_READWRITE);
+    assert(status == SH_OK);
+    assert(shr_q_add_batch(q, many, 100) == SH_OK);
+    assert(shr_q_count(q) == 100);
+    for (long i = 0; i < 100; i++) {
+        item = shr_q_remove(q, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        assert(*(long*)item.value == i);
+    }
+    assert(shr_q_count(q) == 0);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static void test_spsc_ring(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    shr_q_s *tq = NULL;
+    sq_item_s item = {0};
+    sq_attr_s attr = { .flags = SQ_SPSC, .ring_size = 1024 };
+    sq_attr_s bad = { .flags = 0x8000 };
+    char msg[100] = {0};
+    void *value = NULL;
+    long handle = 0;
+    int added = 0;
+
+    shm_unlink("testq");
+    assert(shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &bad) == SH_ERR_ARG);
+    // ring that does not fit in memory leaves no queue behind
+    bad = (sq_attr_s){ .flags = SQ_SPSC, .ring_size = 1L << 40 };
+    assert(shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &bad) == SH_ERR_NOMEM);
+    bad.ring_size = SIZE_MAX;
+    assert(shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &bad) == SH_ERR_NOMEM);
+    assert(q == NULL);
+    status = shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    assert(shr_q_reserve(q, 5, &value, &handle) == SH_ERR_NOSUPPORT);
+    item = shr_q_remove_borrow(q);
+    assert(item.status == SH_ERR_NOSUPPORT);
+    assert(shr_q_limit_lifo(q, true) == SH_ERR_NOSUPPORT);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_ERR_EMPTY);
+    status = shr_q_open(&tq, "testq", SQ_READ_ONLY);
+    assert(status == SH_OK);
+
+    // fill ring until it has no room
+    while (shr_q_add(q, msg, sizeof(msg)) == SH_OK) {
+        msg[0]++;
+        added++;
+    }
+    assert(added > 1);
+    assert(shr_q_count(q) == added);
+
+    // drain from other handle and wrap around end of ring several times
+    for (int i = 0; i < 5 * added; i++) {
+        item = shr_q_remove(tq, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        assert(item.length == sizeof(msg));
+        assert(((char*)item.value)[0] == (char)i);
+        assert(shr_q_add(q, msg, sizeof(msg)) == SH_OK);
+        msg[0]++;
+    }
+    for (int i = 0; i < added; i++) {
+        item = shr_q_remove(tq, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+    }
+    assert(shr_q_count(q) == 0);
+
+    sq_vec_s vector[2] = {
+        { .type = SH_STRM_T, .len = 5, .base = "test1" },
+        { .type = SH_ASCII_T, .len = 6, .base = "test22" }
+    };
+    assert(shr_q_addv(q, vector, 2) == SH_OK);
+    item = shr_q_remove(tq, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(item.vcount == 2);
+    assert(item.vector[0].len == 5);
+    assert(memcmp(item.vector[0].base, "test1", 5) == 0);
+    assert(item.vector[1].type == SH_ASCII_T);
+    assert(memcmp(item.vector[1].base, "test22", 6) == 0);
+
+    // item larger than ring can never be added
+    char big[2048] = {0};
+    assert(shr_q_add(q, big, sizeof(big)) == SH_ERR_ARG);
+    assert(shr_q_add_wait(q, big, sizeof(big)) == SH_ERR_ARG);
+
+    // item that only fits at start of empty ring is added
+    for (int i = 0; i < 2; i++) {
+        assert(shr_q_add(q, big, 700) == SH_OK);
+        item = shr_q_remove(tq, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        assert(item.length == 700);
+    }
+
+    // blocking adds wait for room in full ring
+    while (shr_q_add(q, msg, sizeof(msg)) == SH_OK);
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = 10000000 };
+    assert(shr_q_add_timedwait(q, msg, sizeof(msg), &ts) == SH_ERR_LIMIT);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        usleep(50000);
+        item = shr_q_remove(tq, &item.buffer, &item.buf_size);
+        _exit(item.status == SH_OK ? 0 : 1);
+    }
+    assert(shr_q_add_wait(q, msg, sizeof(msg)) == SH_OK);
+    int wstatus = 0;
+    assert(waitpid(pid, &wstatus, 0) == pid);
+    assert(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+    while (shr_q_remove(tq, &item.buffer, &item.buf_size).status == SH_OK);
+    assert(shr_q_count(q) == 0);
+
+    status = shr_q_close(&tq);
+    assert(status == SH_OK);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static void test_fixed_size_items(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    shr_q_s *tq = NULL;
+    sq_item_s item = {0};
+    sq_attr_s attr = { .item_size = 64 };
+    sq_attr_s bad = { .flags = SQ_SPSC, .item_size = 64 };
+    char msg[64] = {0};
+    char big[65] = {0};
+    void *value = NULL;
+    long handle = 0;
+
+    shm_unlink("testq");
+    assert(shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &bad) == SH_ERR_ARG);
+    status = shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    assert(shr_q_reserve(q, 5, &value, &handle) == SH_ERR_NOSUPPORT);
+    item = shr_q_remove_borrow(q);
+    assert(item.status == SH_ERR_NOSUPPORT);
+    assert(shr_q_add(q, big, sizeof(big)) == SH_ERR_ARG);
+    assert(shr_q_count(q) == 0);
+    status = shr_q_open(&tq, "testq", SQ_READ_ONLY);
+    assert(status == SH_OK);
+
+    // recycle nodes through several rounds
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 100; i++) {
+            msg[0] = (char)i;
+            assert(shr_q_add(q, msg, (i % sizeof(msg)) + 1) == SH_OK);
+        }
+        assert(shr_q_count(q) == 100);
+        for (int i = 0; i < 100; i++) {
+            item = shr_q_remove(tq, &item.buffer, &item.buf_size);
+            assert(item.status == SH_OK);
+            assert(item.length == (i % sizeof(msg)) + 1);
+            assert(((char*)item.value)[0] == (char)i);
+            assert(item.vcount == 1);
+        }
+        assert(shr_q_count(tq) == 0);
+    }
+
+    sq_vec_s vector[2] = {
+        { .type = SH_STRM_T, .len = 5, .base = "test1" },
+        { .type = SH_ASCII_T, .len = 6, .base = "test22" }
+    };
+    assert(shr_q_addv(q, vector, 2) == SH_OK);
+    item = shr_q_remove(tq, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(item.vcount == 2);
+    assert(memcmp(item.vector[0].base, "test1", 5) == 0);
+    assert(item.vector[1].type == SH_ASCII_T);
+    assert(memcmp(item.vector[1].base, "test22", 6) == 0);
+
+    sq_vec_s items[2] = {
+        { .type = SH_STRM_T, .len = 5, .base = "test1" },
+        { .type = SH_STRM_T, .len = sizeof(big), .base = big }
+    };
+    assert(shr_q_add_batch(q, items, 2) == SH_ERR_ARG);
+    assert(shr_q_count(q) == 0);
+    items[1].len = 6;
+    items[1].base = "test22";
+    assert(shr_q_add_batch(q, items, 2) == SH_OK);
+    item = shr_q_remove(tq, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(memcmp(item.value, "test1", 5) == 0);
+    item = shr_q_remove(tq, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(memcmp(item.value, "test22", 6) == 0);
+
+    // adaptive lifo hands back most recent items first above level
+    assert(shr_q_level(q, 1) == SH_OK);
+    assert(shr_q_limit_lifo(q, true) == SH_OK);
+    for (int i = 0; i < 3; i++) {
+        msg[0] = (char)i;
+        assert(shr_q_add(q, msg, sizeof(msg)) == SH_OK);
+    }
+    item = shr_q_remove(tq, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(((char*)item.value)[0] == 2);
+    item = shr_q_remove(tq, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(((char*)item.value)[0] == 1);
+    item = shr_q_remove(tq, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(((char*)item.value)[0] == 0);
+
+    status = shr_q_close(&tq);
+    assert(status == SH_OK);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static void test_count_approx(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s item = {0};
+
+    assert(shr_q_count_approx(NULL) == -1);
+    shm_unlink("testq");
+    status = shr_q_create(&q, "testq", 0, SQ_READWRITE);
+    assert(status == SH_OK);
+    assert(shr_q_count(q) == 0);
+    assert(shr_q_count_approx(q) == 0);
+    for (int i = 0; i < 20; i++) {
+        assert(shr_q_add(q, "test", 4) == SH_OK);
+    }
+    assert(shr_q_count(q) == 20);
+    assert(shr_q_count_approx(q) == 20);
+    for (int i = 0; i < 15; i++) {
+        item = shr_q_remove(q, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+    }
+    // quiescent queue has matching exact and approximate counts
+    assert(shr_q_count(q) == 5);
+    assert(shr_q_count_approx(q) == 5);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static void test_occupancy_events(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s items[3] = {{0}};
+    int count = 0;
+
+    shm_unlink("testq");
+    status = shr_q_create(&q, "testq", 0, SQ_READWRITE);
+    assert(status == SH_OK);
+    // concurrent adds and removes leave the occupancy of the queue settled
+    for (int i = 0; i < 2; i++) {
+        pid_t pid = fork();
+        assert(pid >= 0);
+        if (pid == 0) {
+            shr_q_s *q2 = NULL;
+            sq_item_s item = {0};
+            if (shr_q_open(&q2, "testq", SQ_READWRITE) != SH_OK) {
+                _exit(1);
+            }
+            for (int j = 0; j < 5000; j++) {
+                if (shr_q_add(q2, "test", 4) != SH_OK) {
+                    _exit(1);
+                }
+                item = shr_q_remove(q2, &item.buffer, &item.buf_size);
+                if (item.status != SH_OK) {
+                    _exit(1);
+                }
+            }
+            _exit(0);
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        int wstatus = 0;
+        assert(wait(&wstatus) > 0);
+        assert(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+    }
+    assert(shr_q_count(q) == 0);
+    while (shr_q_event(q) != SQ_EVNT_NONE);
+    assert(shr_q_subscribe(q, SQ_EVNT_EMPTY) == SH_OK);
+    assert(shr_q_subscribe(q, SQ_EVNT_NONEMPTY) == SH_OK);
+    assert(shr_q_add(q, "test", 4) == SH_OK);
+    assert(shr_q_event(q) == SQ_EVNT_NONEMPTY);
+    assert(shr_q_event(q) == SQ_EVNT_NONE);
+    // adding to a queue that holds items is not a transition
+    assert(shr_q_subscribe(q, SQ_EVNT_NONEMPTY) == SH_OK);
+    assert(shr_q_add(q, "test", 4) == SH_OK);
+    assert(shr_q_add(q, "test", 4) == SH_OK);
+    assert(shr_q_event(q) == SQ_EVNT_NONE);
+    // batch remove claims every item before the queue is empty
+    assert(shr_q_remove_batch(q, items, 3, &count) == SH_OK);
+    assert(count == 3);
+    assert(shr_q_event(q) == SQ_EVNT_EMPTY);
+    assert(shr_q_event(q) == SQ_EVNT_NONE);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    for (int i = 0; i < 3; i++) {
+        free(items[i].buffer);
+    }
+}
+
+static void test_queue_clock(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s item = {0};
+    struct timespec now;
+    struct timespec stamp;
+    sq_attr_s attr = {0};
+    sq_clock_e clocks[] = {
+        SQ_CLOCK_REALTIME_COARSE,
+        SQ_CLOCK_MONOTONIC,
+        SQ_CLOCK_MONOTONIC_COARSE,
+        SQ_CLOCK_TSC
+    };
+
+    shm_unlink("testq");
+    attr.clock = SQ_CLOCK_TSC + 1;
+    status = shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr);
+    assert(status == SH_ERR_ARG);
+    for (int i = 0; i < 4; i++) {
+        attr.clock = clocks[i];
+        status = shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr);
+        assert(status == SH_OK);
+        assert(shr_q_add(q, "test", 4) == SH_OK);
+        assert(shr_q_last_empty(q, &stamp) == SH_OK);
+        item = shr_q_remove(q, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        assert(item.length == 4);
+        // returned timestamps are wall clock time whatever the queue clock
+        clock_gettime(CLOCK_REALTIME, &now);
+        assert(labs(item.timestamp->tv_sec - now.tv_sec) <= 2);
+        assert(labs(stamp.tv_sec - now.tv_sec) <= 2);
+        assert(!shr_q_exceeds_idle_time(q, 60, 0));
+        status = shr_q_destroy(&q);
+        assert(status == SH_OK);
+    }
+    free(item.buffer);
+}
+
+static void test_lean_queue(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s item = {0};
+    struct timespec stamp = {1, 0};
+    sq_attr_s attr = {.flags = SQ_LEAN};
+
+    shm_unlink("testq");
+    status = shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    assert(shr_q_monitor(q, SIGUSR1) == SH_ERR_NOSUPPORT);
+    assert(shr_q_listen(q, SIGUSR2) == SH_ERR_NOSUPPORT);
+    assert(shr_q_monitor(q, 0) == SH_OK);
+    assert(shr_q_level(q, 5) == SH_ERR_NOSUPPORT);
+    assert(shr_q_timelimit(q, 1, 0) == SH_ERR_NOSUPPORT);
+    assert(shr_q_target_delay(q, 1, 0) == SH_ERR_NOSUPPORT);
+    assert(shr_q_discard(q, true) == SH_ERR_NOSUPPORT);
+    assert(shr_q_limit_lifo(q, true) == SH_ERR_NOSUPPORT);
+    assert(shr_q_coalesce(q, true) == SH_ERR_NOSUPPORT);
+    assert(shr_q_subscribe(q, SQ_EVNT_INIT) == SH_ERR_NOSUPPORT);
+    assert(shr_q_clean(q, &stamp) == SH_ERR_NOSUPPORT);
+    for (int i = 0; i < 10; i++) {
+        assert(shr_q_add(q, "test", 4) == SH_OK);
+    }
+    assert(shr_q_count(q) == 10);
+    assert(shr_q_event(q) == SQ_EVNT_NONE);
+    assert(shr_q_last_empty(q, &stamp) == SH_ERR_NOSUPPORT);
+    assert(!shr_q_exceeds_idle_time(q, 0, 0));
+    for (int i = 0; i < 10; i++) {
+        item = shr_q_remove(q, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        assert(item.length == 4);
+        assert(item.timestamp->tv_sec == 0 && item.timestamp->tv_nsec == 0);
+    }
+    assert(shr_q_count(q) == 0);
+    assert(shr_q_event(q) == SQ_EVNT_NONE);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static void test_priority_lanes(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    shr_q_s *q2 = NULL;
+    sq_item_s item = {0};
+    struct timespec limit = {0, 10000000};
+    struct timespec sleep = {0, 20000000};
+    sq_attr_s attr = {.lanes = 9};
+
+    shm_unlink("testq");
+    assert(shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr) == SH_ERR_ARG);
+    attr = (sq_attr_s){.flags = SQ_SPSC, .lanes = 2};
+    assert(shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr) == SH_ERR_ARG);
+    attr = (sq_attr_s){.item_size = 8, .lanes = 2};
+    assert(shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr) == SH_ERR_ARG);
+    attr = (sq_attr_s){.lanes = 3};
+    status = shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    assert(shr_q_limit_lifo(q, true) == SH_ERR_NOSUPPORT);
+    assert(shr_q_add_prio(q, "test", 4, 3) == SH_ERR_ARG);
+    assert(shr_q_add_prio(q, "test", 4, -1) == SH_ERR_ARG);
+    assert(shr_q_add(q, "low1", 4) == SH_OK);
+    assert(shr_q_add_prio(q, "mid1", 4, 1) == SH_OK);
+    assert(shr_q_add_prio(q, "top1", 4, 2) == SH_OK);
+    assert(shr_q_add_prio(q, "low2", 4, 0) == SH_OK);
+    assert(shr_q_add_prio(q, "top2", 4, 2) == SH_OK);
+    assert(shr_q_count(q) == 5);
+    status = shr_q_open(&q2, "testq", SQ_READWRITE);
+    assert(status == SH_OK);
+    char *order[] = {"top1", "top2", "mid1", "low1", "low2"};
+    for (int i = 0; i < 5; i++) {
+        item = shr_q_remove(q2, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        assert(memcmp(item.value, order[i], 4) == 0);
+    }
+    assert(shr_q_remove(q2, &item.buffer, &item.buf_size).status == SH_ERR_EMPTY);
+    // clean reaches expired items in every lane
+    assert(shr_q_add_prio(q, "top1", 4, 2) == SH_OK);
+    assert(shr_q_add(q, "low1", 4) == SH_OK);
+    while (nanosleep(&sleep, &sleep) < 0) {
+        if (errno != EINTR) {
+            break;
+        }
+    }
+    assert(shr_q_clean(q2, &limit) == SH_OK);
+    assert(shr_q_count(q) == 0);
+    status = shr_q_close(&q2);
+    assert(status == SH_OK);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+
+    // weighted removes alternate between two busy lanes
+    attr = (sq_attr_s){.flags = SQ_WEIGHTED, .lanes = 2};
+    status = shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    for (int i = 0; i < 4; i++) {
+        assert(shr_q_add_prio(q, "high", 4, 1) == SH_OK);
+        assert(shr_q_add_prio(q, "low_", 4, 0) == SH_OK);
+    }
+    for (int i = 0; i < 8; i++) {
+        item = shr_q_remove(q, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        assert(memcmp(item.value, (i % 2) ? "low_" : "high", 4) == 0);
+    }
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static void test_select(void)
+{
+    sh_status_e status;
+    shr_q_s *qs[3] = {NULL};
+    shr_q_s *wq = NULL;
+    sq_item_s item = {0};
+    struct timespec timeout = {0, 10000000};
+    char *names[] = {"testq", "testq2", "testq3"};
+    int index = -1;
+
+    for (int i = 0; i < 3; i++) {
+        shm_unlink(names[i]);
+        status = shr_q_create(&qs[i], names[i], 0, SQ_READWRITE);
+        assert(status == SH_OK);
+    }
+    assert(shr_q_select(NULL, 3, &timeout, &index) == SH_ERR_ARG);
+    assert(shr_q_select(qs, 0, &timeout, &index) == SH_ERR_ARG);
+    assert(shr_q_select(qs, 129, &timeout, &index) == SH_ERR_ARG);
+    assert(shr_q_select(qs, 3, &timeout, NULL) == SH_ERR_ARG);
+    status = shr_q_open(&wq, "testq2", SQ_WRITE_ONLY);
+    assert(status == SH_OK);
+    assert(shr_q_select(&wq, 1, &timeout, &index) == SH_ERR_STATE);
+    assert(shr_q_select(qs, 3, &timeout, &index) == SH_ERR_EMPTY);
+    assert(index == -1);
+    assert(shr_q_add(wq, "test", 4) == SH_OK);
+    assert(shr_q_select(qs, 3, NULL, &index) == SH_OK);
+    assert(index == 1);
+    item = shr_q_remove(qs[index], &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(shr_q_select(qs, 3, &timeout, &index) == SH_ERR_EMPTY);
+    status = shr_q_close(&wq);
+    assert(status == SH_OK);
+    for (int i = 0; i < 3; i++) {
+        status = shr_q_destroy(&qs[i]);
+        assert(status == SH_OK);
+    }
+    free(item.buffer);
+}
+
+static void test_broadcast(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    shr_q_s *q2 = NULL;
+    sq_item_s item = {0};
+    sq_attr_s attr = {.flags = SQ_BROADCAST, .lanes = 2};
+    char value[8];
+
+    shm_unlink("testq");
+    assert(shr_q_create_ex(&q, "testq", 4, SQ_READWRITE, &attr) == SH_ERR_ARG);
+    attr = (sq_attr_s){.flags = SQ_BROADCAST};
+    status = shr_q_create_ex(&q, "testq", 4, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    status = shr_q_open(&q2, "testq", SQ_READWRITE);
+    assert(status == SH_OK);
+    assert(shr_q_join(q, 8) == SH_ERR_ARG);
+    assert(shr_q_remove_group(q, 0, &item.buffer, &item.buf_size).status == SH_ERR_STATE);
+    assert(shr_q_lag(q, 0) == -1);
+    assert(shr_q_join(q, 0) == SH_OK);
+    assert(shr_q_join(q2, 1) == SH_OK);
+    assert(shr_q_remove(q, &item.buffer, &item.buf_size).status == SH_ERR_NOSUPPORT);
+    assert(shr_q_discard(q, true) == SH_ERR_NOSUPPORT);
+    assert(shr_q_limit_lifo(q, true) == SH_ERR_NOSUPPORT);
+    for (int i = 0; i < 4; i++) {
+        sprintf(value, "item%d", i);
+        assert(shr_q_add(q, value, 6) == SH_OK);
+    }
+    // slowest group holds items against the depth limit
+    assert(shr_q_add(q, "full", 5) == SH_ERR_LIMIT);
+    assert(shr_q_lag(q, 0) == 4);
+    for (int i = 0; i < 4; i++) {
+        item = shr_q_remove_group(q, 0, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        sprintf(value, "item%d", i);
+        assert(memcmp(item.value, value, 6) == 0);
+    }
+    assert(shr_q_remove_group(q, 0, &item.buffer, &item.buf_size).status == SH_ERR_EMPTY);
+    assert(shr_q_lag(q, 0) == 0);
+    assert(shr_q_lag(q2, 1) == 4);
+    assert(shr_q_count(q) == 4);
+    for (int i = 0; i < 2; i++) {
+        item = shr_q_remove_group(q2, 1, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        sprintf(value, "item%d", i);
+        assert(memcmp(item.value, value, 6) == 0);
+    }
+    assert(shr_q_count(q) == 2);
+    assert(shr_q_add(q, "item4", 6) == SH_OK);
+    assert(shr_q_lag(q, 0) == 1);
+    assert(shr_q_lag(q2, 1) == 3);
+    // group that leaves no longer holds items
+    assert(shr_q_leave(q2, 1) == SH_OK);
+    assert(shr_q_count(q) == 1);
+    item = shr_q_remove_group(q, 0, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(memcmp(item.value, "item4", 6) == 0);
+    assert(shr_q_count(q) == 0);
+    assert(shr_q_count_approx(q) == 0);
+    status = shr_q_close(&q2);
+    assert(status == SH_OK);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static void test_durable_queue(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s item = {0};
+    sq_attr_s attr = {.sync = SQ_SYNC_COMMIT};
+    char const *path = "/tmp/test_shrq_durable";
+
+    unlink(path);
+    assert(shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr) == SH_ERR_ARG);
+    attr = (sq_attr_s){.flags = SQ_SPSC};
+    assert(shr_q_create_ex(&q, path, 0, SQ_READWRITE, &attr) == SH_ERR_ARG);
+    // clocks not tied to wall time do not survive a restart of the system
+    attr = (sq_attr_s){.clock = SQ_CLOCK_MONOTONIC};
+    assert(shr_q_create_ex(&q, path, 0, SQ_READWRITE, &attr) == SH_ERR_ARG);
+    attr = (sq_attr_s){.clock = SQ_CLOCK_TSC};
+    assert(shr_q_create_ex(&q, path, 0, SQ_READWRITE, &attr) == SH_ERR_ARG);
+    attr = (sq_attr_s){.sync = SQ_SYNC_COMMIT};
+    status = shr_q_create_ex(&q, path, 0, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    assert(shr_q_is_valid(path));
+    assert(shr_q_add(q, "test1", 5) == SH_OK);
+    assert(shr_q_add(q, "test2", 5) == SH_OK);
+    status = shr_q_close(&q);
+    assert(status == SH_OK);
+
+    // items survive process that ends without closing queue
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        if (shr_q_open(&q, path, SQ_READWRITE) != SH_OK ||
+            shr_q_add(q, "test3", 5) != SH_OK) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    int wstatus = 0;
+    assert(waitpid(pid, &wstatus, 0) == pid);
+    assert(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+    status = shr_q_open(&q, path, SQ_READWRITE);
+    assert(status == SH_OK);
+    assert(shr_q_count(q) == 3);
+    assert(shr_q_count_approx(q) == 3);
+    for (int i = 1; i <= 3; i++) {
+        item = shr_q_remove(q, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        assert(item.length == 5);
+        assert(((char*)item.value)[4] == '0' + i);
+    }
+    assert(shr_q_remove(q, &item.buffer, &item.buf_size).status == SH_ERR_EMPTY);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    assert(access(path, F_OK) < 0);
+
+    attr = (sq_attr_s){.sync = SQ_SYNC_PERIODIC, .sync_msec = 10};
+    status = shr_q_create_ex(&q, path, 0, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    assert(shr_q_add(q, "test", 4) == SH_OK);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static void test_coalesced_signals(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s item = {0};
+
+    shm_unlink("testq");
+    status = shr_q_create(&q, "testq", 0, SQ_READWRITE);
+    assert(status == SH_OK);
+    assert(shr_q_listen(q, SIGUSR1) == SH_OK);
+    assert(shr_q_will_coalesce(q) == false);
+    adds = 0;
+    assert(shr_q_add(q, "test", 4) == SH_OK);
+    assert(adds == 1);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    // every arrival is signalled unless coalescing is on
+    assert(shr_q_add(q, "test", 4) == SH_OK);
+    assert(adds == 2);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(shr_q_coalesce(NULL, true) == SH_ERR_ARG);
+    assert(shr_q_coalesce(q, true) == SH_OK);
+    assert(shr_q_will_coalesce(q) == true);
+    adds = 0;
+    assert(shr_q_add(q, "test", 4) == SH_OK);
+    assert(adds == 1);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    // second arrival is not signalled until the first is observed
+    assert(shr_q_add(q, "test", 4) == SH_OK);
+    assert(adds == 1);
+    assert(shr_q_count(q) == 1);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(shr_q_add(q, "test", 4) == SH_OK);
+    assert(adds == 2);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(shr_q_listen(q, 0) == SH_OK);
+    assert(shr_q_add(q, "test", 4) == SH_OK);
+    assert(adds == 2);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static void test_dead_subscribers(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+
+    shm_unlink("testq");
+    status = shr_q_create(&q, "testq", 0, SQ_READWRITE);
+    assert(status == SH_OK);
+
+    // third process only fits if entries of ended processes are reclaimed
+    for (int i = 0; i < 3; i++) {
+        pid_t pid = fork();
+        assert(pid >= 0);
+        if (pid == 0) {
+            shr_q_s *child = NULL;
+            if (shr_q_open(&child, "testq", SQ_READWRITE) != SH_OK ||
+                shr_q_listen(child, SIGUSR1) != SH_OK ||
+                shr_q_monitor(child, SIGUSR2) != SH_OK ||
+                shr_q_call(child, SIGUSR1) != SH_OK) {
+                _exit(1);
+            }
+            _exit(0);
+        }
+        int wstatus = 0;
+        assert(waitpid(pid, &wstatus, 0) == pid);
+        assert(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+    }
+    assert(shr_q_listen(q, SIGUSR1) == SH_OK);
+    adds = 0;
+    assert(shr_q_add(q, "test", 4) == SH_OK);
+    assert(adds == 1);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+}
+
+static int drain_ready(int fd)
+{
+    char buf[8];
+    int count = 0;
+
+    while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) >= 0) {
+        count++;
+    }
+    return count;
+}
+
+static bool is_ready(int fd)
+{
+    struct pollfd pfd = {.fd = fd, .events = POLLIN};
+
+    return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN);
+}
+
+static void test_readiness_fd(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    shr_q_s *wq = NULL;
+    sq_item_s item = {0};
+    sq_attr_s attr = {.flags = SQ_LEAN};
+
+    assert(shr_q_readiness_fd(NULL, SQ_READY_NONEMPTY) == -1);
+    shm_unlink("testq");
+    status = shr_q_create_ex(&q, "testq", 2, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    assert(shr_q_readiness_fd(q, SQ_READY_NONEMPTY) == -1);
+    assert(shr_q_destroy(&q) == SH_OK);
+    status = shr_q_create(&q, "testq", 2, SQ_READ_ONLY);
+    assert(status == SH_OK);
+    assert(shr_q_readiness_fd(q, 0) == -1);
+    assert(shr_q_readiness_fd(q, 4) == -1);
+    assert(shr_q_readiness_fd(q, SQ_READY_NONFULL) == -1);
+    int fd = shr_q_readiness_fd(q, SQ_READY_NONEMPTY);
+    assert(fd >= 0);
+    assert(!is_ready(fd));
+    status = shr_q_open(&wq, "testq", SQ_WRITE_ONLY);
+    assert(status == SH_OK);
+    int wfd = shr_q_readiness_fd(wq, SQ_READY_NONFULL);
+    assert(wfd >= 0 && wfd != fd);
+    // queue has room, so space is signalled at once
+    assert(is_ready(wfd));
+    drain_ready(wfd);
+    assert(shr_q_add(wq, "test", 4) == SH_OK);
+    assert(is_ready(fd));
+    assert(drain_ready(fd) == 1);
+    // not signalled again until consumer finds queue empty
+    assert(shr_q_add(wq, "test", 4) == SH_OK);
+    assert(!is_ready(fd));
+    assert(shr_q_add(wq, "test", 4) == SH_ERR_LIMIT);
+    assert(is_ready(wfd) == false);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(is_ready(wfd));
+    drain_ready(wfd);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(shr_q_remove(q, &item.buffer, &item.buf_size).status == SH_ERR_EMPTY);
+    assert(!is_ready(fd));
+    assert(shr_q_add(wq, "test", 4) == SH_OK);
+    assert(is_ready(fd));
+    assert(shr_q_close(&wq) == SH_OK);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+
+    // handles of a queue with a name longer than a socket address
+    char name[160];
+    memset(name, 'q', sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    shm_unlink(name);
+    status = shr_q_create(&q, name, 2, SQ_READWRITE);
+    assert(status == SH_OK);
+    status = shr_q_open(&wq, name, SQ_READWRITE);
+    assert(status == SH_OK);
+    fd = shr_q_readiness_fd(q, SQ_READY_NONEMPTY);
+    assert(fd >= 0);
+    wfd = shr_q_readiness_fd(wq, SQ_READY_NONEMPTY);
+    assert(wfd >= 0);
+    assert(shr_q_add(q, "test", 4) == SH_OK);
+    assert(is_ready(fd) && is_ready(wfd));
+    assert(shr_q_close(&wq) == SH_OK);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static void test_snapshot(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s item = {0};
+    sq_attr_s attr = {.lanes = 2};
+    struct timespec stamp;
+    long value;
+
+    shm_unlink("testq");
+    shm_unlink("testq2");
+    status = shr_q_create_ex(&q, "testq", 5000, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    FILE *file = tmpfile();
+    assert(file != NULL);
+    int fd = fileno(file);
+    assert(shr_q_snapshot(NULL, fd) == SH_ERR_ARG);
+    assert(shr_q_snapshot(q, -1) == SH_ERR_ARG);
+    assert(shr_q_restore(NULL, fd) == SH_ERR_ARG);
+    assert(shr_q_add_prio(q, "high", 4, 1) == SH_OK);
+    item = shr_q_remove_borrow(q);
+    assert(item.status == SH_OK);
+    stamp = *item.timestamp;
+    assert(shr_q_release(q, &item) == SH_OK);
+    assert(shr_q_add_prio(q, "high", 4, 1) == SH_OK);
+    sq_vec_s vec[2] = {{.type = SH_ASCII_T, .len = 5, .base = "first"},
+                       {.type = SH_INTEGER_T, .len = sizeof(long), .base = &value}};
+    value = 42;
+    assert(shr_q_addv(q, vec, 2) == SH_OK);
+    // more items than are linked as a single chunk
+    for (value = 0; value < 3000; value++) {
+        assert(shr_q_add(q, &value, sizeof(long)) == SH_OK);
+    }
+    assert(shr_q_snapshot(q, fd) == SH_OK);
+    assert(shr_q_count(q) == 3002);
+    assert(lseek(fd, 0, SEEK_SET) == 0);
+    assert(shr_q_restore("testq", fd) == SH_ERR_EXIST);
+    assert(lseek(fd, 0, SEEK_SET) == 0);
+    assert(shr_q_restore("testq2", fd) == SH_OK);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    status = shr_q_open(&q, "testq2", SQ_READWRITE);
+    assert(status == SH_OK);
+    assert(shr_q_count(q) == 3002);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(item.length == 4 && memcmp(item.value, "high", 4) == 0);
+    assert(item.timestamp->tv_sec == stamp.tv_sec);
+    item = shr_q_remove(q, &item.buffer, &item.buf_size);
+    assert(item.status == SH_OK);
+    assert(item.type == SH_VECTOR_T && item.vcount == 2);
+    assert(item.vector[0].type == SH_ASCII_T);
+    assert(memcmp(item.vector[0].base, "first", 5) == 0);
+    assert(*(long*)item.vector[1].base == 42);
+    for (value = 0; value < 3000; value++) {
+        item = shr_q_remove(q, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        assert(*(long*)item.value == value);
+    }
+    assert(shr_q_remove(q, &item.buffer, &item.buf_size).status == SH_ERR_EMPTY);
+
+    // vector length past the end of its record is rejected
+    off_t end = lseek(fd, 0, SEEK_END);
+    char *snap = malloc(end);
+    assert(snap != NULL);
+    assert(pread(fd, snap, end, 0) == end);
+    off_t pos = 0;
+    while (pos < end - 5 && memcmp(&snap[pos], "first", 5) != 0) {
+        pos++;
+    }
+    assert(pos < end - 5);
+    long len = 1 << 20;
+    assert(pwrite(fd, &len, sizeof(long), pos - sizeof(long)) == sizeof(long));
+    assert(lseek(fd, 0, SEEK_SET) == 0);
+    assert(shr_q_restore("testq3", fd) == SH_ERR_ARG);
+    assert(!shr_q_is_valid("testq3"));
+    len = 5;
+    assert(pwrite(fd, &len, sizeof(long), pos - sizeof(long)) == sizeof(long));
+    free(snap);
+
+    // truncated snapshot does not leave a queue behind
+    assert(ftruncate(fd, 4096) == 0);
+    assert(lseek(fd, 0, SEEK_SET) == 0);
+    assert(shr_q_restore("testq3", fd) == SH_ERR_STATE);
+    assert(!shr_q_is_valid("testq3"));
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    fclose(file);
+    free(item.buffer);
+}
+
+static void test_huge_pages(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    shr_q_s *q2 = NULL;
+    sq_item_s item = {0};
+    sq_attr_s attr = {.flags = SQ_HUGE};
+    size_t size = 0;
+    char buffer[1024];
+
+    shm_unlink("testq");
+    status = shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    assert(validate_existence("testq", &size) == SH_OK);
+    assert(size == HUGE_SIZE);
+    status = shr_q_open(&q2, "testq", SQ_READWRITE);
+    assert(status == SH_OK);
+    // grows a huge page at a time
+    for (long i = 0; i < 3000; i++) {
+        memcpy(buffer, &i, sizeof(long));
+        assert(shr_q_add(q, buffer, sizeof(buffer)) == SH_OK);
+    }
+    assert(validate_existence("testq", &size) == SH_OK);
+    assert(size > HUGE_SIZE && size % HUGE_SIZE == 0);
+    for (long i = 0; i < 3000; i++) {
+        item = shr_q_remove(q2, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        assert(item.length == sizeof(buffer));
+        assert(*(long*)item.value == i);
+    }
+    status = shr_q_close(&q2);
+    assert(status == SH_OK);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static void test_prealloc(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    shr_q_s *q2 = NULL;
+    sq_item_s item = {0};
+    sq_attr_s attr = {.flags = SQ_SPSC, .prealloc = 10};
+    size_t size = 0;
+    size_t grown = 0;
+    char buffer[100] = {0};
+
+    shm_unlink("testq");
+    assert(shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr) == SH_ERR_ARG);
+    attr = (sq_attr_s){.prealloc = -1};
+    assert(shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr) == SH_ERR_ARG);
+    // failed create leaves no queue behind
+    attr = (sq_attr_s){.prealloc = 1L << 40};
+    assert(shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr) == SH_ERR_NOMEM);
+    assert(q == NULL);
+    assert(validate_existence("testq", &size) == SH_ERR_EXIST);
+    attr = (sq_attr_s){.initial_size = 1 << 20};
+    status = shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    assert(validate_existence("testq", &size) == SH_OK);
+    assert(size == 1 << 20);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+
+    // carved nodes and data cover the burst without growing the queue
+    attr = (sq_attr_s){.prealloc = 1000, .prealloc_len = sizeof(buffer)};
+    status = shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    assert(validate_existence("testq", &size) == SH_OK);
+    assert(size > PAGE_SIZE);
+    status = shr_q_open(&q2, "testq", SQ_READWRITE);
+    assert(status == SH_OK);
+    for (long i = 0; i < 1000; i++) {
+        memcpy(buffer, &i, sizeof(long));
+        assert(shr_q_add(q2, buffer, sizeof(buffer)) == SH_OK);
+    }
+    assert(validate_existence("testq", &grown) == SH_OK);
+    assert(grown == size);
+    for (long i = 0; i < 1000; i++) {
+        item = shr_q_remove(q, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        assert(*(long*)item.value == i);
+    }
+    status = shr_q_close(&q2);
+    assert(status == SH_OK);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+
+    // fixed size nodes are carved whole
+    attr = (sq_attr_s){.item_size = sizeof(buffer), .prealloc = 1000};
+    status = shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    assert(validate_existence("testq", &size) == SH_OK);
+    for (long i = 0; i < 1000; i++) {
+        assert(shr_q_add(q, buffer, sizeof(buffer)) == SH_OK);
+    }
+    assert(validate_existence("testq", &grown) == SH_OK);
+    assert(grown == size);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static long shm_blocks(char const * const name)
+{
+    struct stat statbuf;
+    int fd = shm_open(name, O_RDONLY, 0);
+    assert(fd >= 0);
+    assert(fstat(fd, &statbuf) == 0);
+    close(fd);
+    return statbuf.st_blocks;
+}
+
+static void test_compact(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s item = {0};
+    sq_attr_s attr = {.compact_msec = -1};
+    size_t size = 0;
+    size_t after = 0;
+    long blocks;
+    static char buffer[1 << 16];
+
+    assert(shr_q_compact(NULL) == SH_ERR_ARG);
+    shm_unlink("testq");
+    assert(shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr) == SH_ERR_ARG);
+    status = shr_q_create(&q, "testq", 0, SQ_READWRITE);
+    assert(status == SH_OK);
+    for (long i = 0; i < 16; i++) {
+        memset(buffer, (int) i + 1, sizeof(buffer));
+        assert(shr_q_add(q, buffer, sizeof(buffer)) == SH_OK);
+    }
+    for (long i = 0; i < 16; i++) {
+        item = shr_q_remove(q, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+    }
+    assert(validate_existence("testq", &size) == SH_OK);
+    blocks = shm_blocks("testq");
+
+    // freed data stays allocated to the queue, but its pages are released
+    assert(shr_q_compact(q) == SH_OK);
+    assert(shm_blocks("testq") < blocks - 16 * (sizeof(buffer) / 512));
+    assert(validate_existence("testq", &after) == SH_OK);
+    assert(after == size);
+    blocks = shm_blocks("testq");
+    for (long i = 0; i < 16; i++) {
+        memset(buffer, (int) i + 1, sizeof(buffer));
+        assert(shr_q_add(q, buffer, sizeof(buffer)) == SH_OK);
+    }
+    // released memory is backed again when reused
+    assert(shm_blocks("testq") >= blocks + 16 * (sizeof(buffer) / 512));
+    assert(validate_existence("testq", &after) == SH_OK);
+    assert(after == size);
+    for (long i = 0; i < 16; i++) {
+        item = shr_q_remove(q, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        assert(item.length == sizeof(buffer));
+        assert(((char*) item.value)[0] == i + 1);
+        assert(((char*) item.value)[sizeof(buffer) - 1] == i + 1);
+    }
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+
+    // background compaction by handle
+    attr = (sq_attr_s){.compact_msec = 10};
+    status = shr_q_create_ex(&q, "testq", 0, SQ_READWRITE, &attr);
+    assert(status == SH_OK);
+    for (long i = 0; i < 16; i++) {
+        assert(shr_q_add(q, buffer, sizeof(buffer)) == SH_OK);
+    }
+    blocks = shm_blocks("testq");
+    for (long i = 0; i < 16; i++) {
+        item = shr_q_remove(q, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+    }
+    for (int i = 0; i < 100 && shm_blocks("testq") >= blocks / 2; i++) {
+        usleep(10000);
+    }
+    assert(shm_blocks("testq") < blocks / 2);
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
+static void test_reserved_growth(void)
+{
+    sh_status_e status;
+    shr_q_s *q = NULL;
+    sq_item_s item = {0};
+    size_t size = 0;
+    size_t grown = 0;
+    char buffer[1024] = {0};
+
+    shm_unlink("testq");
+    status = shr_q_create(&q, "testq", 0, SQ_READWRITE);
+    assert(status == SH_OK);
+    assert(validate_existence("testq", &size) == SH_OK);
+
+    // growth by another process is seen without remapping
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        shr_q_s *q2 = NULL;
+        if (shr_q_open(&q2, "testq", SQ_WRITE_ONLY) != SH_OK) {
+            _exit(1);
+        }
+        for (long i = 0; i < 10000; i++) {
+            memcpy(buffer, &i, sizeof(long));
+            if (shr_q_add(q2, buffer, sizeof(buffer)) != SH_OK) {
+                _exit(1);
+            }
+        }
+        _exit(0);
+    }
+    int wstatus = 0;
+    assert(waitpid(pid, &wstatus, 0) == pid);
+    assert(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+    assert(validate_existence("testq", &grown) == SH_OK);
+    assert(grown > size + 10000 * sizeof(buffer));
+    for (long i = 0; i < 10000; i++) {
+        item = shr_q_remove(q, &item.buffer, &item.buf_size);
+        assert(item.status == SH_OK);
+        assert(*(long*)item.value == i);
+    }
+    status = shr_q_destroy(&q);
+    assert(status == SH_OK);
+    free(item.buffer);
+}
+
 int main(void)
 {
     set_signal_handlers();
@@ -1294,6 +2657,29 @@ int main(void)
     test_expiration_discard();
     test_codel_algorithm();
     test_adaptive_lifo();
+    test_reserve_commit();
+    test_borrow_release();
+    test_remove_batch();
+    test_remove_batch_expired();
+    test_add_batch();
+    test_spsc_ring();
+    test_fixed_size_items();
+    test_count_approx();
+    test_occupancy_events();
+    test_queue_clock();
+    test_lean_queue();
+    test_priority_lanes();
+    test_coalesced_signals();
+    test_dead_subscribers();
+    test_readiness_fd();
+    test_select();
+    test_broadcast();
+    test_durable_queue();
+    test_snapshot();
+    test_huge_pages();
+    test_prealloc();
+    test_compact();
+    test_reserved_growth();
 
     return 0;
 }